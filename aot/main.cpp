@@ -0,0 +1,456 @@
+// mini_lisp_aot: compiles a Lisp file ahead of time into a C++ program that
+// runs it as `mini_lisp FILE` would, without reading or compiling anything at
+// startup. Each top-level form is compiled to bytecode as usual, and the
+// bytecode is translated into C++ functions run in place of the VM; where they
+// meet something unusual, e.g. an argument of the wrong type, they hand the
+// activation back to the VM, which is linked in too.
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../src/aot.h"
+#include "../src/builtins.h"
+#include "../src/bytecode.h"
+#include "../src/compiler.h"
+#include "../src/error.h"
+#include "../src/eval_env.h"
+#include "../src/gc.h"
+#include "../src/lexer.h"
+#include "../src/reader.h"
+#include "../src/source_file.h"
+
+namespace {
+
+std::string quote(const std::string& text) {
+    std::ostringstream os;
+    os << "std::string_view{\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c >= 0x20 && c < 0x7F) {
+            os << c;
+        } else {
+            os << '\\' << std::oct << std::setw(3) << std::setfill('0') << int(c) << std::dec;
+        }
+    }
+    os << "\", " << text.size() << "}";
+    return os.str();
+}
+
+// Writes the tables of runProgram and the C++ translation of the code.
+class Translator {
+private:
+    std::ostringstream out;
+    std::vector<std::string> names;
+    std::unordered_map<SymbolId, std::uint32_t> nameIndices;
+    std::vector<std::string> values;
+    std::map<std::pair<ValueType, std::uintptr_t>, std::uint32_t> valueIndices;
+    std::map<std::string, std::uint32_t> numberIndices;  // keyed by their entries
+    std::vector<std::string> prototypes;
+    std::vector<std::string> steps;
+
+    std::uint32_t name(SymbolId id) {
+        auto [it, inserted] = nameIndices.try_emplace(id, names.size());
+        if (inserted) {
+            names.push_back(quote(IdentifierValue::nameOf(id)));
+        }
+        return it->second;
+    }
+
+    std::uint32_t value(ValuePtr v) {
+        if (v.isNumber()) {
+            std::ostringstream entry;
+            if (v.isFlonum()) {
+                entry << "{ValueType::NUMBER, 0x" << std::hex
+                      << std::bit_cast<std::uint64_t>(v.asFlonum()) << std::dec << "u}";
+            } else {
+                entry << "{ValueType::NUMBER, 0, " << quote(v.toString()) << "}";
+            }
+            auto [it, inserted] = numberIndices.try_emplace(entry.str(), values.size());
+            if (inserted) {
+                values.push_back(entry.str());
+            }
+            return it->second;
+        }
+        auto type = v.getType();
+        auto key = std::pair{type, reinterpret_cast<std::uintptr_t>(v.get())};
+        if (type == ValueType::BOOLEAN) {
+            key.second = v.asBool();
+        }
+        if (auto it = valueIndices.find(key); it != valueIndices.end()) {
+            return it->second;
+        }
+        std::ostringstream entry;
+        switch (type) {
+            case ValueType::NIL: entry << "{ValueType::NIL}"; break;
+            case ValueType::BOOLEAN: entry << "{ValueType::BOOLEAN, " << v.asBool() << "}"; break;
+            case ValueType::SYMBOL:
+                entry << "{ValueType::SYMBOL, 0, "
+                      << quote(IdentifierValue::nameOf(*v.getSymbolId())) << "}";
+                break;
+            case ValueType::STRING:
+                entry << "{ValueType::STRING, 0, " << quote(std::string(v.asString())) << "}";
+                break;
+            case ValueType::PAIR: {
+                auto car = value(v.asPair().getCar());
+                auto cdr = value(v.asPair().getCdr());
+                entry << "{ValueType::PAIR, 0, {}, " << car << ", " << cdr << "}";
+                break;
+            }
+            case ValueType::VECTOR: {
+                // The elements go in as a list of their own, out of the pools' index.
+                auto elements = value(Value::nil());
+                auto&& vector = v.asVector().getElements();
+                for (auto it = vector.rbegin(); it != vector.rend(); ++it) {
+                    auto car = value(*it);
+                    values.push_back("{ValueType::PAIR, 0, {}, " + std::to_string(car) + ", " +
+                                     std::to_string(elements) + "}");
+                    elements = values.size() - 1;
+                }
+                entry << "{ValueType::VECTOR, 0, {}, " << elements << "}";
+                break;
+            }
+            case ValueType::BUILTIN_PROC: {
+                auto func = static_cast<const BuiltinProcValue*>(v.get())->getFunc();
+                for (auto&& [builtin, f] : BUILTINS) {
+                    if (f == func) {
+                        entry << "{ValueType::BUILTIN_PROC, 0, " << quote(builtin) << "}";
+                        break;
+                    }
+                }
+                break;
+            }
+            default: throw LispError("Cannot compile constant " + v.toString());
+        }
+        values.push_back(entry.str());
+        return valueIndices[key] = values.size() - 1;
+    }
+
+    // `NAME_n` if there are elements, an empty span otherwise.
+    template <typename T>
+    std::string table(const char* kind, std::size_t index, const std::vector<T>& elements) {
+        if (elements.empty()) {
+            return "{}";
+        }
+        auto name = std::string(kind) + "_" + std::to_string(index);
+        out << "const " << (std::strcmp(kind, "NAMES") == 0 ? "AotName" : "std::uint32_t") << " "
+            << name << "[]{";
+        for (std::size_t i = 0; i < elements.size(); i++) {
+            out << (i ? ", " : "") << elements[i];
+        }
+        out << "};\n";
+        return name;
+    }
+
+    void translate(const Prototype* proto, std::size_t index);
+
+    std::uint32_t prototype(const Prototype* proto) {
+        auto index = prototypes.size();
+        prototypes.emplace_back();
+        auto code = proto->getCode();
+        std::vector<std::uint32_t> words(code, code + proto->getCodeSize());
+        std::vector<std::string> fixups;
+        std::vector<std::uint32_t> constants;
+        std::vector<std::uint32_t> nested;
+        auto fixup = [&](std::size_t offset) {
+            fixups.push_back("{" + std::to_string(offset) + ", " +
+                             std::to_string(name(words[offset])) + "}");
+            words[offset] = 0;
+        };
+        for (auto offset : nameOperands(proto)) {
+            fixup(offset);
+        }
+        for (std::size_t k = 0; k < proto->getConstantCount(); k++) {
+            constants.push_back(value(proto->getConstants()[k]));
+        }
+        for (std::size_t i = 0; i < proto->getProtoCount(); i++) {
+            nested.push_back(prototype(proto->getProtos()[i]));
+        }
+        auto codeTable = table("CODE", index, words);
+        auto nameTable = table("NAMES", index, fixups);
+        auto constantTable = table("CONSTANTS", index, constants);
+        auto protoTable = table("PROTOS", index, nested);
+        translate(proto, index);
+        std::ostringstream entry;
+        entry << "{" << codeTable << ", " << nameTable << ", " << constantTable << ", "
+              << protoTable << ", " << proto->getCacheCount() << ", " << proto->getParamCount()
+              << ", " << proto->getFrameSize() << ", " << proto->getMaxStack() << ", "
+              << (proto->needsHeapFrame() ? "true" : "false") << ", native_" << index << "}";
+        prototypes[index] = entry.str();
+        return index;
+    }
+
+public:
+    void addForm(const Prototype* proto) {
+        steps.push_back("{" + std::to_string(prototype(proto)) + ", nullptr}");
+    }
+    void addError(const std::string& message) {
+        steps.push_back("{0, " + quote(message) + ".data()}");
+    }
+
+    void write(std::ostream& os, const char* source) {
+        auto list = [&](const char* type, const char* name, const std::vector<std::string>& items) {
+            os << "const " << type << " " << name << "[]{\n";
+            for (auto&& item : items) {
+                os << "    " << item << ",\n";
+            }
+            os << "};\n\n";
+        };
+        os << "// Compiled by mini_lisp_aot from " << source << ".\n\n"
+           << "#include \"aot.h\"\n"
+           << "#include \"vm.h\"\n\n"
+           << "namespace {\n\n"
+           << out.str() << "\n";
+        auto span = [&](const char* name, const std::vector<std::string>& items) {
+            return items.empty() ? std::string("{}") : std::string(name);
+        };
+        if (!names.empty()) list("std::string_view", "NAMES", names);
+        if (!values.empty()) list("AotValue", "VALUES", values);
+        if (!prototypes.empty()) list("AotPrototype", "PROTOTYPES", prototypes);
+        if (!steps.empty()) list("AotStep", "STEPS", steps);
+        os << "}  // namespace\n\n"
+           << "int main(int argc, char**) {\n"
+           << "    GcHeap::registerStack(&argc);\n"
+           << "    runProgram({" << span("NAMES", names) << ", " << span("VALUES", values) << ", "
+           << span("PROTOTYPES", prototypes) << ", " << span("STEPS", steps) << "});\n"
+           << "}\n";
+    }
+};
+
+// Each instruction becomes a block of C++ doing what the VM does, or handing
+// back to the VM at its start.
+void Translator::translate(const Prototype* proto, std::size_t index) {
+    auto code = proto->getCode();
+    auto size = proto->getCodeSize();
+    std::vector<bool> targets(size);
+    for (std::size_t pc = 0; pc < size; pc += 1 + operandCount(code[pc])) {
+        switch (static_cast<OpCode>(code[pc])) {
+            case OpCode::JUMP:
+            case OpCode::JUMP_IF_FALSE:
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+            case OpCode::JUMP_IF_TRUE_OR_POP: targets[code[pc + 1]] = true; break;
+            case OpCode::GUARD: targets[code[pc + 3]] = true; break;
+            case OpCode::TAIL_CALL: targets[0] = !proto->needsHeapFrame(); break;
+            default: break;
+        }
+    }
+    out << "std::uint32_t native_" << index << "(JitFrame* frame) {\n"
+        << "    [[maybe_unused]] auto locals = frame->locals;\n"
+        << "    [[maybe_unused]] auto sp = frame->sp;\n"
+        << "    [[maybe_unused]] auto caches = frame->caches;\n"
+        << "    [[maybe_unused]] auto constants = frame->proto->getConstants();\n";
+    for (std::size_t pc = 0; pc < size; pc += 1 + operandCount(code[pc])) {
+        auto operand = [&](std::size_t i) { return code[pc + 1 + i]; };
+        auto resume = "return aotResume(frame, sp, " + std::to_string(pc) + ");";
+        auto local = [&](std::uint32_t slot) {
+            out << "        if (!locals[" << slot << "]) " << resume << "\n";
+        };
+        auto push = [&](const std::string& value) { out << "        *sp++ = " << value << ";\n"; };
+        auto label = [](std::uint32_t target) { return "L" + std::to_string(target); };
+        if (targets[pc]) {
+            out << label(pc) << ":\n";
+        }
+        out << "    {\n";
+        switch (static_cast<OpCode>(code[pc])) {
+            case OpCode::CONST: push("constants[" + std::to_string(operand(0)) + "]"); break;
+            case OpCode::NIL: push("Value::nil()"); break;
+            case OpCode::LOCAL:
+                local(operand(0));
+                push("locals[" + std::to_string(operand(0)) + "]");
+                break;
+            case OpCode::LOCAL_CONST:
+                local(operand(0));
+                push("locals[" + std::to_string(operand(0)) + "]");
+                push("constants[" + std::to_string(operand(2)) + "]");
+                break;
+            case OpCode::LOCAL_LOCAL:
+                local(operand(0));
+                local(operand(2));
+                push("locals[" + std::to_string(operand(0)) + "]");
+                push("locals[" + std::to_string(operand(2)) + "]");
+                break;
+            case OpCode::LOCAL_UP:
+                out << "        auto&& value = frame->env->lookupLocal(" << operand(0) - 1 << ", "
+                    << operand(1) << ");\n"
+                    << "        if (!value) " << resume << "\n";
+                push("value");
+                break;
+            case OpCode::GLOBAL:
+                out << "        if (!caches[" << operand(1) << "].binding) " << resume << "\n";
+                push("caches[" + std::to_string(operand(1)) + "].binding->value");
+                break;
+            case OpCode::DEFINE_LOCAL:
+                out << "        locals[" << operand(0) << "] = sp[-1];\n"
+                    << "        sp[-1] = constants[" << operand(1) << "];\n";
+                break;
+            case OpCode::DEFINE_GLOBAL:
+                out << "        frame->env->defineBinding(*constants[" << operand(0)
+                    << "].getSymbolId(), sp[-1]);\n"
+                    << "        sp[-1] = constants[" << operand(0) << "];\n";
+                break;
+            case OpCode::POP: out << "        sp--;\n"; break;
+            case OpCode::JUMP: out << "        goto " << label(operand(0)) << ";\n"; break;
+            case OpCode::JUMP_IF_FALSE:
+                out << "        if (!(*--sp).isTrue()) goto " << label(operand(0)) << ";\n";
+                break;
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+            case OpCode::JUMP_IF_TRUE_OR_POP:
+                out << "        if ("
+                    << (static_cast<OpCode>(code[pc]) == OpCode::JUMP_IF_FALSE_OR_POP ? "!" : "")
+                    << "sp[-1].isTrue()) goto " << label(operand(0)) << ";\n"
+                    << "        sp--;\n";
+                break;
+            case OpCode::GUARD:
+                out << "        auto&& cache = caches[" << operand(1) << "];\n"
+                    << "        if (cache.version != cache.binding->version) goto "
+                    << label(operand(2)) << ";\n";
+                break;
+            case OpCode::BIND:
+                out << "        sp -= " << operand(1) << ";\n";
+                for (std::uint32_t i = 0; i < operand(1); i++) {
+                    out << "        locals[" << operand(0) + i << "] = sp[" << i << "];\n";
+                }
+                break;
+            case OpCode::CALL:
+                out << "        sp -= " << operand(0) << ";\n"
+                    << "        sp[-1] = callProcedure(sp[-1], {sp, " << operand(0)
+                    << "}, *frame->env);\n";
+                break;
+            case OpCode::TAIL_CALL: {
+                // Self calls reuse the frame; the VM sees to the others.
+                auto argc = operand(0);
+                if (proto->needsHeapFrame()) {
+                    out << "        " << resume << "\n";
+                    break;
+                }
+                out << "        if (!aotSelfCall(frame, sp[-" << argc + 1 << "], " << argc << ")) "
+                    << resume << "\n";
+                for (std::uint32_t i = 0; i < argc; i++) {
+                    out << "        locals[" << i << "] = sp[" << int(i) - int(argc) << "];\n";
+                }
+                for (auto i = argc; i < proto->getFrameSize(); i++) {
+                    out << "        locals[" << i << "] = ValuePtr();\n";
+                }
+                out << "        sp = locals + " << proto->getFrameSize() << ";\n"
+                    << "        goto L0;\n";
+                break;
+            }
+            case OpCode::CALL_PRIMITIVE: {
+                out << "        if (!aotStock(caches[" << operand(3) << "])) " << resume << "\n";
+                auto numeric = [&](const char* op) {
+                    out << "        if (!aotNumbers(sp)) " << resume << "\n"
+                        << "        sp[-2] = " << op << "(sp[-2], sp[-1]);\n"
+                        << "        sp--;\n";
+                };
+                auto compare = [&](const char* op) {
+                    out << "        if (!aotNumbers(sp)) " << resume << "\n"
+                        << "        sp[-2] = Value::fromBoolean(numberCompare(sp[-2], sp[-1]) "
+                        << op << " 0);\n"
+                        << "        sp--;\n";
+                };
+                auto pair = [&](const char* part) {
+                    out << "        if (!sp[-1].isPair()) " << resume << "\n"
+                        << "        sp[-1] = sp[-1].asPair()." << part << "();\n";
+                };
+                switch (static_cast<Primitive>(operand(0))) {
+                    case Primitive::ADD: numeric("numberAdd"); break;
+                    case Primitive::SUB: numeric("numberSub"); break;
+                    case Primitive::MUL: numeric("numberMul"); break;
+                    case Primitive::NUM_EQ: compare("=="); break;
+                    case Primitive::LT: compare("<"); break;
+                    case Primitive::GT: compare(">"); break;
+                    case Primitive::LE: compare("<="); break;
+                    case Primitive::GE: compare(">="); break;
+                    case Primitive::CAR: pair("getCar"); break;
+                    case Primitive::CDR: pair("getCdr"); break;
+                    case Primitive::CONS:
+                        out << "        sp[-2] = makeValue<PairValue>(sp[-2], sp[-1]);\n"
+                            << "        sp--;\n";
+                        break;
+                    case Primitive::NULL_Q:
+                        out << "        sp[-1] = Value::fromBoolean(sp[-1].isNil());\n";
+                        break;
+                }
+                break;
+            }
+            case OpCode::RETURN:
+                out << "        frame->result = sp[-1];\n"
+                    << "        return static_cast<std::uint32_t>(JitExit::RETURN);\n";
+                break;
+            case OpCode::CONS:
+                out << "        sp--;\n"
+                    << "        sp[-1] = makeValue<PairValue>(sp[-1], sp[0]);\n";
+                break;
+            case OpCode::ERROR:
+                out << "        throw LispError(std::string(constants[" << operand(0)
+                    << "].asString()));\n";
+                break;
+            default:
+                // Closures need the heap frame, which only the VM has.
+                out << "        " << resume << "\n";
+                break;
+        }
+        out << "    }\n";
+    }
+    out << "}\n\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GcHeap::registerStack(&argc);
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " FILE OUTPUT" << std::endl;
+        return 1;
+    }
+    std::deque<TokenPtr> tokens;
+    try {
+        SourceFile file(argv[1]);
+        TokenStream stream(file.getText());
+        while (auto token = stream.next()) {
+            tokens.push_back(std::move(token));
+        }
+    } catch (std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // The forms are compiled in the environment they would run in, which the
+    // compiler only asks about the builtins a call may be folded into. No form
+    // is run, so the builtins are the stock ones; forms that redefine them are
+    // caught by the guards of the folded calls, see runProgram.
+    auto env = EvaluateEnv::createGlobal();
+    GcRoot envRoot(env);
+    std::vector<Prototype*, GcRootAllocator<Prototype*>> forms;
+    Translator translator;
+    Reader reader(tokens);
+    try {
+        while (true) {
+            Compiler compiler(*env);
+            forms.push_back(compiler.compileTopLevel(reader.read()));
+            translator.addForm(forms.back());
+        }
+    } catch (EOFError&) {
+    } catch (std::runtime_error& e) {
+        // Reported when the program gets there.
+        translator.addError(e.what());
+    }
+
+    std::ofstream output(argv[2]);
+    translator.write(output, argv[1]);
+    if (!output) {
+        std::cerr << "Error: Cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,67 @@
+// List construction throughput: garbage-collected, slab-allocated PairValue,
+// against the same PairValue allocated by ::operator new and freed by
+// ::operator delete when the list is dropped, as the reference-counted pairs
+// were. Numbers are immediate in both, so only the allocator differs.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../src/gc.h"
+#include "../src/slab.h"
+#include "../src/value.h"
+
+namespace {
+
+constexpr int LIST_LENGTH = 1000;
+constexpr int ROUNDS = 20000;
+
+template <typename F>
+double pairsPerSecond(F buildOnce) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        buildOnce();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return double(LIST_LENGTH) * ROUNDS / elapsed.count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GcHeap::registerStack(&argc);
+    auto global = pairsPerSecond([] {
+        ValuePtr list = Value::nil();
+        for (int i = LIST_LENGTH; i > 0; i--) {
+            list = ValuePtr(::new PairValue(Value::fromNumber(i), std::move(list)));
+        }
+        while (list.isPair()) {
+            auto pair = static_cast<PairValue*>(list.get());
+            list = pair->getCdr();
+            ::delete pair;
+        }
+    });
+    auto slab = pairsPerSecond([] {
+        ValuePtr list = Value::nil();
+        for (int i = LIST_LENGTH; i > 0; i--) {
+            list = makeValue<PairValue>(Value::fromNumber(i), std::move(list));
+        }
+    });
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "operator new pairs: " << global / 1e6 << " M pairs/s\n";
+    std::cout << "slab pairs:         " << slab / 1e6 << " M pairs/s\n";
+    std::cout << "speedup:            " << slab / global << "x\n";
+    auto gc = GcHeap::stats();
+    std::cout << "collections:        " << gc.collections << ", " << gc.totalPauseMs
+              << " ms total pause\n\n";
+
+    std::cout << "size  objects      bytes          live  reserved\n";
+    for (auto& s : SlabAllocator::stats()) {
+        if (s.allocatedObjects == 0) continue;
+        std::cout << std::setw(4) << s.objectSize << "  " << std::setw(11) << s.allocatedObjects
+                  << "  " << std::setw(13) << s.allocatedBytes << "  " << std::setw(4)
+                  << s.liveObjects << "  " << s.reservedBytes << "\n";
+    }
+}
@@ -0,0 +1,85 @@
+// Cost of a builtin call: the ArgSpan wrapper that builtin<> generates from a
+// typed builtin's signature, against the hand-written ArgSpan builtins it
+// replaced, and the typed builtin called directly with unboxed arguments.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "../src/builtins.h"
+#include "../src/eval_env.h"
+#include "../src/gc.h"
+#include "../src/number.h"
+
+namespace {
+
+constexpr int ROUNDS = 20000;
+
+ValuePtr handWrittenLt(ArgSpan args, EvaluateEnv&) {
+    checkArgsCount(args, 2, 2);
+    for (auto arg : args) {
+        if (!arg.isNumber()) {
+            throw LispError(arg.toString() + " is not number");
+        }
+    }
+    return Value::fromBoolean(numberCompare(args[0], args[1]) < 0);
+}
+
+ValuePtr handWrittenCar(ArgSpan args, EvaluateEnv&) {
+    checkArgsCount(args, 1, 1);
+    if (!args[0].isPair()) {
+        throw LispError("car: argument is not a pair");
+    }
+    return args[0].asPair().getCar();
+}
+
+// Calls through a pointer the compiler cannot see through, as the VM does.
+template <typename F>
+double nanosPerCall(const ValueVector& values, std::size_t arity, F call) {
+    long hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        for (std::size_t j = 0; j + arity <= values.size(); j += arity) {
+            hits += call(ArgSpan{values.data() + j, arity}).isTrue();
+        }
+        asm volatile("" : "+r"(hits));
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (double(ROUNDS) * (values.size() / arity));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GcHeap::registerStack(&argc);
+    auto env = EvaluateEnv::createGlobal();
+    ValueVector numbers;
+    ValueVector pairs;
+    for (int i = 0; i < 256; i++) {
+        numbers.push_back(i % 3 ? Value::fromInteger(i) : Value::fromNumber(i + 0.5));
+        pairs.push_back(makeValue<PairValue>(Value::fromInteger(i), Value::nil()));
+    }
+
+    auto report = [&](const char* name, const ValueVector& values, std::size_t arity,
+                      BuiltinFuncType* handWritten, BuiltinFuncType* generated, auto direct) {
+        BuiltinFuncType* volatile handWrittenPtr = handWritten;
+        BuiltinFuncType* volatile generatedPtr = generated;
+        auto handNs = nanosPerCall(values, arity, [&](ArgSpan args) {
+            return handWrittenPtr(args, *env);
+        });
+        auto generatedNs = nanosPerCall(values, arity, [&](ArgSpan args) {
+            return generatedPtr(args, *env);
+        });
+        auto directNs = nanosPerCall(values, arity, direct);
+        std::cout << std::left << std::setw(8) << name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(10) << handNs << " ns" << std::setw(10)
+                  << generatedNs << " ns" << std::setw(10) << directNs << " ns\n";
+    };
+    std::cout << "builtin  hand-written   builtin<>       typed\n";
+    report("<", numbers, 2, handWrittenLt, BUILTINS.at("<"), [](ArgSpan args) {
+        return Value::fromBoolean(builtins::lt({args[0]}, {args[1]}));
+    });
+    report("car", pairs, 1, handWrittenCar, BUILTINS.at("car"), [](ArgSpan args) {
+        return builtins::car(args[0].asPair());
+    });
+}
@@ -0,0 +1,99 @@
+// Cost of procedure calls: C++ heap allocations, garbage-collected bytes and
+// time per iteration of small Lisp loops. Arguments are passed to lambdas and
+// builtins as views of the VM's operand stack, and frames that no closure can
+// see stay on the C++ stack, so the plain calls should allocate nothing.
+
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include "../src/eval_env.h"
+#include "../src/gc.h"
+#include "../src/reader.h"
+#include "../src/tokenizer.h"
+
+namespace {
+
+std::uint64_t heapAllocations = 0;
+
+constexpr int ITERATIONS = 1000000;
+
+void evalAll(EvaluateEnv* env, const std::string& source) {
+    std::deque<TokenPtr> tokens;
+    for (auto&& token : Tokenizer::tokenize(source)) {
+        tokens.push_back(std::move(token));
+    }
+    Reader reader(tokens);
+    while (!tokens.empty()) {
+        env->eval(reader.read());
+    }
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+    heapAllocations++;
+    if (auto ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, char** argv) {
+    GcHeap::registerStack(&argc);
+    auto env = EvaluateEnv::createGlobal();
+    GcRoot envRoot(env);
+    evalAll(env, R"(
+        (define (add a b) (+ a b))
+        (define (add6 a b c d e f) (+ a b c d e f))
+        (define (capture a b) (let ((get (lambda () a))) b))
+        (define (fold-step acc x) (+ acc x))
+        (define (loop-add n acc) (if (= n 0) acc (loop-add (- n 1) (add n acc))))
+        (define (loop-add6 n acc) (if (= n 0) acc (loop-add6 (- n 1) (add6 n acc 1 2 3 4))))
+        (define (loop-let n) (if (= n 0) 0 (let ((m (- n 1))) (loop-let m))))
+        (define (loop-apply n) (if (= n 0) 0 (begin (apply add '(1 2)) (loop-apply (- n 1)))))
+        (define (loop-capture n) (if (= n 0) 0 (begin (capture n 1) (loop-capture (- n 1)))))
+        (define (loop-builtin n) (if (= n 0) 0 (begin (car '(1 2)) (loop-builtin (- n 1)))))
+    )");
+
+    auto measure = [&](const char* name, const std::string& call) {
+        std::deque<TokenPtr> tokens;
+        for (auto&& token : Tokenizer::tokenize(call)) {
+            tokens.push_back(std::move(token));
+        }
+        Reader reader(tokens);
+        auto expr = reader.read();
+        GcHeap::collect();
+        auto allocationsBefore = heapAllocations;
+        auto bytesBefore = GcHeap::stats().allocatedBytes;
+        auto start = std::chrono::steady_clock::now();
+        env->eval(expr);
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        auto allocations = heapAllocations - allocationsBefore;
+        auto bytes = GcHeap::stats().allocatedBytes - bytesBefore;
+        std::cout << std::left << std::setw(14) << name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << double(allocations) / ITERATIONS
+                  << std::setprecision(1) << std::setw(12) << double(bytes) / ITERATIONS
+                  << std::setw(10) << elapsed.count() / ITERATIONS << " ns\n";
+    };
+    auto n = std::to_string(ITERATIONS);
+    std::cout << "loop (per iteration)  mallocs    GC bytes      time\n";
+    measure("lambda/2", "(loop-add " + n + " 0)");
+    measure("lambda/6", "(loop-add6 " + n + " 0)");
+    measure("let", "(loop-let " + n + ")");
+    measure("builtin", "(loop-builtin " + n + ")");
+    measure("apply", "(loop-apply " + n + ")");
+    measure("closure", "(loop-capture " + n + ")");
+}
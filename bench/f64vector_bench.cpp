@@ -0,0 +1,73 @@
+// Cost of summing a million doubles: reducing a list of boxed numbers with `+`
+// one element at a time, against f64vector-sum, and the sum kernel of each
+// version the processor supports called directly.
+
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../src/eval_env.h"
+#include "../src/f64vector.h"
+#include "../src/gc.h"
+#include "../src/reader.h"
+#include "../src/tokenizer.h"
+
+namespace {
+
+constexpr int SIZE = 1000000;
+constexpr int ROUNDS = 20;
+
+ValuePtr evalAll(EvaluateEnv* env, const std::string& source) {
+    std::deque<TokenPtr> tokens;
+    for (auto&& token : Tokenizer::tokenize(source)) {
+        tokens.push_back(std::move(token));
+    }
+    Reader reader(tokens);
+    ValuePtr result;
+    while (!tokens.empty()) {
+        result = env->eval(reader.read());
+    }
+    return result;
+}
+
+template <typename F>
+void measure(const char* name, F sum) {
+    double result = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        result = sum();
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << elapsed.count() / ROUNDS << " ms"
+              << std::setprecision(1) << std::setw(18) << result << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GcHeap::registerStack(&argc);
+    auto env = EvaluateEnv::createGlobal();
+    GcRoot envRoot(env);
+    auto n = std::to_string(SIZE);
+    evalAll(env, R"(
+        (define (halves i acc)
+          (if (= i 0) acc (halves (- i 1) (cons (* 0.5 i) acc))))
+        (define numbers (halves )" + n + R"( '()))
+        (define packed (list->f64vector numbers))
+    )");
+
+    std::cout << "sum of 1e6 doubles          time            result\n";
+    measure("(reduce + list)", [&] { return evalAll(env, "(reduce + numbers)").asNumber(); });
+    measure("(apply + list)", [&] { return evalAll(env, "(apply + numbers)").asNumber(); });
+    measure("(f64vector-sum v)", [&] { return evalAll(env, "(f64vector-sum packed)").asNumber(); });
+    auto&& packed = static_cast<const F64VectorValue&>(*evalAll(env, "packed"));
+    for (auto kernels : F64Kernels::available()) {
+        auto name = std::string("kernel ") + kernels->name;
+        measure(name.c_str(), [&] {
+            return kernels->sum(packed.getElements().data(), packed.size());
+        });
+    }
+}
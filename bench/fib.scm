@@ -0,0 +1,6 @@
+;;; Naive doubly-recursive Fibonacci; dominated by arithmetic and calls.
+(define (fib n)
+  (if (< n 2)
+      n
+      (+ (fib (- n 1)) (fib (- n 2)))))
+(displayln (fib 30))
@@ -0,0 +1,14 @@
+;;; Hash tables: fill a table with a million entries, then look every key up.
+(define n 1000000)
+(define table (make-hash-table))
+(define (fill i)
+  (if (< i n)
+      (begin (hash-set! table i (* 2 i))
+             (fill (+ i 1)))))
+(define (lookup i sum)
+  (if (< i n)
+      (lookup (+ i 1) (+ sum (hash-ref table i)))
+      sum))
+(fill 0)
+(displayln (hash-count table))
+(displayln (lookup 0 0))
@@ -0,0 +1,20 @@
+;;; List construction: build, filter, append and sort lists repeatedly.
+(define (range a b)
+  (if (>= a b)
+      '()
+      (cons a (range (+ a 1) b))))
+(define (my-sort l)
+  (if (null? l)
+      '()
+      (let ((pivot (car l))
+            (rest (cdr l)))
+        (append (my-sort (filter (lambda (x) (< x pivot)) rest))
+                (list pivot)
+                (my-sort (filter (lambda (x) (>= x pivot)) rest))))))
+(define (scramble l) (map (lambda (x) (modulo (* x 7919) 1009)) l))
+(define (repeat n)
+  (if (> n 0)
+      (begin (my-sort (scramble (range 0 1000)))
+             (repeat (- n 1)))))
+(repeat 40)
+(displayln (length (my-sort (scramble (range 0 1000)))))
@@ -0,0 +1,85 @@
+// Cost of the hot type predicates: the inline type tag in ValuePtr against the
+// typeid comparisons they replaced.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <typeinfo>
+
+#include "../src/builtins.h"
+#include "../src/gc.h"
+#include "../src/value.h"
+
+namespace {
+
+constexpr int ROUNDS = 20000;
+
+bool typeidIsPair(const ValuePtr& v) {
+    auto object = v.get();
+    return object && typeid(*object) == typeid(PairValue);
+}
+
+bool typeidIsSymbol(const ValuePtr& v) {
+    auto object = v.get();
+    return object && typeid(*object) == typeid(IdentifierValue);
+}
+
+bool typeidIsString(const ValuePtr& v) {
+    auto object = v.get();
+    return object && typeid(*object) == typeid(StringValue);
+}
+
+bool typeidIsProcedure(const ValuePtr& v) {
+    auto object = v.get();
+    return object && (typeid(*object) == typeid(BuiltinProcValue) ||
+                      typeid(*object) == typeid(LambdaValue));
+}
+
+bool typeidIsAtom(const ValuePtr& v) {
+    return v.isNil() || typeidIsSymbol(v) || v.isBoolean() || v.isNumber() || typeidIsString(v);
+}
+
+template <typename F>
+double nanosPerCheck(const ValueVector& values, F check) {
+    long hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        for (auto& v : values) {
+            hits += check(v);
+        }
+        asm volatile("" : "+r"(hits));
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (double(ROUNDS) * values.size());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    GcHeap::registerStack(&argc);
+    ValueVector values;
+    for (int i = 0; i < 256; i++) {
+        switch (i % 7) {
+            case 0: values.push_back(Value::fromNumber(i)); break;
+            case 1: values.push_back(Value::nil()); break;
+            case 2: values.push_back(Value::fromBoolean(i % 2)); break;
+            case 3: values.push_back(makeValue<PairValue>(Value::nil(), Value::nil())); break;
+            case 4: values.push_back(IdentifierValue::intern("sym" + std::to_string(i))); break;
+            case 5: values.push_back(makeValue<StringValue>("str")); break;
+            case 6: values.push_back(makeValue<BuiltinProcValue>(BUILTINS.at("car"))); break;
+        }
+    }
+
+    auto report = [&](const char* name, auto tagged, auto rtti) {
+        auto tagNs = nanosPerCheck(values, tagged);
+        auto rttiNs = nanosPerCheck(values, rtti);
+        std::cout << std::left << std::setw(13) << name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(8) << tagNs << " ns" << std::setw(8)
+                  << rttiNs << " ns" << std::setw(7) << rttiNs / tagNs << "x\n";
+    };
+    std::cout << "predicate         tag   typeid   speedup\n";
+    report("isPair", [](auto& v) { return v.isPair(); }, typeidIsPair);
+    report("isSymbol", [](auto& v) { return v.isSymbol(); }, typeidIsSymbol);
+    report("isAtom", [](auto& v) { return v.isAtom(); }, typeidIsAtom);
+    report("isProcedure", [](auto& v) { return v.isProcedure(); }, typeidIsProcedure);
+}
@@ -0,0 +1,161 @@
+// Throughput of the lexical scans on inputs of several megabytes, in every
+// version of ScanKernels the processor supports, against the loops they
+// replace: std::isspace and a std::set of delimiters per character, and
+// comments and string bodies read a character at a time.
+
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "../src/char_class.h"
+
+namespace {
+
+constexpr int LINES = 200000;
+constexpr int ROUNDS = 10;
+
+const std::set<char> TOKEN_END{'(', ')', '\'', '`', ',', '"'};
+
+// Indented code, where atoms and runs of whitespace alternate.
+std::string code() {
+    std::ostringstream ss;
+    for (int i = 0; i < LINES; i++) {
+        ss << "(define (accumulate-" << i << " combiner initial sequence)\n"
+           << "        (if (null? sequence) initial\n"
+           << "            (combiner (car sequence)"
+           << " (accumulate combiner initial (cdr sequence)))))\n";
+    }
+    return ss.str();
+}
+
+std::string comments() {
+    std::ostringstream ss;
+    for (int i = 0; i < LINES; i++) {
+        ss << ";; Line " << i << " of a long comment block, as a file header or licence has it.\n";
+    }
+    return ss.str();
+}
+
+std::string strings() {
+    std::ostringstream ss;
+    for (int i = 0; i < LINES; i++) {
+        ss << "\"record " << i << ": a string field of data exported from a spreadsheet row\\n\"\n";
+    }
+    return ss.str();
+}
+
+template <typename F>
+void measure(const std::string& name, const std::string& text, F scan) {
+    std::size_t runs = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        runs = scan(text.data(), text.size());
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    auto seconds = elapsed.count() / ROUNDS;
+    std::cout << std::left << std::setw(26) << name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(8) << seconds * 1000 << " ms" << std::setw(10)
+              << std::setprecision(0) << text.size() / seconds / 1e6 << " MB/s" << std::setw(10)
+              << runs << " runs\n";
+}
+
+// Atoms and whitespace, skipping other delimiters a character at a time; the
+// characters are told apart as the scans do.
+template <bool Legacy, typename Space, typename Atom>
+std::size_t scanCode(const char* text, std::size_t size, Space skipSpace, Atom findEnd) {
+    std::size_t runs = 0;
+    for (std::size_t pos = 0; pos < size; runs++) {
+        auto c = text[pos];
+        if (Legacy ? std::isspace(c) : isSpace(c)) {
+            pos = skipSpace(text, size, pos + 1);
+        } else if (Legacy ? TOKEN_END.contains(c) : isDelimiter(c)) {
+            pos++;
+        } else {
+            pos = findEnd(text, size, pos + 1);
+        }
+    }
+    return runs;
+}
+
+// Each line, as the comment or string literal it holds.
+template <typename Find>
+std::size_t scanLines(const char* text, std::size_t size, Find findEnd) {
+    std::size_t runs = 0;
+    for (std::size_t pos = 0; pos < size; runs++) {
+        pos = findEnd(text, size, pos + 1);
+        // Past the newline, or the closing quote or escape and then the
+        // newline.
+        pos += text[pos] == '\n' ? 1 : 2;
+    }
+    return runs;
+}
+
+std::size_t legacySpace(const char* text, std::size_t size, std::size_t pos) {
+    while (pos < size && std::isspace(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+std::size_t legacyAtom(const char* text, std::size_t size, std::size_t pos) {
+    while (pos < size && !std::isspace(text[pos]) && !TOKEN_END.contains(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+std::size_t legacyNewline(const char* text, std::size_t size, std::size_t pos) {
+    while (pos < size && text[pos] != '\n') {
+        pos++;
+    }
+    return pos;
+}
+
+std::size_t legacyStringEnd(const char* text, std::size_t size, std::size_t pos) {
+    while (pos < size && text[pos] != '"' && text[pos] != '\\') {
+        pos++;
+    }
+    return pos;
+}
+
+}  // namespace
+
+int main() {
+    auto codeText = code();
+    auto commentText = comments();
+    auto stringText = strings();
+    std::cout << "code " << codeText.size() / 1e6 << " MB, comments " << commentText.size() / 1e6
+              << " MB, strings " << stringText.size() / 1e6 << " MB\n";
+
+    measure("code, per character", codeText, [](const char* text, std::size_t size) {
+        return scanCode<true>(text, size, legacySpace, legacyAtom);
+    });
+    for (auto kernels : ScanKernels::available()) {
+        measure(std::string("code, ") + kernels->name, codeText,
+                [&](const char* text, std::size_t size) {
+                    return scanCode<false>(text, size, kernels->skipSpace, kernels->findDelimiter);
+                });
+    }
+    measure("comments, per character", commentText, [](const char* text, std::size_t size) {
+        return scanLines(text, size, legacyNewline);
+    });
+    for (auto kernels : ScanKernels::available()) {
+        measure(std::string("comments, ") + kernels->name, commentText,
+                [&](const char* text, std::size_t size) {
+                    return scanLines(text, size, kernels->findNewline);
+                });
+    }
+    measure("strings, per character", stringText, [](const char* text, std::size_t size) {
+        return scanLines(text, size, legacyStringEnd);
+    });
+    for (auto kernels : ScanKernels::available()) {
+        measure(std::string("strings, ") + kernels->name, stringText,
+                [&](const char* text, std::size_t size) {
+                    return scanLines(text, size, kernels->findStringEnd);
+                });
+    }
+}
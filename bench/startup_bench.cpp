@@ -0,0 +1,63 @@
+// Startup time of a program that only defines things, as a library loaded
+// before the work starts would: loading the source file, which reads and
+// compiles every form, against running the image compiled from it, which maps
+// the file and builds the prototypes. Each round runs the whole program in a
+// fresh global environment.
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../src/gc.h"
+#include "../src/image.h"
+#include "../src/repl.h"
+
+namespace {
+
+constexpr int FORMS = 20000;
+constexpr int ROUNDS = 5;
+
+std::string generateSource() {
+    std::ostringstream ss;
+    for (int i = 0; i < FORMS; i++) {
+        ss << "(define (step-" << i << " x)  ; step " << i << "\n"
+           << "  (if (< x " << i << ") (+ x 1.5) (cons 'done (step-" << i << " (- x 1)))))\n"
+           << "(define row-" << i << " '(" << i << " " << i * 7 << " -" << i % 97
+           << " 0.25 \"name-" << i << "\" #t #f sym-" << i << "))\n";
+    }
+    return ss.str();
+}
+
+template <typename F>
+void measure(const char* name, F runOnce) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        runOnce();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(22) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << elapsed.count() / ROUNDS * 1000
+              << " ms\n";
+}
+
+}  // namespace
+
+int main(int argc, char**) {
+    GcHeap::registerStack(&argc);
+    auto directory = std::filesystem::temp_directory_path();
+    auto source = directory / "mini_lisp_startup_bench.scm";
+    auto image = directory / "mini_lisp_startup_bench.img";
+    std::ofstream(source, std::ios::binary) << generateSource();
+
+    measure("Compiling the image", [&] { compileImage(source.c_str(), image.c_str()); });
+    std::cout << std::filesystem::file_size(source) / 1e6 << " MB of source, "
+              << std::filesystem::file_size(image) / 1e6 << " MB of image\n";
+    measure("Loading the source", [&] { loadFile(source.c_str()); });
+    measure("Running the image", [&] { runImage(image.c_str()); });
+    std::filesystem::remove(source);
+    std::filesystem::remove(image);
+}
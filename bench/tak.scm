@@ -0,0 +1,8 @@
+;;; Takeuchi function; dominated by comparisons and calls.
+(define (tak x y z)
+  (if (not (< y x))
+      z
+      (tak (tak (- x 1) y z)
+           (tak (- y 1) z x)
+           (tak (- z 1) x y))))
+(displayln (tak 24 16 8))
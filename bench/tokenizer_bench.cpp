@@ -0,0 +1,83 @@
+// Tokenizing throughput on a generated source file of several megabytes:
+// Tokenizer line by line, as files were loaded before, and on the whole text,
+// against Lexemes scanning a memory-mapped file, with and without making the
+// Tokens a Reader takes from each lexeme.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../src/lexer.h"
+#include "../src/source_file.h"
+#include "../src/tokenizer.h"
+
+namespace {
+
+constexpr int FORMS = 100000;
+constexpr int ROUNDS = 5;
+
+// Definitions and data in about equal parts, like a generated data file with
+// some code around it.
+std::string generateSource() {
+    std::ostringstream ss;
+    for (int i = 0; i < FORMS; i++) {
+        ss << "(define (step-" << i << " x)  ; step " << i << "\n"
+           << "  (if (< x " << i << ") (+ x 1.5) (cons 'done x)))\n"
+           << "(define row-" << i << " '(" << i << " " << i * 7 << " -" << i % 97
+           << " 0.25 \"name-" << i << "\" \"say \\\"hi\\\"\" #t #f sym-" << i << "))\n";
+    }
+    return ss.str();
+}
+
+template <typename F>
+void measure(const char* name, F tokenizeOnce) {
+    std::size_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) {
+        count = tokenizeOnce();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    auto seconds = elapsed.count() / ROUNDS;
+    std::cout << std::left << std::setw(26) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << seconds * 1000 << " ms"
+              << std::setw(14) << count / seconds / 1e6 << " M tokens/s\n";
+}
+
+}  // namespace
+
+int main() {
+    auto source = generateSource();
+    auto path = std::filesystem::temp_directory_path() / "mini_lisp_tokenizer_bench.scm";
+    std::ofstream(path, std::ios::binary) << source;
+    std::cout << source.size() / 1e6 << " MB of source\n";
+
+    measure("Tokenizer, by line", [&] {
+        std::ifstream file(path);
+        std::string line;
+        std::size_t count = 0;
+        while (std::getline(file, line)) {
+            count += Tokenizer::tokenize(line).size();
+        }
+        return count;
+    });
+    measure("Tokenizer, whole text", [&] { return Tokenizer::tokenize(source).size(); });
+    measure("Lexemes, mapped file", [&] {
+        SourceFile file(path.c_str());
+        return Lexemes(file.getText()).get().size();
+    });
+    measure("Lexemes, then Tokens", [&] {
+        SourceFile file(path.c_str());
+        Lexemes lexemes(file.getText());
+        std::size_t count = 0;
+        for (auto&& lexeme : lexemes.get()) {
+            count += lexemes.toToken(lexeme) != nullptr;
+        }
+        return count;
+    });
+    std::filesystem::remove(path);
+}
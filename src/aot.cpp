@@ -0,0 +1,136 @@
+#include "./aot.h"
+
+#include <bit>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./builtins.h"
+#include "./gc.h"
+#include "./vm.h"
+
+// Builds the values and prototypes of a compiled program. Each top-level form
+// is loaded just before it runs, which is when the REPL would compile it.
+class ProgramLoader {
+private:
+    const AotProgram& program;
+    EvaluateEnv* env;
+    std::vector<SymbolId> names;
+    ValueVector values;
+    // Prototypes of the form being loaded, until it has hold of them.
+    std::vector<Prototype*, GcRootAllocator<Prototype*>> protos;
+
+    ValuePtr makeConstant(const AotValue& value) {
+        switch (value.type) {
+            case ValueType::NIL: return Value::nil();
+            case ValueType::BOOLEAN: return Value::fromBoolean(value.bits);
+            case ValueType::NUMBER:
+                return value.text.empty() ? Value::fromNumber(std::bit_cast<double>(value.bits))
+                                          : parseInteger(value.text);
+            case ValueType::SYMBOL: return IdentifierValue::intern(std::string(value.text));
+            case ValueType::STRING: return makeValue<StringValue>(std::string(value.text));
+            case ValueType::PAIR:
+                return makeValue<PairValue>(values[value.car], values[value.cdr]);
+            case ValueType::VECTOR: return makeValue<VectorValue>(values[value.car].toVector());
+            case ValueType::BUILTIN_PROC:
+                return makeValue<BuiltinProcValue>(BUILTINS.at(std::string(value.text)));
+            default: throw LispError("Unsupported constant in compiled program");
+        }
+    }
+
+    Prototype* load(std::uint32_t index) {
+        auto&& image = program.prototypes[index];
+        auto proto = new Prototype(image.paramCount, image.frameSize);
+        protos.push_back(proto);
+        proto->code.assign(image.code.begin(), image.code.end());
+        for (auto [offset, name] : image.names) {
+            proto->code[offset] = names[name];
+        }
+        for (auto constant : image.constants) {
+            proto->constants.push_back(values[constant]);
+        }
+        for (auto nested : image.protos) {
+            proto->protos.push_back(load(nested));
+        }
+        proto->caches.resize(image.cacheCount);
+        proto->maxStack = image.maxStack;
+        proto->heapFrame = image.heapFrame;
+        if (image.native) {
+            proto->native = std::make_unique<NativeCode>(image.native);
+        }
+        prepareGuards(proto);
+        return proto;
+    }
+
+    // The compiler folded calls in the form assuming the stock builtins; if an
+    // earlier form has redefined one, the guard is set to take the fallback
+    // at once, as if the call had not been folded.
+    void prepareGuards(Prototype* proto) {
+        auto&& code = proto->code;
+        for (std::size_t pc = 0; pc < code.size(); pc += 1 + operandCount(code[pc])) {
+            if (static_cast<OpCode>(code[pc]) != OpCode::GUARD) {
+                continue;
+            }
+            auto name = code[pc + 1];
+            auto binding = env->findBinding(name);
+            auto value = binding->value;
+            auto stock = value.getType() == ValueType::BUILTIN_PROC &&
+                         static_cast<const BuiltinProcValue*>(value.get())->getFunc() ==
+                             BUILTINS.at(IdentifierValue::nameOf(name));
+            proto->caches[code[pc + 2]] = {binding, stock ? binding->version : binding->version - 1,
+                                           true};
+        }
+    }
+
+public:
+    ProgramLoader(const AotProgram& program, EvaluateEnv* env) : program{program}, env{env} {
+        for (auto name : program.names) {
+            names.push_back(IdentifierValue::idOf(std::string(name)));
+        }
+        for (auto&& value : program.values) {
+            values.push_back(makeConstant(value));
+        }
+    }
+
+    Prototype* loadStep(const AotStep& step) {
+        protos.clear();
+        return load(step.proto);
+    }
+};
+
+void runProgram(const AotProgram& program) {
+    auto env = EvaluateEnv::createGlobal();
+    GcRoot envRoot(env);
+    try {
+        ProgramLoader loader(program, env);
+        for (auto&& step : program.steps) {
+            if (step.error) {
+                throw LispError(step.error);
+            }
+            execute(loader.loadStep(step), env);
+        }
+    } catch (std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+}
+
+std::vector<std::uint32_t> nameOperands(const Prototype* proto) {
+    std::vector<std::uint32_t> offsets;
+    auto code = proto->getCode();
+    for (std::uint32_t pc = 0; pc < proto->getCodeSize(); pc += 1 + operandCount(code[pc])) {
+        switch (static_cast<OpCode>(code[pc])) {
+            case OpCode::GLOBAL:
+            case OpCode::GUARD: offsets.push_back(pc + 1); break;
+            case OpCode::LOCAL:
+            case OpCode::LOCAL_CONST: offsets.push_back(pc + 2); break;
+            case OpCode::LOCAL_UP:
+            case OpCode::CALL_PRIMITIVE: offsets.push_back(pc + 3); break;
+            case OpCode::LOCAL_LOCAL:
+                offsets.push_back(pc + 2);
+                offsets.push_back(pc + 4);
+                break;
+            default: break;
+        }
+    }
+    return offsets;
+}
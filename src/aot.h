@@ -0,0 +1,97 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "./bytecode.h"
+#include "./error.h"
+#include "./eval_env.h"
+#include "./jit.h"
+#include "./number.h"
+#include "./value.h"
+
+// The tables mini_lisp_aot writes for a program: its top-level forms compiled
+// to bytecode, with the C++ it translated the bytecode into. Symbol ids differ
+// between processes, so names are stored as text and patched in on loading.
+
+// A value of the constant pools. Pairs refer to values before them, and
+// vectors to the list of their elements, as `car`.
+struct AotValue {
+    ValueType type;
+    std::uint64_t bits;     // a flonum NUMBER, or BOOLEAN 0/1
+    std::string_view text;  // SYMBOL, STRING, an exact NUMBER, or the name of a BUILTIN_PROC
+    std::uint32_t car;
+    std::uint32_t cdr;
+};
+
+// A code operand that is the symbol id of AotProgram::names[name].
+struct AotName {
+    std::uint32_t offset;
+    std::uint32_t name;
+};
+
+struct AotPrototype {
+    std::span<const std::uint32_t> code;
+    std::span<const AotName> names;
+    std::span<const std::uint32_t> constants;  // indices into AotProgram::values
+    std::span<const std::uint32_t> protos;     // indices into AotProgram::prototypes
+    std::uint32_t cacheCount;
+    std::uint32_t paramCount;
+    std::uint32_t frameSize;
+    std::uint32_t maxStack;
+    bool heapFrame;
+    NativeCode::Entry native;
+};
+
+// A top-level form, or the error its reading or compiling raised.
+struct AotStep {
+    std::uint32_t proto;
+    const char* error;
+};
+
+struct AotProgram {
+    std::span<const std::string_view> names;
+    std::span<const AotValue> values;
+    std::span<const AotPrototype> prototypes;
+    std::span<const AotStep> steps;
+};
+
+// Runs the forms in order in a fresh global environment, stopping at the first
+// error, as loadFile does.
+void runProgram(const AotProgram& program);
+
+// The offsets of the operands in the code of `proto` that are symbol ids, which
+// a compiled program stores as AotNames.
+std::vector<std::uint32_t> nameOperands(const Prototype* proto);
+
+// Used by the generated code, which works on the VM's frame and stack like
+// JIT-compiled code does.
+
+inline std::uint32_t aotResume(JitFrame* frame, ValuePtr* sp, std::uint32_t pc) {
+    frame->sp = sp;
+    frame->pc = pc;
+    return static_cast<std::uint32_t>(JitExit::RESUME);
+}
+
+inline bool aotNumbers(const ValuePtr* sp) {
+    return sp[-2].isNumber() && sp[-1].isNumber();
+}
+
+inline bool aotStock(const GlobalCache& cache) {
+    return cache.binding && cache.version == cache.binding->version && cache.stock;
+}
+
+// Whether a tail call of `callee` starts the running code over, see JitFrame.
+inline bool aotSelfCall(const JitFrame* frame, ValuePtr callee, std::size_t argc) {
+    if (callee.getType() != ValueType::LAMBDA) {
+        return false;
+    }
+    auto lambda = static_cast<const LambdaValue*>(callee.get());
+    return lambda->getProto() == frame->proto && lambda->getEnv() == frame->env &&
+           argc == frame->proto->getParamCount();
+}
+
+#endif
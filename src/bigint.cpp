@@ -0,0 +1,299 @@
+#include "./bigint.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace {
+
+constexpr std::uint64_t LIMB_BASE{std::uint64_t{1} << 32};
+constexpr std::uint32_t DECIMAL_CHUNK{1'000'000'000};
+constexpr int DECIMAL_CHUNK_DIGITS{9};
+constexpr int HEX_CHUNK_DIGITS{8};
+
+}  // namespace
+
+BigInt::BigInt(std::int64_t value) : negative{value < 0} {
+    // Negated as unsigned, so that the most negative value has a magnitude.
+    auto magnitude =
+        negative ? ~static_cast<std::uint64_t>(value) + 1 : static_cast<std::uint64_t>(value);
+    for (; magnitude; magnitude >>= 32) {
+        limbs.push_back(static_cast<std::uint32_t>(magnitude));
+    }
+}
+
+void BigInt::trim() {
+    while (!limbs.empty() && limbs.back() == 0) {
+        limbs.pop_back();
+    }
+    if (limbs.empty()) {
+        negative = false;
+    }
+}
+
+BigInt BigInt::parse(std::string_view text, int radix) {
+    BigInt result;
+    bool negative = !text.empty() && text[0] == '-';
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        text.remove_prefix(1);
+    }
+    // As many digits at a time as fit in a limb.
+    auto chunkDigits = radix == 16 ? HEX_CHUNK_DIGITS : DECIMAL_CHUNK_DIGITS;
+    while (!text.empty()) {
+        auto length = std::min<std::size_t>(text.size(), chunkDigits);
+        std::uint64_t chunk = 0;
+        std::uint64_t scale = 1;
+        for (std::size_t i = 0; i < length; i++) {
+            auto c = text[i];
+            chunk = chunk * radix + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+            scale *= radix;
+        }
+        text.remove_prefix(length);
+        std::uint64_t carry = chunk;
+        for (auto&& limb : result.limbs) {
+            auto product = limb * scale + carry;
+            limb = static_cast<std::uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry) {
+            result.limbs.push_back(static_cast<std::uint32_t>(carry));
+        }
+    }
+    result.negative = negative;
+    result.trim();
+    return result;
+}
+
+std::optional<std::int64_t> BigInt::toInt64() const {
+    if (limbs.size() > 2) {
+        return std::nullopt;
+    }
+    std::uint64_t magnitude = 0;
+    for (std::size_t i = limbs.size(); i-- > 0;) {
+        magnitude = magnitude << 32 | limbs[i];
+    }
+    constexpr auto LIMIT = std::uint64_t{1} << 63;
+    if (negative ? magnitude > LIMIT : magnitude >= LIMIT) {
+        return std::nullopt;
+    }
+    return negative ? static_cast<std::int64_t>(~magnitude + 1)
+                    : static_cast<std::int64_t>(magnitude);
+}
+
+double BigInt::toDouble() const {
+    double result = 0;
+    for (std::size_t i = limbs.size(); i-- > 0;) {
+        result = result * static_cast<double>(LIMB_BASE) + limbs[i];
+    }
+    return negative ? -result : result;
+}
+
+std::uint32_t BigInt::divideSmall(std::uint32_t divisor) {
+    std::uint64_t remainder = 0;
+    for (std::size_t i = limbs.size(); i-- > 0;) {
+        auto current = remainder << 32 | limbs[i];
+        limbs[i] = static_cast<std::uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    trim();
+    return static_cast<std::uint32_t>(remainder);
+}
+
+std::string BigInt::toString() const {
+    if (isZero()) {
+        return "0";
+    }
+    std::vector<std::uint32_t> chunks;
+    auto magnitude = *this;
+    while (!magnitude.isZero()) {
+        chunks.push_back(magnitude.divideSmall(DECIMAL_CHUNK));
+    }
+    std::string result = negative ? "-" : "";
+    result += std::to_string(chunks.back());
+    for (std::size_t i = chunks.size() - 1; i-- > 0;) {
+        auto digits = std::to_string(chunks[i]);
+        result.append(DECIMAL_CHUNK_DIGITS - digits.size(), '0');
+        result += digits;
+    }
+    return result;
+}
+
+std::strong_ordering BigInt::compareMagnitude(const BigInt& a, const BigInt& b) {
+    if (a.limbs.size() != b.limbs.size()) {
+        return a.limbs.size() <=> b.limbs.size();
+    }
+    for (std::size_t i = a.limbs.size(); i-- > 0;) {
+        if (a.limbs[i] != b.limbs[i]) {
+            return a.limbs[i] <=> b.limbs[i];
+        }
+    }
+    return std::strong_ordering::equal;
+}
+
+std::strong_ordering operator<=>(const BigInt& a, const BigInt& b) {
+    if (a.negative != b.negative) {
+        return a.negative ? std::strong_ordering::less : std::strong_ordering::greater;
+    }
+    return a.negative ? BigInt::compareMagnitude(b, a) : BigInt::compareMagnitude(a, b);
+}
+
+BigInt BigInt::addMagnitude(const BigInt& a, const BigInt& b) {
+    auto&& longer = a.limbs.size() >= b.limbs.size() ? a.limbs : b.limbs;
+    auto&& shorter = a.limbs.size() >= b.limbs.size() ? b.limbs : a.limbs;
+    BigInt result;
+    result.limbs.resize(longer.size() + 1);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < longer.size(); i++) {
+        auto sum = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        result.limbs[i] = static_cast<std::uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    result.limbs.back() = static_cast<std::uint32_t>(carry);
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::subMagnitude(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    result.limbs.resize(a.limbs.size());
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < a.limbs.size(); i++) {
+        auto difference = static_cast<std::int64_t>(a.limbs[i]) - borrow -
+                          (i < b.limbs.size() ? b.limbs[i] : 0);
+        borrow = difference < 0;
+        result.limbs[i] = static_cast<std::uint32_t>(difference + (borrow ? LIMB_BASE : 0));
+    }
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::operator-() const {
+    auto result = *this;
+    result.negative = !negative && !isZero();
+    return result;
+}
+
+BigInt operator+(const BigInt& a, const BigInt& b) {
+    if (a.negative == b.negative) {
+        auto result = BigInt::addMagnitude(a, b);
+        result.negative = a.negative && !result.isZero();
+        return result;
+    }
+    // The sign is that of the operand with the larger magnitude.
+    if (BigInt::compareMagnitude(a, b) >= 0) {
+        auto result = BigInt::subMagnitude(a, b);
+        result.negative = a.negative && !result.isZero();
+        return result;
+    } else {
+        auto result = BigInt::subMagnitude(b, a);
+        result.negative = b.negative && !result.isZero();
+        return result;
+    }
+}
+
+BigInt operator-(const BigInt& a, const BigInt& b) {
+    return a + -b;
+}
+
+BigInt operator*(const BigInt& a, const BigInt& b) {
+    BigInt result;
+    if (a.isZero() || b.isZero()) {
+        return result;
+    }
+    result.limbs.resize(a.limbs.size() + b.limbs.size());
+    for (std::size_t i = 0; i < a.limbs.size(); i++) {
+        std::uint64_t carry = 0;
+        for (std::size_t j = 0; j < b.limbs.size(); j++) {
+            auto product = std::uint64_t{a.limbs[i]} * b.limbs[j] + result.limbs[i + j] + carry;
+            result.limbs[i + j] = static_cast<std::uint32_t>(product);
+            carry = product >> 32;
+        }
+        result.limbs[i + b.limbs.size()] = static_cast<std::uint32_t>(carry);
+    }
+    result.negative = a.negative != b.negative;
+    result.trim();
+    return result;
+}
+
+// Knuth's algorithm D (TAOCP 4.3.1), as in Hacker's Delight's divmnu.
+std::pair<BigInt, BigInt> BigInt::divide(const BigInt& dividend, const BigInt& divisor) {
+    BigInt quotient;
+    BigInt remainder;
+    if (compareMagnitude(dividend, divisor) < 0) {
+        remainder = dividend;
+        return {quotient, remainder};
+    }
+    if (divisor.limbs.size() == 1) {
+        quotient = dividend;
+        quotient.negative = false;
+        remainder = BigInt(static_cast<std::int64_t>(quotient.divideSmall(divisor.limbs[0])));
+    } else {
+        auto&& u = dividend.limbs;
+        auto&& v = divisor.limbs;
+        auto m = u.size();
+        auto n = v.size();
+        // Normalize so that the divisor's top limb has its high bit set.
+        auto shift = std::countl_zero(v.back());
+        auto shifted = [shift](std::uint32_t high, std::uint32_t low) {
+            return static_cast<std::uint32_t>(std::uint64_t{high} << shift |
+                                              std::uint64_t{low} >> (32 - shift));
+        };
+        std::vector<std::uint32_t> vn(n);
+        for (std::size_t i = n - 1; i > 0; i--) {
+            vn[i] = shifted(v[i], v[i - 1]);
+        }
+        vn[0] = v[0] << shift;
+        std::vector<std::uint32_t> un(m + 1);
+        un[m] = static_cast<std::uint32_t>(std::uint64_t{u[m - 1]} >> (32 - shift));
+        for (std::size_t i = m - 1; i > 0; i--) {
+            un[i] = shifted(u[i], u[i - 1]);
+        }
+        un[0] = u[0] << shift;
+
+        quotient.limbs.resize(m - n + 1);
+        for (std::size_t j = m - n + 1; j-- > 0;) {
+            auto top = std::uint64_t{un[j + n]} << 32 | un[j + n - 1];
+            auto qhat = top / vn[n - 1];
+            auto rhat = top % vn[n - 1];
+            while (qhat >= LIMB_BASE || qhat * vn[n - 2] > (rhat << 32 | un[j + n - 2])) {
+                qhat--;
+                rhat += vn[n - 1];
+                if (rhat >= LIMB_BASE) {
+                    break;
+                }
+            }
+            std::int64_t borrow = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                auto product = qhat * vn[i];
+                auto t = static_cast<std::int64_t>(un[i + j]) - borrow -
+                         static_cast<std::int64_t>(product & 0xFFFF'FFFF);
+                un[i + j] = static_cast<std::uint32_t>(t);
+                borrow = static_cast<std::int64_t>(product >> 32) - (t >> 32);
+            }
+            auto t = static_cast<std::int64_t>(un[j + n]) - borrow;
+            un[j + n] = static_cast<std::uint32_t>(t);
+            if (t < 0) {
+                // qhat was one too large; add the divisor back.
+                qhat--;
+                std::uint64_t carry = 0;
+                for (std::size_t i = 0; i < n; i++) {
+                    auto sum = std::uint64_t{un[i + j]} + vn[i] + carry;
+                    un[i + j] = static_cast<std::uint32_t>(sum);
+                    carry = sum >> 32;
+                }
+                un[j + n] += static_cast<std::uint32_t>(carry);
+            }
+            quotient.limbs[j] = static_cast<std::uint32_t>(qhat);
+        }
+        remainder.limbs.resize(n);
+        for (std::size_t i = 0; i < n; i++) {
+            remainder.limbs[i] = static_cast<std::uint32_t>(
+                std::uint64_t{un[i]} >> shift | std::uint64_t{un[i + 1]} << (32 - shift));
+        }
+    }
+    quotient.negative = dividend.negative != divisor.negative;
+    quotient.trim();
+    remainder.negative = dividend.negative;
+    remainder.trim();
+    return {quotient, remainder};
+}
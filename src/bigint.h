@@ -0,0 +1,60 @@
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <compare>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// An arbitrary-precision integer: a sign and a magnitude in base 2^32 limbs,
+// least significant first. The magnitude has no leading zero limbs, and zero
+// has no limbs and is not negative, so equal values are equal objects.
+class BigInt {
+private:
+    std::vector<std::uint32_t> limbs;
+    bool negative{false};
+
+    void trim();
+    static std::strong_ordering compareMagnitude(const BigInt& a, const BigInt& b);
+    // |a| + |b| and |a| - |b|, the latter for |a| >= |b|.
+    static BigInt addMagnitude(const BigInt& a, const BigInt& b);
+    static BigInt subMagnitude(const BigInt& a, const BigInt& b);
+    // Divides the magnitude by `divisor` in place, returning the remainder.
+    std::uint32_t divideSmall(std::uint32_t divisor);
+
+public:
+    BigInt() = default;
+    explicit BigInt(std::int64_t value);
+
+    // Digits in `radix`, 10 or 16, optionally signed.
+    static BigInt parse(std::string_view text, int radix = 10);
+
+    bool isZero() const {
+        return limbs.empty();
+    }
+    bool isNegative() const {
+        return negative;
+    }
+    bool isOdd() const {
+        return !limbs.empty() && (limbs[0] & 1);
+    }
+    std::optional<std::int64_t> toInt64() const;
+    double toDouble() const;
+    std::string toString() const;
+
+    BigInt operator-() const;
+    friend BigInt operator+(const BigInt& a, const BigInt& b);
+    friend BigInt operator-(const BigInt& a, const BigInt& b);
+    friend BigInt operator*(const BigInt& a, const BigInt& b);
+    // Quotient and remainder of truncating division, as of / and % on C++
+    // integers. `divisor` must not be zero.
+    static std::pair<BigInt, BigInt> divide(const BigInt& dividend, const BigInt& divisor);
+
+    friend bool operator==(const BigInt& a, const BigInt& b) = default;
+    friend std::strong_ordering operator<=>(const BigInt& a, const BigInt& b);
+};
+
+#endif
@@ -1,17 +1,308 @@
 #ifndef BUILTINS_H
 #define BUILTINS_H
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
-#include <limits>
+#include <unordered_set>
 
+#include "./error.h"
+#include "./f64vector.h"
+#include "./hash_table.h"
 #include "./value.h"
 
 
-void checkArgsCount(const std::vector<ValuePtr>& args, std::size_t min,
+void checkArgsCount(ArgSpan args, std::size_t min,
                     std::size_t max = std::numeric_limits<std::size_t>::max());
 
+// A number argument of a typed builtin; see number.h for the operations on it.
+struct Number {
+    ValuePtr value;
+
+    // Throws unless `value` is a number.
+    static Number check(ValuePtr value) {
+        if (!value.isNumber()) [[unlikely]] {
+            notNumber(value);
+        }
+        return {value};
+    }
+
+private:
+    [[noreturn]] static void notNumber(ValuePtr value);
+};
+
+// The name of a builtin, as a template argument.
+template <std::size_t N>
+struct BuiltinName {
+    char value[N];
+
+    constexpr BuiltinName(const char (&name)[N]) {
+        std::copy_n(name, N, value);
+    }
+};
+
+namespace detail {
+
+constexpr std::size_t REST_ARGS{std::numeric_limits<std::size_t>::max()};
+
+// How builtin<> passes arguments as each parameter type of a typed builtin:
+// the number of arguments it requires and accepts, and how it takes them.
+template <typename T>
+struct BuiltinParam;
+
+template <>
+struct BuiltinParam<ValuePtr> {
+    static constexpr std::size_t REQUIRED{1};
+    static constexpr std::size_t ACCEPTED{1};
+    static ValuePtr take(ArgSpan args, std::size_t& next, EvaluateEnv&, const char*) {
+        return args[next++];
+    }
+};
+
+template <>
+struct BuiltinParam<Number> {
+    static constexpr std::size_t REQUIRED{1};
+    static constexpr std::size_t ACCEPTED{1};
+    static Number take(ArgSpan args, std::size_t& next, EvaluateEnv&, const char*) {
+        return Number::check(args[next++]);
+    }
+};
+
+// The heap values that typed builtins may take by reference, with the type
+// tag they check and how their error messages name them.
+template <typename T>
+struct HeapParam;
+
+template <>
+struct HeapParam<StringValue> {
+    static constexpr ValueType TYPE{ValueType::STRING};
+    static constexpr const char* NAME{"a string"};
+};
+
+template <>
+struct HeapParam<PairValue> {
+    static constexpr ValueType TYPE{ValueType::PAIR};
+    static constexpr const char* NAME{"a pair"};
+};
+
+template <>
+struct HeapParam<HashTableValue> {
+    static constexpr ValueType TYPE{ValueType::HASH_TABLE};
+    static constexpr const char* NAME{"a hash table"};
+};
+
+template <>
+struct HeapParam<VectorValue> {
+    static constexpr ValueType TYPE{ValueType::VECTOR};
+    static constexpr const char* NAME{"a vector"};
+};
+
+template <>
+struct HeapParam<F64VectorValue> {
+    static constexpr ValueType TYPE{ValueType::F64VECTOR};
+    static constexpr const char* NAME{"an f64vector"};
+};
+
+template <typename T>
+    requires requires { HeapParam<T>::TYPE; }
+struct BuiltinParam<T> {
+    static constexpr std::size_t REQUIRED{1};
+    static constexpr std::size_t ACCEPTED{1};
+    static T& take(ArgSpan args, std::size_t& next, EvaluateEnv&, const char* name) {
+        if (args[next].getType() != HeapParam<T>::TYPE) {
+            throw LispError(std::string(name) + ": argument is not " + HeapParam<T>::NAME);
+        }
+        return static_cast<T&>(*args[next++]);
+    }
+};
+
+template <typename T>
+struct BuiltinParam<std::optional<T>> {
+    static constexpr std::size_t REQUIRED{0};
+    static constexpr std::size_t ACCEPTED{1};
+    static std::optional<T> take(ArgSpan args, std::size_t& next, EvaluateEnv& env,
+                                 const char* name) {
+        if (next == args.size()) {
+            return std::nullopt;
+        }
+        return BuiltinParam<T>::take(args, next, env, name);
+    }
+};
+
+template <>
+struct BuiltinParam<ArgSpan> {
+    static constexpr std::size_t REQUIRED{0};
+    static constexpr std::size_t ACCEPTED{REST_ARGS};
+    static ArgSpan take(ArgSpan args, std::size_t& next, EvaluateEnv&, const char*) {
+        auto rest = args.subspan(next);
+        next = args.size();
+        return rest;
+    }
+};
+
+template <>
+struct BuiltinParam<EvaluateEnv> {
+    static constexpr std::size_t REQUIRED{0};
+    static constexpr std::size_t ACCEPTED{0};
+    static EvaluateEnv& take(ArgSpan, std::size_t&, EvaluateEnv& env, const char*) {
+        return env;
+    }
+};
+
+template <typename T>
+using BuiltinParamOf = BuiltinParam<std::remove_cvref_t<T>>;
+
+template <typename R>
+ValuePtr boxResult(R&& result) {
+    using T = std::remove_cvref_t<R>;
+    if constexpr (std::is_same_v<T, bool>) {
+        return Value::fromBoolean(result);
+    } else if constexpr (std::is_integral_v<T>) {
+        return Value::fromInteger(static_cast<std::int64_t>(result));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return Value::fromNumber(result);
+    } else if constexpr (std::is_same_v<T, Number>) {
+        return result.value;
+    } else {
+        return result;
+    }
+}
+
+// `F` is a template argument, rather than only a function pointer, so that the
+// call of it is direct, and inlined where it is visible.
+template <auto F, typename R, typename... Params>
+ValuePtr callTyped(R (*)(Params...), [[maybe_unused]] const char* name, ArgSpan args,
+                  [[maybe_unused]] EvaluateEnv& env) {
+    constexpr auto required = (std::size_t{0} + ... + BuiltinParamOf<Params>::REQUIRED);
+    constexpr auto accepted = ((BuiltinParamOf<Params>::ACCEPTED == REST_ARGS) || ...)
+                                  ? REST_ARGS
+                                  : (std::size_t{0} + ... + BuiltinParamOf<Params>::ACCEPTED);
+    checkArgsCount(args, required, accepted);
+    [[maybe_unused]] std::size_t next = 0;
+    // Braced initializers run in order, so arguments are taken left to right.
+    std::tuple<Params...> unboxed{BuiltinParamOf<Params>::take(args, next, env, name)...};
+    if constexpr (std::is_void_v<R>) {
+        std::apply(F, std::move(unboxed));
+        return Value::nil();
+    } else {
+        return boxResult(std::apply(F, std::move(unboxed)));
+    }
+}
+
+}  // namespace detail
+
+// A builtin written as a C++ function `F` of its arguments, rather than of an
+// ArgSpan. The checks of the argument count and types, the unboxing of the
+// arguments and the boxing of the result are generated from F's signature,
+// and F remains callable on its own, without them.
+//
+// Parameters may be ValuePtr for any value, Number, references to the values
+// of HeapParam, std::optional of the former for a trailing argument that may be left out,
+// ArgSpan for the rest of the arguments, and EvaluateEnv& for the calling
+// environment, which takes no argument. Results may be ValuePtr, Number,
+// bool, integers, double, or void for nil.
+template <BuiltinName Name, auto F>
+ValuePtr builtin(ArgSpan args, EvaluateEnv& env) {
+    return detail::callTyped<F>(F, Name.value, args, env);
+}
+
+struct BuiltinDef {
+    const char* name;
+    BuiltinFuncType* func;
+    // Whether the result depends on nothing but the arguments, with no
+    // effects, and takes time and space bounded by the size of the arguments,
+    // so that calls on constants may be evaluated by the compiler.
+    bool pure;
+};
+
+template <BuiltinName Name, auto F>
+constexpr BuiltinDef defBuiltin(bool pure = false) {
+    return {Name.value, builtin<Name, F>, pure};
+}
+
 extern const std::unordered_map<std::string, BuiltinFuncType*> BUILTINS;
+// The pure ones, see BuiltinDef.
+extern const std::unordered_set<BuiltinFuncType*> PURE_BUILTINS;
+
+// The typed builtins, which a compiler may call directly. Those below are the
+// pure ones and `apply`.
+namespace builtins {
+
+bool procedureQ(ValuePtr value);
+bool listQ(ValuePtr value);
+bool booleanQ(ValuePtr value);
+bool numberQ(ValuePtr value);
+bool symbolQ(ValuePtr value);
+bool stringQ(ValuePtr value);
+bool nullQ(ValuePtr value);
+bool pairQ(ValuePtr value);
+bool not_(ValuePtr value);
+bool eqQ(ValuePtr a, ValuePtr b);
+bool equalQ(ValuePtr a, ValuePtr b);
+
+std::int64_t length(ValuePtr list);
+ValuePtr cons(ValuePtr car, ValuePtr cdr);
+ValuePtr car(const PairValue& pair);
+ValuePtr cdr(const PairValue& pair);
+
+bool integerQ(Number number);
+ValuePtr add(ArgSpan numbers);
+ValuePtr sub(Number a, std::optional<Number> b);
+ValuePtr mult(ArgSpan numbers);
+ValuePtr div(Number a, std::optional<Number> b);
+ValuePtr expt(Number base, Number exponent);
+ValuePtr abs(Number number);
+ValuePtr quotient(Number a, Number b);
+ValuePtr modulo(Number a, Number b);
+ValuePtr remainder(Number a, Number b);
+bool eq(Number a, Number b);
+bool lt(Number a, Number b);
+bool gt(Number a, Number b);
+bool lteq(Number a, Number b);
+bool gteq(Number a, Number b);
+bool evenQ(Number number);
+bool oddQ(Number number);
+bool zeroQ(Number number);
+
+bool hashTableQ(ValuePtr value);
+
+std::int64_t stringLength(const StringValue& string);
+ValuePtr numberToString(Number number);
+
+bool vectorQ(ValuePtr value);
+std::int64_t vectorLength(const VectorValue& vector);
+
+bool f64vectorQ(ValuePtr value);
+std::int64_t f64vectorLength(const F64VectorValue& vector);
+
+ValuePtr apply(ValuePtr proc, ValuePtr args, EvaluateEnv& env);
+
+}  // namespace builtins
+
+// `apply`; the VM recognizes it to make `(apply proc args)` in tail position
+// a tail call of `proc`.
+inline constexpr BuiltinFuncType* apply = builtin<"apply", builtins::apply>;
+
+// The builtins behind the primitives of CALL_PRIMITIVE, which the VM checks a
+// global against before running it inline.
+inline constexpr BuiltinFuncType* add = builtin<"+", builtins::add>;
+inline constexpr BuiltinFuncType* sub = builtin<"-", builtins::sub>;
+inline constexpr BuiltinFuncType* mult = builtin<"*", builtins::mult>;
+inline constexpr BuiltinFuncType* eq = builtin<"=", builtins::eq>;
+inline constexpr BuiltinFuncType* lt = builtin<"<", builtins::lt>;
+inline constexpr BuiltinFuncType* gt = builtin<">", builtins::gt>;
+inline constexpr BuiltinFuncType* lteq = builtin<"<=", builtins::lteq>;
+inline constexpr BuiltinFuncType* gteq = builtin<">=", builtins::gteq>;
+inline constexpr BuiltinFuncType* car = builtin<"car", builtins::car>;
+inline constexpr BuiltinFuncType* cdr = builtin<"cdr", builtins::cdr>;
+inline constexpr BuiltinFuncType* cons = builtin<"cons", builtins::cons>;
+inline constexpr BuiltinFuncType* nullQ = builtin<"null?", builtins::nullQ>;
 
-#endif
\ No newline at end of file
+#endif
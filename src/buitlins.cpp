@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <iostream>
 #include <limits>
@@ -7,11 +8,13 @@
 #include "./builtins.h"
 #include "./error.h"
 #include "./eval_env.h"
+#include "./gc.h"
+#include "./number.h"
 
 
 namespace rg = std::ranges;
 
-void checkArgsCount(const std::vector<ValuePtr>& args, std::size_t min, std::size_t max) {
+void checkArgsCount(ArgSpan args, std::size_t min, std::size_t max) {
     if (args.size() < min) {
         throw LispError("Too few arguments: " + std::to_string(args.size()) + " < " +
                         std::to_string(min));
@@ -21,384 +24,675 @@ void checkArgsCount(const std::vector<ValuePtr>& args, std::size_t min, std::siz
     }
 }
 
-template <typename... ValPtrs>
-auto extractNumbers(ValPtrs... ptrs) {
-    static_assert((... && std::is_same_v<ValPtrs, ValuePtr>), "Not ValuePtr");
-    return std::tuple{(ptrs->isNumber() ? ptrs->asNumber()
-                                        : throw LispError(ptrs->toString() + " is not number"))...};
+void Number::notNumber(ValuePtr value) {
+    throw LispError(value.toString() + " is not number");
 }
 
-ValuePtr procedureQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isProcedure());
+namespace builtins {
+
+bool procedureQ(ValuePtr value) {
+    return value.isProcedure();
 }
-ValuePtr listQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isList());
+bool listQ(ValuePtr value) {
+    return value.isList();
 }
-ValuePtr booleanQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isBoolean());
+bool booleanQ(ValuePtr value) {
+    return value.isBoolean();
 }
-ValuePtr numberQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isNumber());
+bool numberQ(ValuePtr value) {
+    return value.isNumber();
 }
-ValuePtr symbolQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isSymbol());
+bool symbolQ(ValuePtr value) {
+    return value.isSymbol();
 }
-ValuePtr stringQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isString());
+bool stringQ(ValuePtr value) {
+    return value.isString();
 }
-ValuePtr nullQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isNil());
+bool nullQ(ValuePtr value) {
+    return value.isNil();
 }
 
-ValuePtr not_(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(!args[0]->isTrue());
-}
-ValuePtr eqQ(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 2);
-    auto a = std::move(args[0]);
-    auto b = std::move(args[1]);
-    const auto& rawA = *a;
-    const auto& rawB = *b;
-    if (typeid(rawA) != typeid(rawB)) {
-        return Value::fromBoolean(false);
-    }
-    if (a->isNumber()) {
-        auto aNum = a->asNumber();
-        auto bNum = b->asNumber();
-        return Value::fromBoolean(aNum == bNum);
-    }  else if (a->isBoolean()) {
-        auto aBool = a->asBool();
-        auto bBool = b->asBool();
-        return Value::fromBoolean(aBool == bBool);
-    } else if (a->isSymbol()) {
-        auto aSym = a->getSymbolName();
-        auto bSym = b->getSymbolName();
-        return Value::fromBoolean(*aSym == *bSym);
-    } else if (a->isNil()) {
-        return Value::fromBoolean(true);
+bool not_(ValuePtr value) {
+    return !value.isTrue();
+}
+bool eqQ(ValuePtr a, ValuePtr b) {
+    if (a.isNumber() && b.isNumber()) {
+        return numberCompare(a, b) == 0;
     } else {
-        return Value::fromBoolean(a == b);
-    }
-}
-ValuePtr equalQ(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 2);
-    auto a = std::move(args[0]);
-    auto b = std::move(args[1]);
-    if (a->isPair() && b->isPair()) {
-        auto&& [aCar, aCdr] = a->asPair();
-        auto&& [bCar, bCdr] = b->asPair();
-        auto carResult = equalQ({aCar, bCar}, env);
-        auto cdrResult = equalQ({aCdr, bCdr}, env);
-        return Value::fromBoolean(carResult->isTrue() && cdrResult->isTrue());
-    } else if (a->isString() && b->isString()) {
-        auto&& aStr = a->asString();
-        auto&& bStr = b->asString();
-        return Value::fromBoolean(aStr == bStr);
-    }else {
-        return eqQ(args, env);
-    }
-}
-ValuePtr pairQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    return Value::fromBoolean(args[0]->isPair());
+        return a == b;
+    }
+}
+bool equalQ(ValuePtr a, ValuePtr b) {
+    if (a.getType() != b.getType()) {
+        return false;
+    }
+    switch (a.getType()) {
+        case ValueType::PAIR: {
+            auto&& [aCar, aCdr] = a.asPair();
+            auto&& [bCar, bCdr] = b.asPair();
+            return equalQ(aCar, bCar) && equalQ(aCdr, bCdr);
+        }
+        case ValueType::STRING: return a.asString() == b.asString();
+        case ValueType::VECTOR: {
+            auto&& aElements = a.asVector().getElements();
+            auto&& bElements = b.asVector().getElements();
+            return rg::equal(aElements, bElements, equalQ);
+        }
+        default: return eqQ(a, b);
+    }
+}
+bool pairQ(ValuePtr value) {
+    return value.isPair();
 }
 
-ValuePtr length(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto list = args[0];
-    auto vec = list->toVector();
-    return Value::fromNumber(double(vec.size()));
-}
-ValuePtr cons(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    return std::make_shared<PairValue>(args[0], args[1]);
-}
-ValuePtr car(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto list = args[0];
-    if (!list->isPair()) {
-        throw LispError("car: argument is not a pair");
-    }
-    auto&& [car, cdr] = list->asPair();
-    return car;
-}
-ValuePtr cdr(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto list = args[0];
-    if (!list->isPair()) {
-        throw LispError("cdr: argument is not a pair");
-    }
-    auto&& [car, cdr] = list->asPair();
-    return cdr;
+std::int64_t length(ValuePtr list) {
+    std::int64_t length = 0;
+    for (; list.isPair(); list = list.asPair().getCdr()) {
+        length++;
+    }
+    if (!list.isNil()) {
+        throw LispError("Malformed list: expected pair or nil, got " + list.toString() + ".");
+    }
+    return length;
+}
+ValuePtr cons(ValuePtr car, ValuePtr cdr) {
+    return makeValue<PairValue>(car, cdr);
+}
+ValuePtr car(const PairValue& pair) {
+    return pair.getCar();
+}
+ValuePtr cdr(const PairValue& pair) {
+    return pair.getCdr();
 }
 
-ValuePtr list(const std::vector<ValuePtr>& args, EvaluateEnv&) {
+ValuePtr list(ArgSpan items) {
     ValuePtr list = Value::nil();
-    for (auto it = args.rbegin(); it != args.rend(); ++it) {
-        list = std::make_shared<PairValue>(*it, list);
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+        list = makeValue<PairValue>(*it, list);
     }
     return list;
 }
-ValuePtr append(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    std::vector<ValuePtr> result;
-    for (auto arg : args) {
-        auto vec = arg->toVector();
+ValuePtr append(ArgSpan lists) {
+    ValueVector result;
+    for (auto list : lists) {
+        auto vec = list.toVector();
         result.insert(result.end(), vec.begin(), vec.end());
     }
     return Value::fromVector(result);
 }
 
-ValuePtr integerQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto [number] = extractNumbers(std::move(args[0]));
-    return Value::fromBoolean(number == std::floor(number) && std::isfinite(number));
-}
-ValuePtr add(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    double result = 0;
-    for (auto arg : args) {
-        auto [number] = extractNumbers(std::move(arg));
-        result += number;
-    }
-    return Value::fromNumber(result);
-}
-ValuePtr sub(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1, 2);
-    if (args.size() == 1) {
-        auto [number] = extractNumbers(std::move(args[0]));
-        return Value::fromNumber(-number);
-    } else {
-        auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-        return Value::fromNumber(lhs - rhs);
+bool integerQ(Number number) {
+    if (number.value.isInteger()) {
+        return true;
     }
+    auto value = number.value.asFlonum();
+    return value == std::floor(value) && std::isfinite(value);
 }
-ValuePtr mult(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    double result = 1;
-    for (auto arg : args) {
-        auto [number] = extractNumbers(std::move(arg));
-        result *= number;
+ValuePtr add(ArgSpan numbers) {
+    ValuePtr result = Value::fromInteger(0);
+    for (auto number : numbers) {
+        result = numberAdd(result, Number::check(number).value);
     }
-    return Value::fromNumber(result);
+    return result;
 }
-ValuePtr div(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1, 2);
-    if (args.size() == 1) {
-        auto [number] = extractNumbers(std::move(args[0]));
-        return Value::fromNumber(1 / number);
-    } else {
-        auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-        return Value::fromNumber(lhs / rhs);
-    }
-}
-ValuePtr expt(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromNumber(std::pow(lhs, rhs));
-}
-ValuePtr abs(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto [number] = extractNumbers(std::move(args[0]));
-    return Value::fromNumber(std::abs(number));
-}
-ValuePtr quotient(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromNumber(int(lhs / rhs));
-}
-double lispModulo(double n, double m) {
-    double r = n - m * int(n / m);
-    // If m and r has different sign, adjust r
-    // Assume that double is IEEE 754 64-bit floating point
-    if ((*reinterpret_cast<std::int64_t*>(&m) ^ *reinterpret_cast<std::int64_t*>(&r)) < 0) {
-        r += m;
-    }
-    return r;
-}
-ValuePtr modulo(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromNumber(lispModulo(lhs, rhs)); 
-}
-ValuePtr remainder(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromNumber(std::fmod(lhs, rhs));
-}
-ValuePtr eq(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromBoolean(lhs == rhs);
-}
-ValuePtr lt(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromBoolean(lhs < rhs);
-}
-ValuePtr gt(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromBoolean(lhs > rhs);
-}
-ValuePtr lteq(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromBoolean(lhs <= rhs);
-}
-ValuePtr gteq(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 2);
-    auto [lhs, rhs] = extractNumbers(std::move(args[0]), std::move(args[1]));
-    return Value::fromBoolean(lhs >= rhs);
-}
-ValuePtr evenQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto [number] = extractNumbers(std::move(args[0]));
-    return Value::fromBoolean(std::fmod(number, 2) == 0);
-}
-ValuePtr oddQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto [number] = extractNumbers(std::move(args[0]));
-    return Value::fromBoolean(std::fmod(number, 2) != 0);
-}
-ValuePtr zeroQ(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 1);
-    auto [number] = extractNumbers(std::move(args[0]));
-    return Value::fromBoolean(number == 0);
+ValuePtr sub(Number a, std::optional<Number> b) {
+    return b ? numberSub(a.value, b->value) : numberNegate(a.value);
+}
+ValuePtr mult(ArgSpan numbers) {
+    ValuePtr result = Value::fromInteger(1);
+    for (auto number : numbers) {
+        result = numberMul(result, Number::check(number).value);
+    }
+    return result;
+}
+ValuePtr div(Number a, std::optional<Number> b) {
+    return b ? numberDivide(a.value, b->value) : numberDivide(Value::fromInteger(1), a.value);
+}
+ValuePtr expt(Number base, Number exponent) {
+    return numberExpt(base.value, exponent.value);
+}
+ValuePtr abs(Number number) {
+    return numberAbs(number.value);
+}
+ValuePtr quotient(Number a, Number b) {
+    return numberQuotient(a.value, b.value);
+}
+ValuePtr modulo(Number a, Number b) {
+    return numberModulo(a.value, b.value);
+}
+ValuePtr remainder(Number a, Number b) {
+    return numberRemainder(a.value, b.value);
+}
+bool eq(Number a, Number b) {
+    return numberCompare(a.value, b.value) == 0;
+}
+bool lt(Number a, Number b) {
+    return numberCompare(a.value, b.value) < 0;
+}
+bool gt(Number a, Number b) {
+    return numberCompare(a.value, b.value) > 0;
+}
+bool lteq(Number a, Number b) {
+    return numberCompare(a.value, b.value) <= 0;
+}
+bool gteq(Number a, Number b) {
+    return numberCompare(a.value, b.value) >= 0;
+}
+bool evenQ(Number number) {
+    return numberIsEven(number.value);
+}
+bool oddQ(Number number) {
+    return !numberIsEven(number.value);
+}
+bool zeroQ(Number number) {
+    return numberIsZero(number.value);
+}
+
+// `index` as an index of a vector or string of `size` elements, which it must be.
+std::size_t checkIndex(const char* name, Number index, std::size_t size) {
+    auto value = index.value;
+    if (!value.isFixnum() || value.asFixnum() < 0 || std::size_t(value.asFixnum()) >= size) {
+        throw LispError(std::string(name) + ": index " + value.toString() + " out of range");
+    }
+    return value.asFixnum();
+}
+
+// `position` as a position in a string of `size` characters, from 0 before
+// the first to `size` after the last, which it must be.
+std::size_t checkPosition(const char* name, Number position, std::size_t size) {
+    auto value = position.value;
+    if (!value.isFixnum() || value.asFixnum() < 0 || std::size_t(value.asFixnum()) > size) {
+        throw LispError(std::string(name) + ": position " + value.toString() + " out of range");
+    }
+    return value.asFixnum();
 }
 
-ValuePtr display(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    for (auto arg : args) {
-        if (arg->isString()) {
-            std::cout << arg->asString();
+std::int64_t stringLength(const StringValue& string) {
+    return string.size();
+}
+ValuePtr stringAppend(ArgSpan strings) {
+    for (auto string : strings) {
+        if (!string.isString()) {
+            throw LispError("string-append: argument is not a string");
+        }
+    }
+    if (strings.empty()) {
+        return makeValue<StringValue>("");
+    }
+    auto result = strings[0];
+    for (auto string : strings.subspan(1)) {
+        result = StringValue::concat(static_cast<const StringValue&>(*result),
+                                     static_cast<const StringValue&>(*string));
+    }
+    return result;
+}
+ValuePtr substring(const StringValue& string, Number start, std::optional<Number> end) {
+    auto from = checkPosition("substring", start, string.size());
+    auto to = end ? checkPosition("substring", *end, string.size()) : string.size();
+    if (to < from) {
+        throw LispError("substring: end " + end->value.toString() + " is before start " +
+                        start.value.toString());
+    }
+    return string.substring(from, to);
+}
+// The character as a string of length 1, there being no character type.
+ValuePtr stringRef(const StringValue& string, Number index) {
+    auto at = checkIndex("string-ref", index, string.size());
+    return string.substring(at, at + 1);
+}
+// The position of the first occurrence of `needle`, or #f.
+ValuePtr stringIndex(const StringValue& string, const StringValue& needle) {
+    auto found = string.getValue().find(needle.getValue());
+    return found == std::string_view::npos ? Value::fromBoolean(false)
+                                           : Value::fromInteger(found);
+}
+// The parts between occurrences of `separator`, or between runs of whitespace
+// if there is none.
+ValuePtr stringSplit(const StringValue& string, std::optional<ValuePtr> separator) {
+    auto text = string.getValue();
+    ValueVector parts;
+    if (!separator) {
+        auto isSpace = [](char c) { return std::isspace(static_cast<unsigned char>(c)); };
+        for (std::size_t i = 0; i < text.size();) {
+            if (isSpace(text[i])) {
+                i++;
+                continue;
+            }
+            auto start = i;
+            while (i < text.size() && !isSpace(text[i])) {
+                i++;
+            }
+            parts.push_back(string.substring(start, i));
+        }
+        return Value::fromVector(parts);
+    }
+    if (!separator->isString() || separator->asString().empty()) {
+        throw LispError("string-split: separator must be a non-empty string");
+    }
+    auto delimiter = separator->asString();
+    std::size_t start = 0;
+    for (auto found = text.find(delimiter); found != std::string_view::npos;
+         found = text.find(delimiter, start)) {
+        parts.push_back(string.substring(start, found));
+        start = found + delimiter.size();
+    }
+    parts.push_back(string.substring(start, text.size()));
+    return Value::fromVector(parts);
+}
+ValuePtr stringToNumber(const StringValue& string) {
+    return parseNumber(string.getValue()).value_or(Value::fromBoolean(false));
+}
+ValuePtr numberToString(Number number) {
+    return makeValue<StringValue>(number.value.toString());
+}
+
+// Keyed with `equal?` unless `equivalence` is `eq?`.
+ValuePtr makeHashTable(std::optional<ValuePtr> equivalence) {
+    auto kind = HashTableValue::Equivalence::EQUAL;
+    if (equivalence) {
+        auto func = equivalence->getType() == ValueType::BUILTIN_PROC
+                        ? static_cast<const BuiltinProcValue&>(**equivalence).getFunc()
+                        : nullptr;
+        if (func == builtin<"eq?", eqQ>) {
+            kind = HashTableValue::Equivalence::EQ;
+        } else if (func != builtin<"equal?", equalQ>) {
+            throw LispError("make-hash-table: equivalence must be eq? or equal?");
+        }
+    }
+    return makeValue<HashTableValue>(kind);
+}
+bool hashTableQ(ValuePtr value) {
+    return value.getType() == ValueType::HASH_TABLE;
+}
+ValuePtr hashRef(const HashTableValue& table, ValuePtr key, std::optional<ValuePtr> otherwise) {
+    if (auto value = table.find(key)) {
+        return *value;
+    } else if (otherwise) {
+        return *otherwise;
+    }
+    throw LispError("hash-ref: no value for key " + key.toString());
+}
+void hashSet(HashTableValue& table, ValuePtr key, ValuePtr value) {
+    table.set(key, value);
+}
+void hashRemove(HashTableValue& table, ValuePtr key) {
+    table.remove(key);
+}
+bool hashHasKeyQ(const HashTableValue& table, ValuePtr key) {
+    return table.find(key) != nullptr;
+}
+std::int64_t hashCount(const HashTableValue& table) {
+    return table.size();
+}
+ValuePtr hashKeys(const HashTableValue& table) {
+    ValueVector keys;
+    table.forEach([&](ValuePtr key, ValuePtr) { keys.push_back(key); });
+    return Value::fromVector(keys);
+}
+ValuePtr hashValues(const HashTableValue& table) {
+    ValueVector values;
+    table.forEach([&](ValuePtr, ValuePtr value) { values.push_back(value); });
+    return Value::fromVector(values);
+}
+ValuePtr hashToList(const HashTableValue& table) {
+    ValueVector entries;
+    table.forEach([&](ValuePtr key, ValuePtr value) {
+        entries.push_back(makeValue<PairValue>(key, value));
+    });
+    return Value::fromVector(entries);
+}
+// Calls `(proc key value)` on the entries as they were before the first call,
+// so that `proc` may modify the table.
+void hashForEach(const HashTableValue& table, ValuePtr proc, EvaluateEnv& env) {
+    ValueVector entries;
+    table.forEach([&](ValuePtr key, ValuePtr value) {
+        entries.push_back(key);
+        entries.push_back(value);
+    });
+    for (std::size_t i = 0; i < entries.size(); i += 2) {
+        env.apply(proc, {&entries[i], 2});
+    }
+}
+
+bool vectorQ(ValuePtr value) {
+    return value.isVector();
+}
+ValuePtr makeVector(Number size, std::optional<ValuePtr> fill) {
+    if (!size.value.isFixnum() || size.value.asFixnum() < 0) {
+        throw LispError("make-vector: invalid size " + size.value.toString());
+    }
+    return makeValue<VectorValue>(size.value.asFixnum(), fill.value_or(Value::fromInteger(0)));
+}
+ValuePtr vector(ArgSpan elements) {
+    return makeValue<VectorValue>(elements);
+}
+std::int64_t vectorLength(const VectorValue& vector) {
+    return vector.size();
+}
+ValuePtr vectorRef(const VectorValue& vector, Number index) {
+    return vector[checkIndex("vector-ref", index, vector.size())];
+}
+void vectorSet(VectorValue& vector, Number index, ValuePtr value) {
+    vector.set(checkIndex("vector-set!", index, vector.size()), value);
+}
+ValuePtr vectorToList(const VectorValue& vector) {
+    ValuePtr list = Value::nil();
+    for (auto it = vector.getElements().rbegin(); it != vector.getElements().rend(); ++it) {
+        list = makeValue<PairValue>(*it, list);
+    }
+    return list;
+}
+ValuePtr listToVector(ValuePtr list) {
+    return makeValue<VectorValue>(list.toVector());
+}
+ValuePtr vectorMap(ValuePtr proc, const VectorValue& vector, EvaluateEnv& env) {
+    ValueVector mapped;
+    for (std::size_t i = 0; i < vector.size(); i++) {
+        mapped.push_back(env.apply(proc, {&vector[i], 1}));
+    }
+    return makeValue<VectorValue>(mapped);
+}
+void vectorFill(VectorValue& vector, ValuePtr value) {
+    vector.fill(value);
+}
+
+// The elements of the result of an f64vector kernel, of the same size as
+// `vector`.
+std::vector<double> sameSize(const F64VectorValue& vector) {
+    return std::vector<double>(vector.size());
+}
+ValuePtr f64Elementwise(const char* name, const F64VectorValue& a, const F64VectorValue& b,
+                        void (*kernel)(const double*, const double*, double*, std::size_t)) {
+    if (a.size() != b.size()) {
+        throw LispError(std::string(name) + ": vectors differ in length");
+    }
+    auto result = sameSize(a);
+    kernel(a.getElements().data(), b.getElements().data(), result.data(), result.size());
+    return makeValue<F64VectorValue>(std::move(result));
+}
+
+bool f64vectorQ(ValuePtr value) {
+    return value.getType() == ValueType::F64VECTOR;
+}
+ValuePtr makeF64vector(Number size, std::optional<Number> fill) {
+    if (!size.value.isFixnum() || size.value.asFixnum() < 0) {
+        throw LispError("make-f64vector: invalid size " + size.value.toString());
+    }
+    return makeValue<F64VectorValue>(
+        std::vector<double>(size.value.asFixnum(), fill ? fill->value.asNumber() : 0));
+}
+ValuePtr f64vector(ArgSpan numbers) {
+    std::vector<double> elements;
+    for (auto number : numbers) {
+        elements.push_back(Number::check(number).value.asNumber());
+    }
+    return makeValue<F64VectorValue>(std::move(elements));
+}
+std::int64_t f64vectorLength(const F64VectorValue& vector) {
+    return vector.size();
+}
+double f64vectorRef(const F64VectorValue& vector, Number index) {
+    return vector.getElements()[checkIndex("f64vector-ref", index, vector.size())];
+}
+void f64vectorSet(F64VectorValue& vector, Number index, Number value) {
+    vector.getElements()[checkIndex("f64vector-set!", index, vector.size())] =
+        value.value.asNumber();
+}
+ValuePtr f64vectorToList(const F64VectorValue& vector) {
+    ValuePtr list = Value::nil();
+    for (auto it = vector.getElements().rbegin(); it != vector.getElements().rend(); ++it) {
+        list = makeValue<PairValue>(Value::fromNumber(*it), list);
+    }
+    return list;
+}
+ValuePtr listToF64vector(ValuePtr list) {
+    return f64vector(list.toVector());
+}
+ValuePtr f64vectorAdd(const F64VectorValue& a, const F64VectorValue& b) {
+    return f64Elementwise("f64vector-add", a, b, F64Kernels::get().add);
+}
+ValuePtr f64vectorSub(const F64VectorValue& a, const F64VectorValue& b) {
+    return f64Elementwise("f64vector-sub", a, b, F64Kernels::get().sub);
+}
+ValuePtr f64vectorMul(const F64VectorValue& a, const F64VectorValue& b) {
+    return f64Elementwise("f64vector-mul", a, b, F64Kernels::get().mul);
+}
+ValuePtr f64vectorDiv(const F64VectorValue& a, const F64VectorValue& b) {
+    return f64Elementwise("f64vector-div", a, b, F64Kernels::get().div);
+}
+ValuePtr f64vectorScale(const F64VectorValue& vector, Number factor) {
+    auto result = sameSize(vector);
+    F64Kernels::get().scale(vector.getElements().data(), factor.value.asNumber(), result.data(),
+                            result.size());
+    return makeValue<F64VectorValue>(std::move(result));
+}
+double f64vectorSum(const F64VectorValue& vector) {
+    return F64Kernels::get().sum(vector.getElements().data(), vector.size());
+}
+double f64vectorDot(const F64VectorValue& a, const F64VectorValue& b) {
+    if (a.size() != b.size()) {
+        throw LispError("f64vector-dot: vectors differ in length");
+    }
+    return F64Kernels::get().dot(a.getElements().data(), b.getElements().data(), a.size());
+}
+double f64vectorMin(const F64VectorValue& vector) {
+    return F64Kernels::get().min(vector.getElements().data(), vector.size());
+}
+double f64vectorMax(const F64VectorValue& vector) {
+    return F64Kernels::get().max(vector.getElements().data(), vector.size());
+}
+ValuePtr f64vectorPrefixSum(const F64VectorValue& vector) {
+    auto result = sameSize(vector);
+    F64Kernels::get().prefixSum(vector.getElements().data(), result.data(), result.size());
+    return makeValue<F64VectorValue>(std::move(result));
+}
+
+void display(ArgSpan values) {
+    for (auto value : values) {
+        if (value.isString()) {
+            std::cout << value.asString();
         } else {
-            std::cout << arg->toString();
+            std::cout << value.toString();
         }
     }
-    return Value::nil();
 }
-ValuePtr print(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    for (auto arg : args) {
-        arg->print();
+void print(ArgSpan values) {
+    for (auto value : values) {
+        value.print();
     }
-    return Value::nil();
 }
-ValuePtr displayln(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    auto r = display(args, env);
+void displayln(ArgSpan values) {
+    display(values);
     std::cout << "\n";
-    return r;
 }
-ValuePtr newline(const std::vector<ValuePtr>& args, EvaluateEnv&) {
+void newline(ArgSpan) {
     std::cout << std::endl;
-    return Value::nil();
 }
-ValuePtr error(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 0, 1);
-    throw LispError(args.size() == 1 ? args[0]->toString() : "");
+[[noreturn]] void error(std::optional<ValuePtr> message) {
+    throw LispError(message ? message->toString() : "");
 }
-[[noreturn]] ValuePtr exit(const std::vector<ValuePtr>& args, EvaluateEnv&) {
-    checkArgsCount(args, 0, 1);
-    if (args.empty()) {
-        std::exit(0);
-    } else {
-        auto [number] = extractNumbers(std::move(args[0]));
-        std::exit(number);
-    }
+[[noreturn]] void exit(std::optional<Number> code) {
+    std::exit(code ? static_cast<int>(code->value.asNumber()) : 0);
 }
 
-ValuePtr map(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 2, 2);
-    auto proc = args[0];
-    std::vector<ValuePtr> mapped;
-    rg::transform(args[1]->toVector(), std::back_inserter(mapped),
-                  [&](ValuePtr v) { return env.apply(proc, {std::move(v)}); });
+ValuePtr map(ValuePtr proc, ValuePtr list, EvaluateEnv& env) {
+    ValueVector mapped;
+    rg::transform(list.toVector(), std::back_inserter(mapped),
+                  [&](ValuePtr v) { return env.apply(proc, {&v, 1}); });
     return Value::fromVector(mapped);
 }
 
-ValuePtr filter(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 2, 2);
-    auto proc = args[0];
-    std::vector<ValuePtr> filtered;
-    rg::copy_if(args[1]->toVector(), std::back_inserter(filtered),
-                [&](ValuePtr v) { return env.apply(proc, {std::move(v)})->isTrue(); });
+ValuePtr filter(ValuePtr proc, ValuePtr list, EvaluateEnv& env) {
+    ValueVector filtered;
+    rg::copy_if(list.toVector(), std::back_inserter(filtered),
+                [&](ValuePtr v) { return env.apply(proc, {&v, 1}).isTrue(); });
     return Value::fromVector(filtered);
 }
-ValuePtr reduce(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 2, 2);
-    if (!args[1]->isList()) {
+ValuePtr reduce(ValuePtr proc, ValuePtr list, EvaluateEnv& env) {
+    if (!list.isList()) {
         throw LispError("reduce: second argument must be a list");
     }
-    if (args[1]->isNil()) {
+    if (list.isNil()) {
         throw LispError("reduce list must has at least 1 element");
     }
-    auto [init, rest] = std::move(args[1]->asPair());
-    auto proc = std::move(args[0]);
-    while (rest->isPair()) {
-        auto&& [car, cdr] = rest->asPair();
-        init = env.apply(proc, {init, car});
-        rest = std::move(cdr);
+    auto init = list.asPair().getCar();
+    auto rest = list.asPair().getCdr();
+    while (rest.isPair()) {
+        auto&& [car, cdr] = rest.asPair();
+        ValuePtr pair[]{init, car};
+        init = env.apply(proc, pair);
+        rest = cdr;
     }
     return init;
 }
 
-ValuePtr eval(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 1, 1);
-    return env.eval(args[0]);
+void gc() {
+    GcHeap::requestCollection();
+}
+ValuePtr gcStats() {
+    auto stats = GcHeap::stats();
+    auto entry = [](const std::string& name, double value) {
+        return makeValue<PairValue>(IdentifierValue::intern(name), Value::fromNumber(value));
+    };
+    return Value::fromVector({entry("collections", stats.collections),
+                              entry("heap-bytes", stats.heapBytes),
+                              entry("live-bytes", stats.liveBytes),
+                              entry("allocated-bytes", stats.allocatedBytes),
+                              entry("freed-bytes", stats.freedBytes),
+                              entry("last-pause-ms", stats.lastPauseMs),
+                              entry("max-pause-ms", stats.maxPauseMs),
+                              entry("total-pause-ms", stats.totalPauseMs)});
 }
-ValuePtr apply(const std::vector<ValuePtr>& args, EvaluateEnv& env) {
-    checkArgsCount(args, 2, 2);
-    auto callArgs = args[1]->toVector();
-    return env.apply(std::move(args[0]), std::move(callArgs));
+
+ValuePtr eval(ValuePtr expression, EvaluateEnv& env) {
+    return env.getGlobal().eval(expression);
 }
+ValuePtr apply(ValuePtr proc, ValuePtr args, EvaluateEnv& env) {
+    ArgBuffer callArgs(args);
+    return env.apply(proc, callArgs);
+}
+
+}  // namespace builtins
+
+namespace {
 
-const std::unordered_map<std::string, BuiltinFuncType*> BUILTINS{{"procedure?", procedureQ},
-                                                                 {"list?", listQ},
-                                                                 {"boolean?", booleanQ},
-                                                                 {"number?", numberQ},
-                                                                 {"symbol?", symbolQ},
-                                                                 {"string?", stringQ},
-                                                                 {"null?", nullQ},
-                                                                 {"not", not_},
-                                                                 {"equal?", equalQ},
-                                                                 {"eq?", eqQ},
-                                                                 {"pair?", pairQ},
-                                                                 {"length", length},
-                                                                 {"cons", cons},
-                                                                 {"car", car},
-                                                                 {"cdr", cdr},
-                                                                 {"list", list},
-                                                                 {"append", append},
-                                                                 {"integer?", integerQ},
-                                                                 {"+", add},
-                                                                 {"-", sub},
-                                                                 {"*", mult},
-                                                                 {"/", div},
-                                                                 {"expt", expt},
-                                                                 {"abs", abs},
-                                                                 {"quotient", quotient},
-                                                                 {"modulo", modulo},
-                                                                 {"remainder", remainder},
-                                                                 {"=", eq},
-                                                                 {"<", lt},
-                                                                 {">", gt},
-                                                                 {"<=", lteq},
-                                                                 {">=", gteq},
-                                                                 {"even?", evenQ},
-                                                                 {"odd?", oddQ},
-                                                                 {"zero?", zeroQ},
-                                                                 {"display", display},
-                                                                 {"print", print},
-                                                                 {"displayln", displayln},
-                                                                 {"newline", newline},
-                                                                 {"error", error},
-                                                                 {"map", map},
-                                                                 {"filter", filter},
-                                                                 {"reduce", reduce},
-                                                                 {"exit", exit},
-                                                                 {"eval", eval},
-                                                                 {"apply", apply}};
\ No newline at end of file
+constexpr bool PURE{true};
+
+constexpr BuiltinDef DEFINITIONS[]{
+    defBuiltin<"procedure?", builtins::procedureQ>(PURE),
+    defBuiltin<"list?", builtins::listQ>(PURE),
+    defBuiltin<"boolean?", builtins::booleanQ>(PURE),
+    defBuiltin<"number?", builtins::numberQ>(PURE),
+    defBuiltin<"symbol?", builtins::symbolQ>(PURE),
+    defBuiltin<"string?", builtins::stringQ>(PURE),
+    defBuiltin<"null?", builtins::nullQ>(PURE),
+    defBuiltin<"not", builtins::not_>(PURE),
+    defBuiltin<"equal?", builtins::equalQ>(PURE),
+    defBuiltin<"eq?", builtins::eqQ>(PURE),
+    defBuiltin<"pair?", builtins::pairQ>(PURE),
+    defBuiltin<"length", builtins::length>(PURE),
+    defBuiltin<"cons", builtins::cons>(),
+    defBuiltin<"car", builtins::car>(PURE),
+    defBuiltin<"cdr", builtins::cdr>(PURE),
+    defBuiltin<"list", builtins::list>(),
+    defBuiltin<"append", builtins::append>(),
+    defBuiltin<"integer?", builtins::integerQ>(PURE),
+    defBuiltin<"+", builtins::add>(PURE),
+    defBuiltin<"-", builtins::sub>(PURE),
+    defBuiltin<"*", builtins::mult>(PURE),
+    defBuiltin<"/", builtins::div>(PURE),
+    // Not pure for the compiler: a small exponent can make a result of any size.
+    defBuiltin<"expt", builtins::expt>(),
+    defBuiltin<"abs", builtins::abs>(PURE),
+    defBuiltin<"quotient", builtins::quotient>(PURE),
+    defBuiltin<"modulo", builtins::modulo>(PURE),
+    defBuiltin<"remainder", builtins::remainder>(PURE),
+    defBuiltin<"=", builtins::eq>(PURE),
+    defBuiltin<"<", builtins::lt>(PURE),
+    defBuiltin<">", builtins::gt>(PURE),
+    defBuiltin<"<=", builtins::lteq>(PURE),
+    defBuiltin<">=", builtins::gteq>(PURE),
+    defBuiltin<"even?", builtins::evenQ>(PURE),
+    defBuiltin<"odd?", builtins::oddQ>(PURE),
+    defBuiltin<"zero?", builtins::zeroQ>(PURE),
+    defBuiltin<"string-length", builtins::stringLength>(PURE),
+    defBuiltin<"string-append", builtins::stringAppend>(),
+    defBuiltin<"substring", builtins::substring>(),
+    defBuiltin<"string-ref", builtins::stringRef>(),
+    defBuiltin<"string-index", builtins::stringIndex>(PURE),
+    defBuiltin<"string-split", builtins::stringSplit>(),
+    defBuiltin<"string->number", builtins::stringToNumber>(PURE),
+    defBuiltin<"number->string", builtins::numberToString>(),
+    defBuiltin<"make-hash-table", builtins::makeHashTable>(),
+    defBuiltin<"hash-table?", builtins::hashTableQ>(PURE),
+    defBuiltin<"hash-ref", builtins::hashRef>(),
+    defBuiltin<"hash-set!", builtins::hashSet>(),
+    defBuiltin<"hash-remove!", builtins::hashRemove>(),
+    defBuiltin<"hash-has-key?", builtins::hashHasKeyQ>(),
+    defBuiltin<"hash-count", builtins::hashCount>(),
+    defBuiltin<"hash-keys", builtins::hashKeys>(),
+    defBuiltin<"hash-values", builtins::hashValues>(),
+    defBuiltin<"hash->list", builtins::hashToList>(),
+    defBuiltin<"hash-for-each", builtins::hashForEach>(),
+    defBuiltin<"vector?", builtins::vectorQ>(PURE),
+    defBuiltin<"make-vector", builtins::makeVector>(),
+    defBuiltin<"vector", builtins::vector>(),
+    defBuiltin<"vector-length", builtins::vectorLength>(PURE),
+    defBuiltin<"vector-ref", builtins::vectorRef>(),
+    defBuiltin<"vector-set!", builtins::vectorSet>(),
+    defBuiltin<"vector->list", builtins::vectorToList>(),
+    defBuiltin<"list->vector", builtins::listToVector>(),
+    defBuiltin<"vector-map", builtins::vectorMap>(),
+    defBuiltin<"vector-fill!", builtins::vectorFill>(),
+    defBuiltin<"f64vector?", builtins::f64vectorQ>(PURE),
+    defBuiltin<"make-f64vector", builtins::makeF64vector>(),
+    defBuiltin<"f64vector", builtins::f64vector>(),
+    defBuiltin<"f64vector-length", builtins::f64vectorLength>(PURE),
+    defBuiltin<"f64vector-ref", builtins::f64vectorRef>(),
+    defBuiltin<"f64vector-set!", builtins::f64vectorSet>(),
+    defBuiltin<"f64vector->list", builtins::f64vectorToList>(),
+    defBuiltin<"list->f64vector", builtins::listToF64vector>(),
+    defBuiltin<"f64vector-add", builtins::f64vectorAdd>(),
+    defBuiltin<"f64vector-sub", builtins::f64vectorSub>(),
+    defBuiltin<"f64vector-mul", builtins::f64vectorMul>(),
+    defBuiltin<"f64vector-div", builtins::f64vectorDiv>(),
+    defBuiltin<"f64vector-scale", builtins::f64vectorScale>(),
+    defBuiltin<"f64vector-sum", builtins::f64vectorSum>(),
+    defBuiltin<"f64vector-dot", builtins::f64vectorDot>(),
+    defBuiltin<"f64vector-min", builtins::f64vectorMin>(),
+    defBuiltin<"f64vector-max", builtins::f64vectorMax>(),
+    defBuiltin<"f64vector-prefix-sum", builtins::f64vectorPrefixSum>(),
+    defBuiltin<"display", builtins::display>(),
+    defBuiltin<"print", builtins::print>(),
+    defBuiltin<"displayln", builtins::displayln>(),
+    defBuiltin<"newline", builtins::newline>(),
+    defBuiltin<"error", builtins::error>(),
+    defBuiltin<"map", builtins::map>(),
+    defBuiltin<"filter", builtins::filter>(),
+    defBuiltin<"reduce", builtins::reduce>(),
+    defBuiltin<"exit", builtins::exit>(),
+    defBuiltin<"eval", builtins::eval>(),
+    defBuiltin<"apply", builtins::apply>(),
+    defBuiltin<"gc", builtins::gc>(),
+    defBuiltin<"gc-stats", builtins::gcStats>(),
+};
+
+}  // namespace
+
+const std::unordered_map<std::string, BuiltinFuncType*> BUILTINS = [] {
+    std::unordered_map<std::string, BuiltinFuncType*> builtins;
+    for (auto&& def : DEFINITIONS) {
+        builtins.emplace(def.name, def.func);
+    }
+    return builtins;
+}();
+
+const std::unordered_set<BuiltinFuncType*> PURE_BUILTINS = [] {
+    std::unordered_set<BuiltinFuncType*> pure;
+    for (auto&& def : DEFINITIONS) {
+        if (def.pure) {
+            pure.insert(def.func);
+        }
+    }
+    return pure;
+}();
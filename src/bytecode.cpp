@@ -0,0 +1,232 @@
+#include "./bytecode.h"
+
+#include <iomanip>
+#include <ostream>
+
+#include "./eval_env.h"
+
+namespace {
+
+struct OpInfo {
+    const char* name;
+    std::size_t operands;
+};
+
+constexpr OpInfo OP_INFO[]{
+#define X(name, operands) {#name, operands},
+    MINI_LISP_OPCODES(X)
+#undef X
+};
+
+}  // namespace
+
+std::size_t operandCount(std::uint32_t op) {
+    return OP_INFO[op].operands;
+}
+
+std::optional<Primitive> findPrimitive(SymbolId name, std::size_t argc) {
+    struct Entry {
+        SymbolId name;
+        std::size_t argc;
+    };
+    static const Entry ENTRIES[]{
+#define X(primitive, symbol, argc) {IdentifierValue::idOf(symbol), argc},
+        MINI_LISP_PRIMITIVES(X)
+#undef X
+    };
+    for (std::size_t i = 0; i < std::size(ENTRIES); i++) {
+        if (ENTRIES[i].name == name && ENTRIES[i].argc == argc) {
+            return static_cast<Primitive>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+void Prototype::trace(GcTracer& tracer) const {
+    for (auto&& constant : constants) {
+        tracer.mark(constant.get());
+    }
+    for (auto nested : protos) {
+        tracer.mark(nested);
+    }
+}
+
+void Prototype::disassemble(std::ostream& os) const {
+    os << "prototype " << this << " (params " << paramCount << ", frame " << frameSize
+       << (heapFrame ? " on heap" : "") << ", stack " << maxStack << ")\n";
+    auto name = [](std::uint32_t id) { return IdentifierValue::nameOf(id); };
+    auto constant = [this](std::uint32_t k) {
+        return "#" + std::to_string(k) + " " + constants[k].toString();
+    };
+    for (std::size_t pc = 0; pc < code.size();) {
+        auto op = static_cast<OpCode>(code[pc]);
+        auto&& info = OP_INFO[code[pc]];
+        auto operand = [&](std::size_t i) { return code[pc + 1 + i]; };
+        os << std::setw(6) << pc << "  " << std::left << std::setw(22) << info.name << std::right;
+        switch (op) {
+            case OpCode::CONST:
+            case OpCode::DEFINE_GLOBAL:
+            case OpCode::ERROR: os << constant(operand(0)); break;
+            case OpCode::LOCAL: os << operand(0) << " ; " << name(operand(1)); break;
+            case OpCode::LOCAL_UP:
+                os << operand(0) << " " << operand(1) << " ; " << name(operand(2));
+                break;
+            case OpCode::GLOBAL: os << name(operand(0)); break;
+            case OpCode::GUARD: os << operand(2) << " ; " << name(operand(0)); break;
+            case OpCode::CALL_PRIMITIVE: os << operand(1) << " ; " << name(operand(2)); break;
+            case OpCode::DEFINE_LOCAL: os << operand(0) << " " << constant(operand(1)); break;
+            case OpCode::CLOSURE: os << protos[operand(0)]; break;
+            case OpCode::LOCAL_CONST:
+                os << operand(0) << " ; " << name(operand(1)) << ", " << constant(operand(2));
+                break;
+            case OpCode::LOCAL_LOCAL:
+                os << operand(0) << " ; " << name(operand(1)) << ", " << operand(2) << " ; "
+                   << name(operand(3));
+                break;
+            default:
+                for (std::size_t i = 0; i < info.operands; i++) {
+                    os << (i ? " " : "") << operand(i);
+                }
+        }
+        os << '\n';
+        pc += 1 + info.operands;
+    }
+    for (auto nested : protos) {
+        os << '\n';
+        nested->disassemble(os);
+    }
+}
+
+void CodeBuilder::emit(OpCode op, std::initializer_list<std::uint32_t> operands,
+                       int stackEffect) {
+    auto& code = proto->code;
+    depth += stackEffect;
+    proto->maxStack = std::max(proto->maxStack, depth);
+    if (fusable && static_cast<OpCode>(code[last]) == OpCode::LOCAL) {
+        if (op == OpCode::CONST) {
+            code[last] = static_cast<std::uint32_t>(OpCode::LOCAL_CONST);
+            code.insert(code.end(), operands);
+            fusable = false;
+            return;
+        } else if (op == OpCode::LOCAL) {
+            code[last] = static_cast<std::uint32_t>(OpCode::LOCAL_LOCAL);
+            code.insert(code.end(), operands);
+            fusable = false;
+            return;
+        }
+    }
+    last = code.size();
+    fusable = true;
+    code.push_back(static_cast<std::uint32_t>(op));
+    code.insert(code.end(), operands);
+}
+
+std::uint32_t CodeBuilder::addConstant(ValuePtr value) {
+    auto& constants = proto->constants;
+    for (std::size_t k = 0; k < constants.size(); k++) {
+        if (constants[k] == value) {
+            return static_cast<std::uint32_t>(k);
+        }
+    }
+    constants.push_back(value);
+    return static_cast<std::uint32_t>(constants.size() - 1);
+}
+
+std::uint32_t CodeBuilder::addProto(Prototype* nested) {
+    proto->protos.push_back(nested);
+    return static_cast<std::uint32_t>(proto->protos.size() - 1);
+}
+
+std::uint32_t CodeBuilder::addCache() {
+    proto->caches.emplace_back();
+    return static_cast<std::uint32_t>(proto->caches.size() - 1);
+}
+
+void CodeBuilder::emitConstant(ValuePtr value) {
+    emit(OpCode::CONST, {addConstant(value)}, 1);
+}
+
+void CodeBuilder::emitNil() {
+    emit(OpCode::NIL, {}, 1);
+}
+
+void CodeBuilder::emitLocal(std::uint32_t depth, std::uint32_t slot, SymbolId name) {
+    if (depth == 0) {
+        emit(OpCode::LOCAL, {slot, name}, 1);
+    } else {
+        emit(OpCode::LOCAL_UP, {depth, slot, name}, 1);
+    }
+}
+
+void CodeBuilder::emitGlobal(SymbolId name) {
+    emit(OpCode::GLOBAL, {name, addCache()}, 1);
+}
+
+void CodeBuilder::emitDefineLocal(std::uint32_t slot, SymbolId name) {
+    auto k = addConstant(IdentifierValue::intern(IdentifierValue::nameOf(name)));
+    emit(OpCode::DEFINE_LOCAL, {slot, k}, 0);
+}
+
+void CodeBuilder::emitDefineGlobal(SymbolId name) {
+    auto k = addConstant(IdentifierValue::intern(IdentifierValue::nameOf(name)));
+    emit(OpCode::DEFINE_GLOBAL, {k}, 0);
+}
+
+void CodeBuilder::emitPop() {
+    emit(OpCode::POP, {}, -1);
+}
+
+void CodeBuilder::emitClosure(Prototype* nested) {
+    emit(OpCode::CLOSURE, {addProto(nested)}, 1);
+    proto->heapFrame = true;
+}
+
+void CodeBuilder::emitBind(std::uint32_t slot, std::size_t count) {
+    emit(OpCode::BIND, {slot, static_cast<std::uint32_t>(count)}, -static_cast<int>(count));
+}
+
+void CodeBuilder::emitCall(std::size_t argc, bool tail) {
+    emit(tail ? OpCode::TAIL_CALL : OpCode::CALL, {static_cast<std::uint32_t>(argc)},
+         -static_cast<int>(argc));
+}
+
+void CodeBuilder::emitPrimitive(Primitive primitive, SymbolId name, std::size_t argc) {
+    emit(OpCode::CALL_PRIMITIVE,
+         {static_cast<std::uint32_t>(primitive), static_cast<std::uint32_t>(argc), name,
+          addCache()},
+         1 - static_cast<int>(argc));
+}
+
+void CodeBuilder::emitReturn() {
+    emit(OpCode::RETURN, {}, -1);
+}
+
+void CodeBuilder::emitCons() {
+    emit(OpCode::CONS, {}, -1);
+}
+
+void CodeBuilder::emitError(const std::string& message) {
+    emit(OpCode::ERROR, {addConstant(makeValue<StringValue>(message))}, 1);
+}
+
+CodeBuilder::Label CodeBuilder::emitGuard(SymbolId name, GlobalBinding* binding) {
+    auto cache = addCache();
+    proto->caches[cache] = {binding, binding->version, true};
+    emit(OpCode::GUARD, {name, cache, 0}, 0);
+    return proto->code.size() - 1;
+}
+
+CodeBuilder::Label CodeBuilder::emitJump(OpCode op) {
+    emit(op, {0}, op == OpCode::JUMP ? 0 : -1);
+    return proto->code.size() - 1;
+}
+
+void CodeBuilder::bind(Label label) {
+    proto->code[label] = static_cast<std::uint32_t>(proto->code.size());
+    fusable = false;
+}
+
+void CodeBuilder::setDepth(std::size_t newDepth) {
+    depth = newDepth;
+    proto->maxStack = std::max(proto->maxStack, depth);
+}
@@ -0,0 +1,221 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "./gc.h"
+#include "./jit.h"
+#include "./value.h"
+
+// X(name, operand count). Operands are one code word each; `k` operands index
+// the constant pool, `proto` operands the nested prototypes, `cache` operands
+// the global caches, and jump targets are absolute code offsets.
+#define MINI_LISP_OPCODES(X)                                                        \
+    X(CONST, 1)               /* k: push constants[k] */                           \
+    X(NIL, 0)                 /* push () */                                        \
+    X(LOCAL, 2)               /* slot, name: push a slot of the current frame */   \
+    X(LOCAL_UP, 3)            /* depth, slot, name: push a slot of an outer frame */ \
+    X(GLOBAL, 2)              /* name, cache: push a global */                     \
+    X(DEFINE_LOCAL, 2)        /* slot, k: pop into a slot, push symbol k */        \
+    X(DEFINE_GLOBAL, 1)       /* k: pop into global symbol k, push it */           \
+    X(POP, 0)                                                                      \
+    X(JUMP, 1)                /* target */                                         \
+    X(JUMP_IF_FALSE, 1)       /* target: pop, jump if #f */                        \
+    X(JUMP_IF_FALSE_OR_POP, 1) /* target: jump if top is #f, else pop */           \
+    X(JUMP_IF_TRUE_OR_POP, 1) /* target: jump if top is not #f, else pop */        \
+    X(GUARD, 3)               /* name, cache, target: jump if the global changed */\
+    X(CLOSURE, 1)             /* proto: push a closure over the current frame */   \
+    X(BIND, 2)                /* slot, count: pop values into count slots from slot */ \
+    X(CALL, 1)                /* argc: pop procedure and arguments, push result */ \
+    X(TAIL_CALL, 1)           /* argc: call, replacing the current activation */   \
+    X(CALL_PRIMITIVE, 4)      /* primitive, argc, name, cache: call a global, */   \
+                              /* inline while it is the stock primitive */         \
+    X(RETURN, 0)                                                                   \
+    X(CONS, 0)                /* pop cdr and car, push a fresh pair */             \
+    X(ERROR, 1)               /* k: raise LispError with message constants[k] */   \
+    /* Superinstructions */                                                        \
+    X(LOCAL_CONST, 3)         /* slot, name, k: LOCAL slot name; CONST k */        \
+    X(LOCAL_LOCAL, 4)         /* slot, name, slot, name: LOCAL; LOCAL */
+
+enum class OpCode : std::uint32_t {
+#define X(name, operands) name,
+    MINI_LISP_OPCODES(X)
+#undef X
+};
+
+// The number of operands following `op` in the code.
+std::size_t operandCount(std::uint32_t op);
+
+// X(name, symbol, argc): builtins that CALL_PRIMITIVE runs without a call when
+// the global they are named by still holds them.
+#define MINI_LISP_PRIMITIVES(X) \
+    X(ADD, "+", 2)              \
+    X(SUB, "-", 2)              \
+    X(MUL, "*", 2)              \
+    X(NUM_EQ, "=", 2)           \
+    X(LT, "<", 2)               \
+    X(GT, ">", 2)               \
+    X(LE, "<=", 2)              \
+    X(GE, ">=", 2)              \
+    X(CAR, "car", 1)            \
+    X(CDR, "cdr", 1)            \
+    X(CONS, "cons", 2)          \
+    X(NULL_Q, "null?", 1)
+
+enum class Primitive : std::uint32_t {
+#define X(name, symbol, argc) name,
+    MINI_LISP_PRIMITIVES(X)
+#undef X
+};
+
+// The primitive for a call of global `name` with `argc` arguments, if any.
+std::optional<Primitive> findPrimitive(SymbolId name, std::size_t argc);
+
+struct GlobalBinding;
+
+// What a GLOBAL or CALL_PRIMITIVE instruction has learnt about its global.
+// The binding is found once; whether it holds the stock primitive is checked
+// again only when the binding's version moves on.
+struct GlobalCache {
+    GlobalBinding* binding{nullptr};
+    std::uint32_t version{0};
+    bool stock{false};
+};
+
+// The compiled code of a top-level form or lambda body. Activations get a
+// frame of `frameSize` slots holding the parameters, then the let bindings and
+// internal defines of the body. The frame lives in the VM's activation unless
+// the code creates closures, which may outlive the activation and see the frame
+// through their environment; only then is it allocated on the heap.
+class Prototype : public GcObject {
+private:
+    std::vector<std::uint32_t> code;
+    std::vector<ValuePtr> constants;
+    std::vector<Prototype*> protos;
+    mutable std::vector<GlobalCache> caches;
+    std::size_t paramCount;
+    std::size_t frameSize;
+    std::size_t maxStack{0};
+    bool heapFrame{false};
+    // Activations so far, until the code is compiled to machine code.
+    mutable std::uint32_t entries{0};
+    mutable std::unique_ptr<NativeCode> native;
+    friend class CodeBuilder;
+    friend class ProgramLoader;
+
+public:
+    Prototype(std::size_t paramCount, std::size_t frameSize)
+        : paramCount{paramCount}, frameSize{frameSize} {}
+
+    const std::uint32_t* getCode() const {
+        return code.data();
+    }
+    std::size_t getCodeSize() const {
+        return code.size();
+    }
+    const ValuePtr* getConstants() const {
+        return constants.data();
+    }
+    std::size_t getConstantCount() const {
+        return constants.size();
+    }
+    Prototype* const* getProtos() const {
+        return protos.data();
+    }
+    std::size_t getProtoCount() const {
+        return protos.size();
+    }
+    GlobalCache* getCaches() const {
+        return caches.data();
+    }
+    std::size_t getCacheCount() const {
+        return caches.size();
+    }
+    std::size_t getParamCount() const {
+        return paramCount;
+    }
+    std::size_t getFrameSize() const {
+        return frameSize;
+    }
+    // The deepest the operand stack can get while running this code.
+    std::size_t getMaxStack() const {
+        return maxStack;
+    }
+    bool needsHeapFrame() const {
+        return heapFrame;
+    }
+    // Counts an activation, and returns the machine code to run it with, once
+    // the prototype has been entered JIT_THRESHOLD times and the JIT is on.
+    const NativeCode* enterNative() const {
+        if (!native && isJitEnabled() && ++entries == JIT_THRESHOLD) {
+            native = compileNative(*this);
+        }
+        return native.get();
+    }
+
+    void disassemble(std::ostream& os) const;
+    void trace(GcTracer& tracer) const override;
+};
+
+// Appends instructions to a prototype, tracking the operand stack depth and
+// fusing common instruction pairs into superinstructions.
+class CodeBuilder {
+private:
+    Prototype* proto;
+    std::size_t depth{0};
+    // Start of the last instruction, if nothing may jump between it and the
+    // next one; only then can the two be fused.
+    std::size_t last;
+    bool fusable{false};
+
+    void emit(OpCode op, std::initializer_list<std::uint32_t> operands, int stackEffect);
+
+public:
+    using Label = std::size_t;
+
+    explicit CodeBuilder(Prototype* proto) : proto{proto} {}
+
+    std::uint32_t addConstant(ValuePtr value);
+    std::uint32_t addProto(Prototype* nested);
+    std::uint32_t addCache();
+
+    void emitConstant(ValuePtr value);
+    void emitNil();
+    void emitLocal(std::uint32_t depth, std::uint32_t slot, SymbolId name);
+    void emitGlobal(SymbolId name);
+    void emitDefineLocal(std::uint32_t slot, SymbolId name);
+    void emitDefineGlobal(SymbolId name);
+    void emitPop();
+    void emitClosure(Prototype* nested);
+    void emitBind(std::uint32_t slot, std::size_t count);
+    void emitCall(std::size_t argc, bool tail);
+    // Calls global `name` with the arguments on the stack.
+    void emitPrimitive(Primitive primitive, SymbolId name, std::size_t argc);
+    // Emits a jump taken once `binding`, the global `name`, is redefined.
+    // Code is emitted right after it is compiled, so the binding is as the
+    // compiler saw it.
+    Label emitGuard(SymbolId name, GlobalBinding* binding);
+    void emitReturn();
+    void emitCons();
+    void emitError(const std::string& message);
+
+    // Emits a jump with its target left open, to be fixed by `bind`. The
+    // conditional jumps that keep their operand do so on the branch taken.
+    Label emitJump(OpCode op);
+    // Makes pending jump `label` target the next instruction.
+    void bind(Label label);
+
+    // The operand stack depth is tracked along straight-line code; at the
+    // join points of branches callers restore it explicitly.
+    std::size_t getDepth() const {
+        return depth;
+    }
+    void setDepth(std::size_t newDepth);
+};
+
+#endif
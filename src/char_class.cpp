@@ -0,0 +1,165 @@
+#include "./char_class.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MINI_LISP_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// The runs that ScanKernels looks for the end of.
+enum class Run {
+    SPACE,
+    COMMENT,
+    ATOM,
+    STRING,
+};
+
+template <Run R>
+bool endsRun(char c) {
+    switch (R) {
+        case Run::SPACE: return !isSpace(c);
+        case Run::COMMENT: return c == '\n';
+        case Run::ATOM: return isDelimiter(c);
+        case Run::STRING: return c == '"' || c == '\\';
+    }
+}
+
+// How many characters the SIMD versions test one at a time before they load
+// registers. Whitespace and atoms in code mostly end within a few characters,
+// where a vector compare costs more than it saves; comments and strings tend
+// to be long.
+template <Run R>
+constexpr std::size_t SCALAR_PREFIX = R == Run::SPACE || R == Run::ATOM ? 16 : 0;
+
+namespace scalar {
+
+template <Run R>
+std::size_t find(const char* text, std::size_t size, std::size_t pos) {
+    while (pos < size && !endsRun<R>(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+constexpr ScanKernels KERNELS{"scalar", find<Run::SPACE>, find<Run::COMMENT>, find<Run::ATOM>,
+                              find<Run::STRING>};
+
+}  // namespace scalar
+
+#ifdef MINI_LISP_X86_SIMD
+
+// SSE2 is part of x86-64, so this version needs no check. Whitespace is
+// ' ' or '\t' to '\r', the latter tested as c - '\t' <= 4 unsigned, which is
+// min(c - '\t', 4) == c - '\t'.
+namespace sse2 {
+
+template <Run R>
+__m128i ends(__m128i chars) {
+    auto is = [&](char c) { return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c)); };
+    auto space = [&] {
+        auto control = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+        return _mm_or_si128(is(' '),
+                            _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control));
+    };
+    switch (R) {
+        case Run::SPACE: return _mm_xor_si128(space(), _mm_set1_epi8(-1));
+        case Run::COMMENT: return is('\n');
+        case Run::ATOM:
+            return _mm_or_si128(
+                _mm_or_si128(_mm_or_si128(space(), is('(')), _mm_or_si128(is(')'), is('\''))),
+                _mm_or_si128(_mm_or_si128(is('`'), is(',')), is('"')));
+        case Run::STRING: return _mm_or_si128(is('"'), is('\\'));
+    }
+}
+
+template <Run R>
+std::size_t find(const char* text, std::size_t size, std::size_t pos) {
+    for (auto stop = std::min(size, pos + SCALAR_PREFIX<R>); pos < stop; pos++) {
+        if (endsRun<R>(text[pos])) {
+            return pos;
+        }
+    }
+    for (; pos + 16 <= size; pos += 16) {
+        auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+        if (auto mask = _mm_movemask_epi8(ends<R>(chars))) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return scalar::find<R>(text, size, pos);
+}
+
+constexpr ScanKernels KERNELS{"sse2", find<Run::SPACE>, find<Run::COMMENT>, find<Run::ATOM>,
+                              find<Run::STRING>};
+
+}  // namespace sse2
+
+// As SSE2, 32 characters at a time.
+namespace avx2 {
+
+#define MINI_LISP_AVX2 __attribute__((target("avx2")))
+
+template <Run R>
+MINI_LISP_AVX2 __m256i ends(__m256i chars) {
+    auto is = [&](char c) MINI_LISP_AVX2 { return _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c)); };
+    auto space = [&] MINI_LISP_AVX2 {
+        auto control = _mm256_sub_epi8(chars, _mm256_set1_epi8('\t'));
+        return _mm256_or_si256(
+            is(' '), _mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)), control));
+    };
+    switch (R) {
+        case Run::SPACE: return _mm256_xor_si256(space(), _mm256_set1_epi8(-1));
+        case Run::COMMENT: return is('\n');
+        case Run::ATOM:
+            return _mm256_or_si256(
+                _mm256_or_si256(_mm256_or_si256(space(), is('(')),
+                                _mm256_or_si256(is(')'), is('\''))),
+                _mm256_or_si256(_mm256_or_si256(is('`'), is(',')), is('"')));
+        case Run::STRING: return _mm256_or_si256(is('"'), is('\\'));
+    }
+}
+
+template <Run R>
+MINI_LISP_AVX2 std::size_t find(const char* text, std::size_t size, std::size_t pos) {
+    for (auto stop = std::min(size, pos + SCALAR_PREFIX<R>); pos < stop; pos++) {
+        if (endsRun<R>(text[pos])) {
+            return pos;
+        }
+    }
+    for (; pos + 32 <= size; pos += 32) {
+        auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + pos));
+        if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(ends<R>(chars)))) {
+            return pos + __builtin_ctz(mask);
+        }
+    }
+    return sse2::find<R>(text, size, pos);
+}
+
+#undef MINI_LISP_AVX2
+
+constexpr ScanKernels KERNELS{"avx2", find<Run::SPACE>, find<Run::COMMENT>, find<Run::ATOM>,
+                              find<Run::STRING>};
+
+}  // namespace avx2
+
+#endif
+
+}  // namespace
+
+const ScanKernels& ScanKernels::get() {
+    static const ScanKernels& best = *available().back();
+    return best;
+}
+
+std::vector<const ScanKernels*> ScanKernels::available() {
+    std::vector<const ScanKernels*> kernels{&scalar::KERNELS};
+#ifdef MINI_LISP_X86_SIMD
+    kernels.push_back(&sse2::KERNELS);
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(&avx2::KERNELS);
+    }
+#endif
+    return kernels;
+}
@@ -0,0 +1,56 @@
+#ifndef CHAR_CLASS_H
+#define CHAR_CLASS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What the tokenizers need to know of a character, as bits of CHAR_CLASSES.
+enum CharClass : std::uint8_t {
+    // Whitespace, as std::isspace has it in the "C" locale.
+    CHAR_SPACE = 1,
+    // Whitespace or one of ( ) ' ` , ", which end an atom.
+    CHAR_DELIMITER = 2,
+};
+
+inline constexpr std::array<std::uint8_t, 256> CHAR_CLASSES = [] {
+    std::array<std::uint8_t, 256> classes{};
+    for (unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) {
+        classes[c] = CHAR_SPACE | CHAR_DELIMITER;
+    }
+    for (unsigned char c : {'(', ')', '\'', '`', ',', '"'}) {
+        classes[c] = CHAR_DELIMITER;
+    }
+    return classes;
+}();
+
+inline bool isSpace(char c) {
+    return CHAR_CLASSES[static_cast<unsigned char>(c)] & CHAR_SPACE;
+}
+inline bool isDelimiter(char c) {
+    return CHAR_CLASSES[static_cast<unsigned char>(c)] & CHAR_DELIMITER;
+}
+
+// Searches of text for the end of a run of characters, in a scalar version
+// and in SIMD versions for the instruction sets the processor supports, as
+// F64Kernels picks them. Each returns the position of the first character at
+// or after `pos` that ends the run, or `size` if there is none.
+struct ScanKernels {
+    const char* name;
+    // The end of whitespace.
+    std::size_t (*skipSpace)(const char* text, std::size_t size, std::size_t pos);
+    // The end of a comment.
+    std::size_t (*findNewline)(const char* text, std::size_t size, std::size_t pos);
+    // The end of an atom.
+    std::size_t (*findDelimiter)(const char* text, std::size_t size, std::size_t pos);
+    // The end of a string literal, or an escape sequence in it.
+    std::size_t (*findStringEnd)(const char* text, std::size_t size, std::size_t pos);
+
+    static const ScanKernels& get();
+    // Every version, the scalar one first, then the ones this processor
+    // supports. For benchmarks and tests.
+    static std::vector<const ScanKernels*> available();
+};
+
+#endif
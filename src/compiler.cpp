@@ -0,0 +1,238 @@
+#include "./compiler.h"
+
+#include <algorithm>
+#include <new>
+
+#include "./builtins.h"
+#include "./bytecode.h"
+#include "./error.h"
+#include "./eval_env.h"
+#include "./forms.h"
+
+namespace rg = std::ranges;
+
+namespace {
+
+const SymbolId QUOTE = IdentifierValue::idOf("quote");
+const SymbolId QUASIQUOTE = IdentifierValue::idOf("quasiquote");
+const SymbolId LAMBDA = IdentifierValue::idOf("lambda");
+const SymbolId LET = IdentifierValue::idOf("let");
+const SymbolId DEFINE = IdentifierValue::idOf("define");
+
+}  // namespace
+
+std::size_t Compiler::foldedCount{0};
+
+void Compiler::declare(Scope& scope, SymbolId name) {
+    if (rg::find(scope, name) == scope.end()) {
+        scope.push_back(name);
+    }
+}
+
+// Gives every name defined by `expr` (outside nested lambdas) a slot in
+// `scope`, so that internal defines address the frame like parameters do.
+void Compiler::collectDefines(ValuePtr expr, Scope& scope) {
+    if (!expr.isPair() || !expr.isList()) {
+        return;
+    }
+    auto&& [car, cdr] = expr.asPair();
+    auto head = car.getSymbolId();
+    if (head == QUOTE || head == QUASIQUOTE || head == LAMBDA) {
+        return;
+    } else if (head == LET) {
+        if (cdr.isPair() && cdr.asPair().getCar().isList()) {
+            for (auto binding : cdr.asPair().getCar().toVector()) {
+                if (binding.isList()) {
+                    collectBody(binding, scope);
+                }
+            }
+        }
+        return;
+    } else if (head == DEFINE && cdr.isPair()) {
+        auto&& target = cdr.asPair().getCar();
+        if (auto name = target.getSymbolId()) {
+            declare(scope, *name);
+            collectBody(cdr.asPair().getCdr(), scope);
+        } else if (target.isPair()) {
+            if (auto name = target.asPair().getCar().getSymbolId()) {
+                declare(scope, *name);
+            }
+        }
+        return;
+    }
+    collectBody(expr, scope);
+}
+
+void Compiler::collectBody(ValuePtr body, Scope& scope) {
+    for (; body.isPair(); body = body.asPair().getCdr()) {
+        collectDefines(body.asPair().getCar(), scope);
+    }
+}
+
+std::optional<std::pair<std::uint32_t, std::uint32_t>> Compiler::resolve(SymbolId name) const {
+    for (std::size_t depth = 0; depth < frames.size(); depth++) {
+        auto&& blocks = frames[frames.size() - 1 - depth].blocks;
+        for (auto block = blocks.rbegin(); block != blocks.rend(); ++block) {
+            auto&& names = block->names;
+            // Search backwards so that the last of duplicated let names wins.
+            if (auto it = rg::find(names.rbegin(), names.rend(), name); it != names.rend()) {
+                return std::pair{static_cast<std::uint32_t>(depth),
+                                 static_cast<std::uint32_t>(block->base + (names.rend() - it - 1))};
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+std::uint32_t Compiler::openBlock(Scope names, ValuePtr body) {
+    collectBody(body, names);
+    auto&& frame = frames.back();
+    auto base = frame.size;
+    frame.size += names.size();
+    frame.blocks.push_back({std::move(names), base});
+    return base;
+}
+
+Node* Compiler::compile(ValuePtr expr) {
+    switch (expr.getType()) {
+        case ValueType::SYMBOL:
+            return compileVariable(static_cast<const IdentifierValue*>(expr.get())->getId());
+        case ValueType::BOOLEAN:
+        case ValueType::NUMBER:
+        case ValueType::STRING:
+        case ValueType::VECTOR: return makeNode<ConstantNode>(expr);
+        case ValueType::NIL: return makeNode<ErrorNode>("Shouldn't evaluate empty list");
+        case ValueType::PAIR:
+            if (expr.isList()) {
+                break;
+            }
+            [[fallthrough]];
+        default: return makeNode<ErrorNode>("Malformed list " + expr.toString());
+    }
+    auto&& [car, cdr] = expr.asPair();
+    auto name = car.getSymbolId();
+    if (name && SPECIAL_FORMS.contains(*name)) {
+        return compileForm(*name, cdr);
+    }
+    NodeVector args;
+    for (auto operands = cdr; operands.isPair(); operands = operands.asPair().getCdr()) {
+        args.push_back(compile(operands.asPair().getCar()));
+    }
+    if (name && !resolve(*name)) {
+        if (auto primitive = findPrimitive(*name, args.size())) {
+            return fold(*name, args, makeNode<PrimitiveCallNode>(*primitive, *name, args));
+        }
+        auto callee = makeNode<GlobalNode>(*name);
+        return fold(*name, args, makeNode<CallNode>(callee, args));
+    }
+    auto callee = compile(car);
+    return makeNode<CallNode>(callee, args);
+}
+
+// Folding happens bottom up: an argument may itself be a folded call, whose
+// guards the result inherits.
+Node* Compiler::fold(SymbolId name, const NodeVector& args, Node* call) {
+    auto binding = env.findBinding(name);
+    if (!binding || binding->value.getType() != ValueType::BUILTIN_PROC) {
+        return call;
+    }
+    auto func = static_cast<const BuiltinProcValue*>(binding->value.get())->getFunc();
+    if (!PURE_BUILTINS.contains(func)) {
+        return call;
+    }
+    std::vector<FoldedNode::Guard> guards{{name, binding}};
+    ArgBuffer values;
+    for (auto arg : args) {
+        if (auto constant = dynamic_cast<const ConstantNode*>(arg)) {
+            values.push_back(constant->getValue());
+        } else if (auto folded = dynamic_cast<const FoldedNode*>(arg)) {
+            values.push_back(folded->getValue());
+            for (auto&& guard : folded->getGuards()) {
+                if (rg::find(guards, guard.binding, &FoldedNode::Guard::binding) == guards.end()) {
+                    guards.push_back(guard);
+                }
+            }
+        } else {
+            return call;
+        }
+    }
+    ValuePtr value;
+    try {
+        value = func(values, env);
+    } catch (LispError&) {
+        // Left for run time, which reports the error if the call is reached.
+        return call;
+    } catch (std::bad_alloc&) {
+        // So is a result too large to build.
+        return call;
+    }
+    foldedCount++;
+    return makeNode<FoldedNode>(value, std::move(guards), call);
+}
+
+// Errors in special forms nested inside a larger form are deferred to run
+// time, so that a malformed branch that is never taken stays harmless.
+Node* Compiler::compileForm(SymbolId name, ValuePtr operands) {
+    auto depth = frames.size();
+    auto blockDepth = frames.back().blocks.size();
+    try {
+        return SPECIAL_FORMS.at(name)(operands, *this);
+    } catch (LispError& e) {
+        frames.resize(depth);
+        frames.back().blocks.resize(blockDepth);
+        return makeNode<ErrorNode>(e.what());
+    }
+}
+
+Node* Compiler::compileBody(ValuePtr body) {
+    NodeVector nodes;
+    for (; body.isPair(); body = body.asPair().getCdr()) {
+        nodes.push_back(compile(body.asPair().getCar()));
+    }
+    return nodes.size() == 1 ? nodes[0] : makeNode<SequenceNode>(nodes);
+}
+
+Node* Compiler::compileVariable(SymbolId name) {
+    if (auto address = resolve(name)) {
+        return makeNode<LocalNode>(address->first, address->second, name);
+    }
+    return makeNode<GlobalNode>(name);
+}
+
+Node* Compiler::compileDefine(SymbolId name, Node* value) {
+    if (auto&& blocks = frames.back().blocks; !blocks.empty()) {
+        auto&& [names, base] = blocks.back();
+        if (auto it = rg::find(names.rbegin(), names.rend(), name); it != names.rend()) {
+            auto slot = base + static_cast<std::uint32_t>(names.rend() - it - 1);
+            return makeNode<DefineLocalNode>(slot, name, value);
+        }
+    }
+    return makeNode<DefineGlobalNode>(name, value);
+}
+
+LambdaNode* Compiler::compileProcedure(Scope params, ValuePtr body) {
+    auto paramCount = params.size();
+    frames.emplace_back();
+    openBlock(std::move(params), body);
+    auto node = compileBody(body);
+    auto frameSize = frames.back().size;
+    frames.pop_back();
+    return makeNode<LambdaNode>(paramCount, frameSize, node);
+}
+
+Node* Compiler::compileLet(Scope names, const NodeVector& values, ValuePtr body) {
+    auto slot = openBlock(std::move(names), body);
+    auto node = compileBody(body);
+    frames.back().blocks.pop_back();
+    return makeNode<LetNode>(slot, values, node);
+}
+
+Prototype* Compiler::compileTopLevel(ValuePtr expr) {
+    frames.emplace_back();
+    auto node = compile(std::move(expr));
+    auto proto = new Prototype(0, frames.back().size);
+    frames.pop_back();
+    CodeBuilder builder(proto);
+    node->emit(builder, true);
+    return proto;
+}
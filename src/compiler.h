@@ -0,0 +1,76 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "./node.h"
+#include "./value.h"
+
+class EvaluateEnv;
+class Prototype;
+
+// Turns expressions into node trees, and top-level forms into bytecode.
+// Local variables are resolved to (depth, slot) coordinates in their frame
+// when the enclosing lambda is compiled; names that are not bound locally are
+// looked up in the global environment at run time, so definitions may come
+// late. Calls of pure builtins on constants are folded into their values.
+class Compiler {
+private:
+    // The global environment the code will run in.
+    EvaluateEnv& env;
+    static std::size_t foldedCount;
+
+    // Names bound by a parameter list or a let, in slot order.
+    using Scope = std::vector<SymbolId>;
+    // A scope whose names occupy the slots of the frame from `base` on.
+    struct Block {
+        Scope names;
+        std::uint32_t base;
+    };
+    // The frame of a lambda or top-level form. Let bodies run in the frame
+    // of the code around them, in slots of their own.
+    struct Frame {
+        std::vector<Block> blocks;  // innermost last
+        std::uint32_t size{0};
+    };
+    // Innermost frame last.
+    std::vector<Frame> frames;
+
+    static void declare(Scope& scope, SymbolId name);
+    void collectDefines(ValuePtr expr, Scope& scope);
+    void collectBody(ValuePtr body, Scope& scope);
+    std::optional<std::pair<std::uint32_t, std::uint32_t>> resolve(SymbolId name) const;
+    // Gives `names` and the internal defines of `body` slots in the current
+    // frame, returning the first.
+    std::uint32_t openBlock(Scope names, ValuePtr body);
+
+    Node* compileForm(SymbolId name, ValuePtr operands);
+    // `call`, or its value if the global `name` holds a pure builtin and
+    // the arguments are constants.
+    Node* fold(SymbolId name, const NodeVector& args, Node* call);
+
+public:
+    explicit Compiler(EvaluateEnv& env) : env{env} {}
+
+    // The number of calls folded since the program started.
+    static std::size_t getFoldedCount() {
+        return foldedCount;
+    }
+
+    Node* compile(ValuePtr expr);
+    // A non-empty list of expressions, evaluated in order.
+    Node* compileBody(ValuePtr body);
+    Node* compileVariable(SymbolId name);
+    Node* compileDefine(SymbolId name, Node* value);
+    // Compiles `body` in a new frame holding `params` and its internal defines.
+    LambdaNode* compileProcedure(Scope params, ValuePtr body);
+    // Compiles `body` with `names` bound to `values`, which are compiled in
+    // the enclosing scope.
+    Node* compileLet(Scope names, const NodeVector& values, ValuePtr body);
+    // Compiles a form into bytecode run in the global environment.
+    Prototype* compileTopLevel(ValuePtr expr);
+};
+
+#endif
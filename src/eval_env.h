@@ -2,32 +2,65 @@
 #define EVALUATOR_H
 
 #include <memory>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "./gc.h"
 #include "./value.h"
 
-class EvaluateEnv : public std::enable_shared_from_this<EvaluateEnv> {
+// A global variable. Bindings are never removed, so compiled code may keep a
+// pointer to one; `version` counts the definitions of the name, so that what
+// was learnt about the value can be checked cheaply.
+struct GlobalBinding {
+    ValuePtr value;
+    std::uint32_t version{0};
+};
+
+class EvaluateEnv : public GcObject {
 private:
-    std::shared_ptr<EvaluateEnv> parent;
-    std::unordered_map<std::string, ValuePtr> bindings;
+    EvaluateEnv* parent{nullptr};
+    EvaluateEnv* global{this};
+    // Frames of activations whose code creates closures, addressed by slot.
+    std::vector<ValuePtr> slots;
+    // Global environment: keyed by name, so that definitions may come late.
+    std::unordered_map<SymbolId, GlobalBinding> bindings;
 
     EvaluateEnv() = default;
 
 public:
-    EvaluateEnv(const EvaluateEnv&) = delete;
-
-    static std::shared_ptr<EvaluateEnv> createGlobal();
-    std::shared_ptr<EvaluateEnv> createChild(const std::vector<std::string>& params,
-                                             const std::vector<ValuePtr>& args);
+    static EvaluateEnv* createGlobal();
+    EvaluateEnv* createChild(std::size_t frameSize, ArgSpan args);
+    EvaluateEnv* getParent() const {
+        return parent;
+    }
+    EvaluateEnv& getGlobal() const {
+        return *global;
+    }
 
+    // Compiles a top-level form and runs it. Local variables of this frame
+    // are not visible to `expr`; it is meant for the global environment.
     ValuePtr eval(ValuePtr expr);
-    std::vector<ValuePtr> evalList(ValuePtr expr);
-    ValuePtr apply(ValuePtr operator_, const std::vector<ValuePtr>& operands);
+    ValuePtr apply(ValuePtr operator_, ArgSpan operands);
+
+    void defineBinding(SymbolId name, ValuePtr value);
+    ValuePtr lookupBinding(SymbolId name) const;
+    // nullptr if `name` has never been defined.
+    GlobalBinding* findBinding(SymbolId name) const;
+    ValuePtr* getSlots() {
+        return slots.data();
+    }
+    // The empty handle if the slot has not been defined yet.
+    const ValuePtr& lookupLocal(std::uint32_t depth, std::uint32_t slot) const {
+        auto env = this;
+        for (; depth > 0; depth--) {
+            env = env->parent;
+        }
+        return env->slots[slot];
+    }
 
-    void defineBinding(const std::string& name, ValuePtr value);
-    ValuePtr lookupBinding(const std::string& name) const;
+    void trace(GcTracer& tracer) const override;
 };
 
-#endif
\ No newline at end of file
+#endif
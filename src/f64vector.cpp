@@ -0,0 +1,421 @@
+#include "./f64vector.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MINI_LISP_X86_SIMD
+#include <immintrin.h>
+#endif
+
+std::string F64VectorValue::toString() const {
+    std::stringstream ss;
+    ss << "#f64(";
+    for (std::size_t i = 0; i < elements.size(); i++) {
+        ss << (i ? " " : "") << ValuePtr::fromNumber(elements[i]);
+    }
+    ss << ")";
+    return ss.str();
+}
+
+namespace {
+
+// The accumulations of sum, dot, min and max; element i goes to lane i % LANES.
+constexpr std::size_t LANES{8};
+constexpr double INF{std::numeric_limits<double>::infinity()};
+constexpr double NaN{std::numeric_limits<double>::quiet_NaN()};
+
+// As MINPD and MAXPD compute them, which gives `acc` on a NaN `x`.
+double minOf(double x, double acc) {
+    return x < acc ? x : acc;
+}
+double maxOf(double x, double acc) {
+    return x > acc ? x : acc;
+}
+
+// Reductions finish the same way whichever version fills the lanes.
+
+double finishSum(const double* lanes, const double* a, std::size_t i, std::size_t n) {
+    auto sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+               ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (; i < n; i++) {
+        sum += a[i];
+    }
+    return sum;
+}
+
+double finishDot(const double* lanes, const double* a, const double* b, std::size_t i,
+                 std::size_t n) {
+    auto sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+               ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+template <double (*Op)(double, double)>
+double finishExtreme(const double* lanes, bool nan, const double* a, std::size_t i,
+                     std::size_t n) {
+    auto result = Op(Op(Op(lanes[0], lanes[1]), Op(lanes[2], lanes[3])),
+                     Op(Op(lanes[4], lanes[5]), Op(lanes[6], lanes[7])));
+    for (; i < n; i++) {
+        nan |= a[i] != a[i];
+        result = Op(a[i], result);
+    }
+    return nan ? NaN : result;
+}
+
+namespace scalar {
+
+template <typename F>
+void elementwise(const double* a, const double* b, double* out, std::size_t n, F op) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = op(a[i], b[i]);
+    }
+}
+
+void add(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](double x, double y) { return x + y; });
+}
+void sub(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](double x, double y) { return x - y; });
+}
+void mul(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](double x, double y) { return x * y; });
+}
+void div(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](double x, double y) { return x / y; });
+}
+void scale(const double* a, double factor, double* out, std::size_t n) {
+    for (std::size_t i = 0; i < n; i++) {
+        out[i] = a[i] * factor;
+    }
+}
+
+double sum(const double* a, std::size_t n) {
+    double lanes[LANES]{};
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < LANES; j++) {
+            lanes[j] += a[i + j];
+        }
+    }
+    return finishSum(lanes, a, i, n);
+}
+
+double dot(const double* a, const double* b, std::size_t n) {
+    double lanes[LANES]{};
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < LANES; j++) {
+            lanes[j] += a[i + j] * b[i + j];
+        }
+    }
+    return finishDot(lanes, a, b, i, n);
+}
+
+template <double (*Op)(double, double)>
+double extreme(const double* a, std::size_t n, double initial) {
+    double lanes[LANES];
+    std::fill(lanes, lanes + LANES, initial);
+    bool nan = false;
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < LANES; j++) {
+            nan |= a[i + j] != a[i + j];
+            lanes[j] = Op(a[i + j], lanes[j]);
+        }
+    }
+    return finishExtreme<Op>(lanes, nan, a, i, n);
+}
+
+double min(const double* a, std::size_t n) {
+    return extreme<minOf>(a, n, INF);
+}
+double max(const double* a, std::size_t n) {
+    return extreme<maxOf>(a, n, -INF);
+}
+
+void prefixSum(const double* a, double* out, std::size_t n) {
+    double carry = 0;
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto first = a[i];
+        auto both = a[i] + a[i + 1];
+        out[i] = carry + first;
+        out[i + 1] = carry = carry + both;
+    }
+    for (; i < n; i++) {
+        out[i] = carry = carry + a[i];
+    }
+}
+
+constexpr F64Kernels KERNELS{"scalar", add, sub, mul, div, scale, sum, dot, min, max, prefixSum};
+
+}  // namespace scalar
+
+#ifdef MINI_LISP_X86_SIMD
+
+// SSE2 is part of x86-64, so this version needs no check.
+namespace sse2 {
+
+template <typename F>
+void elementwise(const double* a, const double* b, double* out, std::size_t n, F op) {
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, op(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    }
+    for (; i < n; i++) {
+        out[i] = _mm_cvtsd_f64(op(_mm_set_sd(a[i]), _mm_set_sd(b[i])));
+    }
+}
+
+void add(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](__m128d x, __m128d y) { return _mm_add_pd(x, y); });
+}
+void sub(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](__m128d x, __m128d y) { return _mm_sub_pd(x, y); });
+}
+void mul(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](__m128d x, __m128d y) { return _mm_mul_pd(x, y); });
+}
+void div(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise(a, b, out, n, [](__m128d x, __m128d y) { return _mm_div_pd(x, y); });
+}
+void scale(const double* a, double factor, double* out, std::size_t n) {
+    auto f = _mm_set1_pd(factor);
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), f));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] * factor;
+    }
+}
+
+double sum(const double* a, std::size_t n) {
+    __m128d acc[4]{_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < 4; j++) {
+            acc[j] = _mm_add_pd(acc[j], _mm_loadu_pd(a + i + 2 * j));
+        }
+    }
+    double lanes[LANES];
+    for (std::size_t j = 0; j < 4; j++) {
+        _mm_storeu_pd(lanes + 2 * j, acc[j]);
+    }
+    return finishSum(lanes, a, i, n);
+}
+
+double dot(const double* a, const double* b, std::size_t n) {
+    __m128d acc[4]{_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < 4; j++) {
+            auto product = _mm_mul_pd(_mm_loadu_pd(a + i + 2 * j), _mm_loadu_pd(b + i + 2 * j));
+            acc[j] = _mm_add_pd(acc[j], product);
+        }
+    }
+    double lanes[LANES];
+    for (std::size_t j = 0; j < 4; j++) {
+        _mm_storeu_pd(lanes + 2 * j, acc[j]);
+    }
+    return finishDot(lanes, a, b, i, n);
+}
+
+template <__m128d (*Op)(__m128d, __m128d), double (*ScalarOp)(double, double)>
+double extreme(const double* a, std::size_t n, double initial) {
+    __m128d acc[4];
+    std::fill(acc, acc + 4, _mm_set1_pd(initial));
+    auto nan = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        for (std::size_t j = 0; j < 4; j++) {
+            auto x = _mm_loadu_pd(a + i + 2 * j);
+            nan = _mm_or_pd(nan, _mm_cmpunord_pd(x, x));
+            acc[j] = Op(x, acc[j]);
+        }
+    }
+    double lanes[LANES];
+    for (std::size_t j = 0; j < 4; j++) {
+        _mm_storeu_pd(lanes + 2 * j, acc[j]);
+    }
+    return finishExtreme<ScalarOp>(lanes, _mm_movemask_pd(nan) != 0, a, i, n);
+}
+
+__m128d minPd(__m128d x, __m128d acc) {
+    return _mm_min_pd(x, acc);
+}
+__m128d maxPd(__m128d x, __m128d acc) {
+    return _mm_max_pd(x, acc);
+}
+
+double min(const double* a, std::size_t n) {
+    return extreme<minPd, minOf>(a, n, INF);
+}
+double max(const double* a, std::size_t n) {
+    return extreme<maxPd, maxOf>(a, n, -INF);
+}
+
+void prefixSum(const double* a, double* out, std::size_t n) {
+    auto carry = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        auto x = _mm_loadu_pd(a + i);
+        // {a[i], a[i] + a[i + 1]}
+        auto pair = _mm_add_pd(x, _mm_shuffle_pd(_mm_setzero_pd(), x, 0));
+        auto result = _mm_add_pd(carry, pair);
+        _mm_storeu_pd(out + i, result);
+        carry = _mm_unpackhi_pd(result, result);
+    }
+    for (auto c = _mm_cvtsd_f64(carry); i < n; i++) {
+        out[i] = c = c + a[i];
+    }
+}
+
+constexpr F64Kernels KERNELS{"sse2", add, sub, mul, div, scale, sum, dot, min, max, prefixSum};
+
+}  // namespace sse2
+
+// Prefix sums would need lane crossings that cost more than they save, so
+// this version shares SSE2's.
+namespace avx2 {
+
+#define MINI_LISP_AVX2 __attribute__((target("avx2")))
+
+enum class Arithmetic {
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+};
+
+// The last elements, fewer than a register holds, are left to `tail`.
+template <Arithmetic Op, void (*tail)(const double*, const double*, double*, std::size_t)>
+MINI_LISP_AVX2 void elementwise(const double* a, const double* b, double* out, std::size_t n) {
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        auto x = _mm256_loadu_pd(a + i);
+        auto y = _mm256_loadu_pd(b + i);
+        if constexpr (Op == Arithmetic::ADD) {
+            x = _mm256_add_pd(x, y);
+        } else if constexpr (Op == Arithmetic::SUB) {
+            x = _mm256_sub_pd(x, y);
+        } else if constexpr (Op == Arithmetic::MUL) {
+            x = _mm256_mul_pd(x, y);
+        } else {
+            x = _mm256_div_pd(x, y);
+        }
+        _mm256_storeu_pd(out + i, x);
+    }
+    tail(a + i, b + i, out + i, n - i);
+}
+
+MINI_LISP_AVX2 void add(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise<Arithmetic::ADD, scalar::add>(a, b, out, n);
+}
+MINI_LISP_AVX2 void sub(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise<Arithmetic::SUB, scalar::sub>(a, b, out, n);
+}
+MINI_LISP_AVX2 void mul(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise<Arithmetic::MUL, scalar::mul>(a, b, out, n);
+}
+MINI_LISP_AVX2 void div(const double* a, const double* b, double* out, std::size_t n) {
+    elementwise<Arithmetic::DIV, scalar::div>(a, b, out, n);
+}
+MINI_LISP_AVX2 void scale(const double* a, double factor, double* out, std::size_t n) {
+    auto f = _mm256_set1_pd(factor);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), f));
+    }
+    for (; i < n; i++) {
+        out[i] = a[i] * factor;
+    }
+}
+
+MINI_LISP_AVX2 double sum(const double* a, std::size_t n) {
+    auto low = _mm256_setzero_pd();
+    auto high = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        low = _mm256_add_pd(low, _mm256_loadu_pd(a + i));
+        high = _mm256_add_pd(high, _mm256_loadu_pd(a + i + 4));
+    }
+    double lanes[LANES];
+    _mm256_storeu_pd(lanes, low);
+    _mm256_storeu_pd(lanes + 4, high);
+    return finishSum(lanes, a, i, n);
+}
+
+MINI_LISP_AVX2 double dot(const double* a, const double* b, std::size_t n) {
+    auto low = _mm256_setzero_pd();
+    auto high = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        // Multiplied and added separately, as without FMA in the other versions.
+        low = _mm256_add_pd(low, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        high = _mm256_add_pd(
+            high, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+    }
+    double lanes[LANES];
+    _mm256_storeu_pd(lanes, low);
+    _mm256_storeu_pd(lanes + 4, high);
+    return finishDot(lanes, a, b, i, n);
+}
+
+template <bool Min>
+MINI_LISP_AVX2 double extreme(const double* a, std::size_t n, double initial) {
+    auto low = _mm256_set1_pd(initial);
+    auto high = low;
+    auto nan = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + LANES <= n; i += LANES) {
+        auto x = _mm256_loadu_pd(a + i);
+        auto y = _mm256_loadu_pd(a + i + 4);
+        nan = _mm256_or_pd(nan, _mm256_cmp_pd(x, y, _CMP_UNORD_Q));
+        low = Min ? _mm256_min_pd(x, low) : _mm256_max_pd(x, low);
+        high = Min ? _mm256_min_pd(y, high) : _mm256_max_pd(y, high);
+    }
+    double lanes[LANES];
+    _mm256_storeu_pd(lanes, low);
+    _mm256_storeu_pd(lanes + 4, high);
+    return finishExtreme<Min ? minOf : maxOf>(lanes, _mm256_movemask_pd(nan) != 0, a, i, n);
+}
+
+MINI_LISP_AVX2 double min(const double* a, std::size_t n) {
+    return extreme<true>(a, n, INF);
+}
+MINI_LISP_AVX2 double max(const double* a, std::size_t n) {
+    return extreme<false>(a, n, -INF);
+}
+
+#undef MINI_LISP_AVX2
+
+constexpr F64Kernels KERNELS{"avx2", add, sub, mul, div, scale, sum, dot, min, max,
+                             sse2::prefixSum};
+
+}  // namespace avx2
+
+#endif
+
+}  // namespace
+
+const F64Kernels& F64Kernels::get() {
+    static const F64Kernels& best = *available().back();
+    return best;
+}
+
+std::vector<const F64Kernels*> F64Kernels::available() {
+    std::vector<const F64Kernels*> kernels{&scalar::KERNELS};
+#ifdef MINI_LISP_X86_SIMD
+    kernels.push_back(&sse2::KERNELS);
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.push_back(&avx2::KERNELS);
+    }
+#endif
+    return kernels;
+}
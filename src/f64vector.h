@@ -0,0 +1,67 @@
+#ifndef F64VECTOR_H
+#define F64VECTOR_H
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "./value.h"
+
+// A fixed-size array of unboxed doubles, for numeric code that works on whole
+// arrays at a time; see F64Kernels.
+class F64VectorValue final : public Value {
+private:
+    std::vector<double> elements;
+
+public:
+    explicit F64VectorValue(std::vector<double> elements)
+        : Value(ValueType::F64VECTOR), elements{std::move(elements)} {
+        GcHeap::noteExternalAllocation(this->elements.capacity() * sizeof(double));
+    }
+    ~F64VectorValue() override {
+        GcHeap::noteExternalFree(elements.capacity() * sizeof(double));
+    }
+
+    std::size_t size() const {
+        return elements.size();
+    }
+    std::span<const double> getElements() const {
+        return elements;
+    }
+    std::span<double> getElements() {
+        return elements;
+    }
+
+    std::string toString() const override;
+};
+
+// Loops over arrays of doubles, in a scalar version and in SIMD versions for
+// the instruction sets the processor supports; get() picks the best one when
+// first called. Outputs may alias inputs.
+//
+// Sums, dot products and minimums run eight interleaved accumulations, and
+// prefix sums go by pairs of elements, in every version alike, so that the
+// results do not depend on the version that computes them, even though they
+// may differ in rounding from a plain left-to-right loop.
+struct F64Kernels {
+    const char* name;
+    void (*add)(const double* a, const double* b, double* out, std::size_t n);
+    void (*sub)(const double* a, const double* b, double* out, std::size_t n);
+    void (*mul)(const double* a, const double* b, double* out, std::size_t n);
+    void (*div)(const double* a, const double* b, double* out, std::size_t n);
+    void (*scale)(const double* a, double factor, double* out, std::size_t n);
+    double (*sum)(const double* a, std::size_t n);
+    double (*dot)(const double* a, const double* b, std::size_t n);
+    // NaN if any element is NaN; +inf and -inf of no elements.
+    double (*min)(const double* a, std::size_t n);
+    double (*max)(const double* a, std::size_t n);
+    void (*prefixSum)(const double* a, double* out, std::size_t n);
+
+    static const F64Kernels& get();
+    // Every version, the scalar one first, then the ones this processor
+    // supports. For benchmarks and tests.
+    static std::vector<const F64Kernels*> available();
+};
+
+#endif
@@ -5,11 +5,14 @@
 #include <unordered_set>
 
 #include "./error.h"
+#include "./compiler.h"
 
-std::vector<ValuePtr> checkOperandsCount(
-    ValuePtr operands, std::size_t min = 0,
-    std::size_t max = std::numeric_limits<std::size_t>::max()) {
-    auto vec = operands->toVector();
+const SymbolId UNQUOTE = IdentifierValue::idOf("unquote");
+const SymbolId QUASIQUOTE = IdentifierValue::idOf("quasiquote");
+const SymbolId ELSE = IdentifierValue::idOf("else");
+
+ValueVector checkOperandsCount(ValuePtr operands, std::size_t min, std::size_t max) {
+    auto vec = operands.toVector();
     if (vec.size() < min) {
         throw LispError("Too few operands: " + std::to_string(vec.size()) + " < " +
                         std::to_string(min));
@@ -20,173 +23,162 @@ std::vector<ValuePtr> checkOperandsCount(
     return vec;
 }
 
-ValuePtr lambdaForm(ValuePtr operands, EvaluateEnv& env) {
-    checkOperandsCount(operands, 2);
-    auto [formals, body] = std::move(operands->asPair());
-    std::vector<std::string> params;
-    std::unordered_set<std::string> paramSet;
-    while (formals->isPair()) {
-        auto&& [car, cdr] = formals->asPair();
-        if (auto name = car->getSymbolName()) {
+std::vector<SymbolId> parseParams(ValuePtr formals) {
+    std::vector<SymbolId> params;
+    std::unordered_set<SymbolId> paramSet;
+    while (formals.isPair()) {
+        auto&& [car, cdr] = formals.asPair();
+        if (auto name = car.getSymbolId()) {
             if (paramSet.count(*name)) {
-                throw LispError("Duplicate parameter name: " + *name);
+                throw LispError("Duplicate parameter name: " + car.toString());
             }
             params.push_back(*name);
             paramSet.insert(*name);
         } else {
-            throw LispError("Expect symbol in Lambda parameter, found " + car->toString());
+            throw LispError("Expect symbol in Lambda parameter, found " + car.toString());
         }
         formals = std::move(cdr);
     }
-    return std::make_shared<LambdaValue>(params, std::move(body), env.shared_from_this());
+    return params;
 }
 
-ValuePtr defineForm(ValuePtr operands, EvaluateEnv& env) {
+Node* lambdaForm(ValuePtr operands, Compiler& compiler) {
+    checkOperandsCount(operands, 2);
+    auto&& [formals, body] = operands.asPair();
+    return compiler.compileProcedure(parseParams(formals), body);
+}
+
+Node* defineForm(ValuePtr operands, Compiler& compiler) {
     auto args = checkOperandsCount(operands, 2);
-    if (auto name = args[0]->getSymbolName()) {
+    if (auto name = args[0].getSymbolId()) {
         if (args.size() > 2) {
             throw LispError("Too many operands: " + std::to_string(args.size()) + " < 2");
         }
-        env.defineBinding(*name, env.eval(args[1]));
-        return args[0];
-    } else if (args[0]->isPair()) {
-        auto&& [decl, body] = operands->asPair();
-        auto&& [car, cdr] = decl->asPair();
-        if (auto name = car->getSymbolName()) {
-            auto proc = lambdaForm(std::make_shared<PairValue>(cdr, body), env);
-            env.defineBinding(*name, proc);
-            return car;
+        auto value = compiler.compile(args[1]);
+        return compiler.compileDefine(*name, value);
+    } else if (args[0].isPair()) {
+        auto&& [decl, body] = operands.asPair();
+        auto&& [car, cdr] = decl.asPair();
+        if (auto name = car.getSymbolId()) {
+            auto proc = lambdaForm(makeValue<PairValue>(cdr, body), compiler);
+            return compiler.compileDefine(*name, proc);
         } else {
-            throw LispError("In lambda definition, " + car->toString() + " is not a symbol name");
+            throw LispError("In lambda definition, " + car.toString() + " is not a symbol name");
         }
     } else {
-        throw LispError("Malformed define form: " + args[0]->toString());
+        throw LispError("Malformed define form: " + args[0].toString());
     }
 }
 
-ValuePtr quasiquoteItem(ValuePtr val, EvaluateEnv& env, std::size_t level) {
-    if (!val->isPair()) {
-        return val;
+Node* quasiquoteItem(ValuePtr val, Compiler& compiler, std::size_t level) {
+    if (!val.isPair()) {
+        return makeNode<ConstantNode>(val);
     }
-    auto&& [car, cdr] = val->asPair();
-    if (auto name = car->getSymbolName()) {
-        if (*name == "unquote") {
+    auto&& [car, cdr] = val.asPair();
+    if (auto name = car.getSymbolId()) {
+        if (*name == UNQUOTE) {
             level--;
             if (level == 0) {
                 auto args = checkOperandsCount(cdr, 1, 1);
-                return env.eval(args[0]);
+                return compiler.compile(args[0]);
             }
-        } else if (*name == "quasiquote") {
+        } else if (*name == QUASIQUOTE) {
             level++;
         }
     }
-    auto car_ = quasiquoteItem(car, env, level);
-    auto cdr_ = quasiquoteItem(cdr, env, level);
-    return std::make_shared<PairValue>(std::move(car_), std::move(cdr_));
+    auto car_ = quasiquoteItem(car, compiler, level);
+    auto cdr_ = quasiquoteItem(cdr, compiler, level);
+    return makeNode<ConsNode>(car_, cdr_);
 }
 
-ValuePtr quoteForm(ValuePtr operands, EvaluateEnv& env) {
+Node* quoteForm(ValuePtr operands, Compiler& compiler) {
     auto args = checkOperandsCount(std::move(operands), 1, 1);
-    return args[0];
+    return makeNode<ConstantNode>(args[0]);
 }
 
-ValuePtr quasiquoteForm(ValuePtr operands, EvaluateEnv& env) {
+Node* quasiquoteForm(ValuePtr operands, Compiler& compiler) {
     auto args = checkOperandsCount(std::move(operands), 1, 1);
-    return quasiquoteItem(std::move(args[0]), env, 1);
+    return quasiquoteItem(std::move(args[0]), compiler, 1);
 }
 
-ValuePtr beginForm(ValuePtr operands, EvaluateEnv& env) {
+Node* beginForm(ValuePtr operands, Compiler& compiler) {
     checkOperandsCount(operands, 1);
-    auto result = env.evalList(std::move(operands));
-    return std::move(result.back());
+    return compiler.compileBody(operands);
 }
 
-ValuePtr ifForm(ValuePtr operands, EvaluateEnv& env) {
+Node* ifForm(ValuePtr operands, Compiler& compiler) {
     auto args = checkOperandsCount(operands, 2, 3);
-    if (env.eval(std::move(args[0]))->isTrue()) {
-        return env.eval(std::move(args[1]));
-    } else if (args.size() == 3) {
-        return env.eval(std::move(args[2]));
-    } else {
-        return Value::nil();
-    }
+    auto test = compiler.compile(args[0]);
+    auto consequent = compiler.compile(args[1]);
+    auto alternative = args.size() == 3 ? compiler.compile(args[2]) : nullptr;
+    return makeNode<IfNode>(test, consequent, alternative);
 }
 
-ValuePtr andForm(ValuePtr operands, EvaluateEnv& env) {
-    if (operands->isPair()) {
-        auto&& [car, cdr] = operands->asPair();
-        auto val = env.eval(std::move(car));
-        if (!val->isTrue()) {
-            return Value::fromBoolean(false);
-        } else if (cdr->isNil()) {
-            return val;
-        } else {
-            return andForm(std::move(cdr), env);
-        }
+Node* andForm(ValuePtr operands, Compiler& compiler) {
+    NodeVector nodes;
+    for (auto operand : operands.toVector()) {
+        nodes.push_back(compiler.compile(operand));
     }
-    return Value::fromBoolean(true);
+    return makeNode<AndNode>(nodes);
 }
 
-ValuePtr orForm(ValuePtr operands, EvaluateEnv& env) {
-    if (operands->isPair()) {
-        auto&& [car, cdr] = operands->asPair();
-        auto val = env.eval(std::move(car));
-        if (val->isTrue()) {
-            return val;
-        } else {
-            return orForm(std::move(cdr), env);
-        }
+Node* orForm(ValuePtr operands, Compiler& compiler) {
+    NodeVector nodes;
+    for (auto operand : operands.toVector()) {
+        nodes.push_back(compiler.compile(operand));
     }
-    return Value::fromBoolean(false);
+    return makeNode<OrNode>(nodes);
 }
 
-ValuePtr condForm(ValuePtr operands, EvaluateEnv& env) {
+Node* condForm(ValuePtr operands, Compiler& compiler) {
     auto vec = checkOperandsCount(operands);
+    NodeVector nodes;
+    std::vector<bool> isElse;
     for (auto clause : vec) {
         auto form = checkOperandsCount(clause, 1);
-        ValuePtr test;
-        if (auto name = form[0]->getSymbolName(); name && *name == "else") {
-            test = Value::fromBoolean(true);
+        if (form[0].getSymbolId() == ELSE) {
             if (clause != vec.back()) {
                 throw LispError("else clause must be the last one");
             }
+            nodes.push_back(nullptr);
         } else {
-            test = env.eval(form[0]);
-        }
-        if (test->isTrue()) {
-            if (form.size() > 1) {
-                return env.eval(form[1]);
-            } else {
-                return test;
-            }
+            nodes.push_back(compiler.compile(form[0]));
         }
+        nodes.push_back(form.size() > 1 ? compiler.compile(form[1]) : nullptr);
+    }
+    std::vector<CondNode::Clause> clauses;
+    for (std::size_t i = 0; i < nodes.size(); i += 2) {
+        clauses.push_back({nodes[i], nodes[i + 1]});
     }
-    return Value::nil();
+    return makeNode<CondNode>(std::move(clauses));
 }
 
-ValuePtr letForm(ValuePtr operands, EvaluateEnv& env) {
+Node* letForm(ValuePtr operands, Compiler& compiler) {
     checkOperandsCount(operands, 2);
-    auto&& [car, cdr] = operands->asPair();
+    auto&& [car, cdr] = operands.asPair();
     auto bindings = checkOperandsCount(std::move(car));
-    std::vector<std::string> names;
-    std::vector<ValuePtr> values;
+    std::vector<SymbolId> names;
+    NodeVector values;
     for (auto binding : bindings) {
         auto vec = checkOperandsCount(std::move(binding), 2, 2);
-        if (auto name = vec[0]->getSymbolName()) {
-            auto val = env.eval(std::move(vec[1]));
+        if (auto name = vec[0].getSymbolId()) {
             names.push_back(*name);
-            values.push_back(std::move(val));
+            values.push_back(compiler.compile(vec[1]));
         } else {
-            throw LispError("Expect let binding name, found " + vec[0]->toString());
+            throw LispError("Expect let binding name, found " + vec[0].toString());
         }
     }
-    auto newEnv = env.createChild(names, values);
-    auto results = newEnv->evalList(std::move(cdr));
-    return std::move(results.back());
+    return compiler.compileLet(std::move(names), values, cdr);
 }
 
-const std::unordered_map<std::string, SpecialFormType*> SPECIAL_FORMS{
-    {"define", defineForm}, {"quote", quoteForm}, {"quasiquote", quasiquoteForm},
-    {"lambda", lambdaForm}, {"begin", beginForm}, {"if", ifForm},
-    {"and", andForm},       {"or", orForm},       {"cond", condForm},
-    {"let", letForm}};
\ No newline at end of file
+const std::unordered_map<SymbolId, SpecialFormType*> SPECIAL_FORMS{
+    {IdentifierValue::idOf("define"), defineForm},
+    {IdentifierValue::idOf("quote"), quoteForm},
+    {IdentifierValue::idOf("quasiquote"), quasiquoteForm},
+    {IdentifierValue::idOf("lambda"), lambdaForm},
+    {IdentifierValue::idOf("begin"), beginForm},
+    {IdentifierValue::idOf("if"), ifForm},
+    {IdentifierValue::idOf("and"), andForm},
+    {IdentifierValue::idOf("or"), orForm},
+    {IdentifierValue::idOf("cond"), condForm},
+    {IdentifierValue::idOf("let"), letForm}};
\ No newline at end of file
@@ -1,16 +1,24 @@
 #ifndef FORMS_H
 #define FORMS_H
 
+#include <limits>
 #include <memory>
 #include <string>
 #include <unordered_map>
 
-#include "./eval_env.h"
+#include "./node.h"
 #include "./value.h"
 
 
-using SpecialFormType = ValuePtr(ValuePtr, EvaluateEnv&);
+ValueVector checkOperandsCount(ValuePtr operands, std::size_t min = 0,
+                               std::size_t max = std::numeric_limits<std::size_t>::max());
 
-extern const std::unordered_map<std::string, SpecialFormType*> SPECIAL_FORMS;
+class Compiler;
+
+// Special forms are compiled: each validates its operands and builds the node
+// that evaluates it.
+using SpecialFormType = Node*(ValuePtr, Compiler&);
+
+extern const std::unordered_map<SymbolId, SpecialFormType*> SPECIAL_FORMS;
 
 #endif
\ No newline at end of file
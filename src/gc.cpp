@@ -0,0 +1,196 @@
+#include "./gc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <csetjmp>
+#include <cstdlib>
+#include <iostream>
+
+#include "./slab.h"
+
+static_assert(GcHeap::MAX_OBJECT_SIZE == SlabAllocator::MAX_SIZE);
+
+namespace {
+
+// Low bits of a word that may hold an address; this also strips the tag of a
+// NaN-boxed ValuePtr.
+constexpr std::uintptr_t ADDRESS_MASK{(std::uintptr_t{1} << 48) - 1};
+
+struct HeapState {
+    GcRootRange* roots{nullptr};
+    const void* stackBottom{nullptr};
+    std::size_t budget{GcHeap::DEFAULT_BUDGET};
+    std::size_t allocatedSinceCollection{0};
+    // Live storage noted by noteExternalAllocation.
+    std::size_t externalBytes{0};
+    bool collectionRequested{false};
+    GcHeap::Stats stats{};
+};
+
+constinit thread_local HeapState heap;
+
+// Conservative scanning reads stack slots that are not live C++ objects.
+[[gnu::no_sanitize_address]] void scanRange(GcTracer& tracer, const void* begin, const void* end) {
+    auto first = (reinterpret_cast<std::uintptr_t>(begin) + alignof(std::uintptr_t) - 1) &
+                 ~(alignof(std::uintptr_t) - 1);
+    auto last = reinterpret_cast<std::uintptr_t>(end);
+    for (auto word = first; word + sizeof(std::uintptr_t) <= last; word += sizeof(std::uintptr_t)) {
+        auto address = *reinterpret_cast<const std::uintptr_t*>(word) & ADDRESS_MASK;
+        if (auto object = SlabAllocator::findObject(reinterpret_cast<const void*>(address))) {
+            tracer.mark(static_cast<const GcObject*>(object));
+        }
+    }
+}
+
+[[gnu::noinline]] void scanStackFromHere(GcTracer& tracer) {
+    std::uintptr_t top{0};
+    scanRange(tracer, &top, heap.stackBottom);
+}
+
+// Spills the callee-saved registers into this frame, then scans everything
+// between the innermost frame and the registered bottom of the stack.
+[[gnu::noinline]] void scanStack(GcTracer& tracer) {
+    std::jmp_buf registers;
+    setjmp(registers);
+#ifdef __GNUC__
+    __builtin_unwind_init();
+#endif
+    scanRange(tracer, &registers, &registers + 1);
+    scanStackFromHere(tracer);
+}
+
+}  // namespace
+
+void GcTracer::mark(const GcObject* object) {
+    if (object && !object->marked) {
+        object->marked = true;
+        worklist.push_back(object);
+    }
+}
+
+void* GcObject::operator new(std::size_t size) {
+    return GcHeap::allocate(size);
+}
+
+void GcObject::operator delete(void* ptr, std::size_t size) {
+    SlabAllocator::deallocate(ptr, size);
+}
+
+void* GcHeap::allocate(std::size_t size) {
+    if (size > MAX_OBJECT_SIZE) {
+        std::cerr << "Fatal: GcObject of " << size << " bytes exceeds the largest size class"
+                  << std::endl;
+        std::abort();
+    }
+    if (heap.stackBottom &&
+        heap.allocatedSinceCollection >= std::max<std::size_t>(heap.budget, heap.stats.liveBytes)) {
+        collect();
+    }
+    auto result = SlabAllocator::allocate(size);
+    heap.allocatedSinceCollection += size;
+    heap.stats.allocatedBytes += (size + SlabAllocator::GRANULE - 1) / SlabAllocator::GRANULE *
+                                 SlabAllocator::GRANULE;
+    return result;
+}
+
+void GcHeap::noteExternalAllocation(std::size_t bytes) {
+    heap.externalBytes += bytes;
+    heap.allocatedSinceCollection += bytes;
+    heap.stats.allocatedBytes += bytes;
+}
+
+void GcHeap::noteExternalFree(std::size_t bytes) {
+    heap.externalBytes -= std::min(bytes, heap.externalBytes);
+    heap.stats.freedBytes += bytes;
+}
+
+void GcHeap::registerStack(const void* bottom) {
+    heap.stackBottom = bottom;
+}
+
+void GcHeap::setCollectionBudget(std::size_t bytes) {
+    heap.budget = bytes;
+}
+
+void GcHeap::collect() {
+    auto start = std::chrono::steady_clock::now();
+
+    GcTracer tracer;
+    if (heap.stackBottom) {
+        scanStack(tracer);
+    }
+    for (auto range = heap.roots; range; range = range->next) {
+        scanRange(tracer, range->begin, range->end);
+    }
+    while (!tracer.worklist.empty()) {
+        auto object = tracer.worklist.back();
+        tracer.worklist.pop_back();
+        object->trace(tracer);
+    }
+
+    std::size_t live = 0;
+    std::size_t freed = 0;
+    SlabAllocator::forEachObject([&](void* memory, std::size_t size) {
+        auto object = static_cast<GcObject*>(memory);
+        if (object->marked) {
+            object->marked = false;
+            live += size;
+        } else {
+            object->~GcObject();
+            SlabAllocator::deallocate(memory, size);
+            freed += size;
+        }
+    });
+
+    std::chrono::duration<double, std::milli> pause = std::chrono::steady_clock::now() - start;
+    auto& stats = heap.stats;
+    stats.collections++;
+    // The sweep has run the destructors that free external storage.
+    stats.liveBytes = live + heap.externalBytes;
+    stats.freedBytes += freed;
+    stats.lastPauseMs = pause.count();
+    stats.maxPauseMs = std::max(stats.maxPauseMs, pause.count());
+    stats.totalPauseMs += pause.count();
+    heap.allocatedSinceCollection = 0;
+    heap.collectionRequested = false;
+}
+
+void GcHeap::requestCollection() {
+    if (heap.stackBottom) {
+        collect();
+    } else {
+        heap.collectionRequested = true;
+    }
+}
+
+void GcHeap::collectIfNeeded() {
+    if (heap.collectionRequested ||
+        heap.allocatedSinceCollection >= std::max<std::size_t>(heap.budget, heap.stats.liveBytes)) {
+        collect();
+    }
+}
+
+GcHeap::Stats GcHeap::stats() {
+    auto result = heap.stats;
+    result.heapBytes = 0;
+    for (auto& sizeClass : SlabAllocator::stats()) {
+        result.heapBytes += sizeClass.reservedBytes;
+    }
+    return result;
+}
+
+void GcHeap::addRoot(GcRootRange& range) {
+    range.prev = nullptr;
+    range.next = heap.roots;
+    if (heap.roots) {
+        heap.roots->prev = &range;
+    }
+    heap.roots = &range;
+}
+
+void GcHeap::removeRoot(GcRootRange& range) {
+    (range.prev ? range.prev->next : heap.roots) = range.next;
+    if (range.next) {
+        range.next->prev = range.prev;
+    }
+}
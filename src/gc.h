@@ -0,0 +1,159 @@
+#ifndef GC_H
+#define GC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+class GcObject;
+
+// Marks objects as reachable and queues them so that their own references
+// are traced in turn.
+class GcTracer {
+private:
+    std::vector<const GcObject*> worklist;
+    friend class GcHeap;
+
+public:
+    void mark(const GcObject* object);
+};
+
+// Base of every object owned by the garbage collector. Storage comes from the
+// slab allocator and is reclaimed by GcHeap::collect once the object is
+// unreachable. Destructors of GcObjects must not touch other GcObjects, and
+// constructors must not allocate them.
+class GcObject {
+private:
+    mutable bool marked{false};
+    friend class GcTracer;
+    friend class GcHeap;
+
+public:
+    GcObject() = default;
+    GcObject(const GcObject&) = delete;
+    GcObject& operator=(const GcObject&) = delete;
+    virtual ~GcObject() = default;
+
+    // Marks every GcObject directly referenced by this one.
+    virtual void trace(GcTracer&) const {}
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+};
+
+// A memory range that the collector scans conservatively for references.
+struct GcRootRange {
+    GcRootRange* prev;
+    GcRootRange* next;
+    const void* begin;
+    const void* end;
+};
+
+// A non-moving mark-sweep collector. Roots are the registered part of the
+// C++ stack (scanned conservatively, along with the callee-saved registers)
+// and every registered GcRootRange. Collections start automatically when the
+// bytes allocated since the previous one exceed the collection budget, or the
+// live heap size if that is larger. Every thread has its own heap.
+class GcHeap {
+public:
+    struct Stats {
+        std::uint64_t collections;
+        std::uint64_t heapBytes;
+        std::uint64_t liveBytes;
+        std::uint64_t allocatedBytes;
+        std::uint64_t freedBytes;
+        double lastPauseMs;
+        double maxPauseMs;
+        double totalPauseMs;
+    };
+
+    static constexpr std::size_t DEFAULT_BUDGET{4 * 1024 * 1024};
+    // The largest GcObject the collector can hold; larger ones would be
+    // allocated outside the slabs, where it cannot find them.
+    static constexpr std::size_t MAX_OBJECT_SIZE{256};
+
+    // Enables automatic collection on this thread. `bottom` must be the
+    // address of a local in a frame that encloses every use of the heap.
+    static void registerStack(const void* bottom);
+    static void setCollectionBudget(std::size_t bytes);
+
+    static void collect();
+    // Collects now if the stack can be scanned, otherwise at the next
+    // collectIfNeeded.
+    static void requestCollection();
+    // Collects if the budget is exhausted or a collection was requested.
+    // Meant for safe points where every live reference is reachable from a
+    // registered root, e.g. when the stack cannot be scanned.
+    static void collectIfNeeded();
+    static Stats stats();
+
+    // Storage that GcObjects own outside the slabs, e.g. the elements of a
+    // vector, counts toward the budget and the live heap size like the objects
+    // themselves, so that collections keep pace with it. Owners note it when
+    // they allocate it and when their destructor frees it.
+    static void noteExternalAllocation(std::size_t bytes);
+    static void noteExternalFree(std::size_t bytes);
+
+    static void addRoot(GcRootRange& range);
+    static void removeRoot(GcRootRange& range);
+
+private:
+    friend class GcObject;
+    static void* allocate(std::size_t size);
+};
+
+// Keeps whatever the given variable refers to alive while in scope, wherever
+// the variable itself is stored.
+class GcRoot {
+private:
+    GcRootRange range;
+
+public:
+    template <typename T>
+    explicit GcRoot(const T& slot) : range{nullptr, nullptr, &slot, &slot + 1} {
+        GcHeap::addRoot(range);
+    }
+    GcRoot(const GcRoot&) = delete;
+    GcRoot& operator=(const GcRoot&) = delete;
+    ~GcRoot() {
+        GcHeap::removeRoot(range);
+    }
+};
+
+// An allocator whose storage is a GC root, for C++-side containers holding
+// references to GcObjects. Containers inside GcObjects must not use it; they
+// are traced instead.
+template <typename T>
+class GcRootAllocator {
+private:
+    static constexpr std::size_t HEADER_SIZE{(sizeof(GcRootRange) + alignof(T) - 1) /
+                                             alignof(T) * alignof(T)};
+
+public:
+    using value_type = T;
+
+    GcRootAllocator() = default;
+    template <typename U>
+    GcRootAllocator(const GcRootAllocator<U>&) {}
+
+    T* allocate(std::size_t n) {
+        auto memory = static_cast<char*>(::operator new(HEADER_SIZE + n * sizeof(T)));
+        auto data = reinterpret_cast<T*>(memory + HEADER_SIZE);
+        auto range = new (memory) GcRootRange{nullptr, nullptr, data, data + n};
+        GcHeap::addRoot(*range);
+        return data;
+    }
+    void deallocate(T* data, std::size_t) {
+        auto memory = reinterpret_cast<char*>(data) - HEADER_SIZE;
+        GcHeap::removeRoot(*reinterpret_cast<GcRootRange*>(memory));
+        ::operator delete(memory);
+    }
+
+    template <typename U>
+    bool operator==(const GcRootAllocator<U>&) const {
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "./hash_table.h"
+
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <optional>
+
+#include "./builtins.h"
+
+namespace {
+
+constexpr std::size_t MIN_CAPACITY{8};
+// How many pairs of a list or elements of a vector `equal?` hashing looks into,
+// so that hashing a long, deep or circular structure stops after its first
+// elements.
+constexpr int PAIR_HASH_BUDGET{16};
+constexpr std::uint64_t PAIR_HASH_SEED{0x9E37'79B9'7F4A'7C15};
+constexpr std::uint64_t VECTOR_HASH_SEED{0xC2B2'AE3D'27D4'EB4F};
+
+// The finalizer of SplitMix64, which spreads every input bit over the result
+// so that probing may use the low bits alone.
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58'476D'1CE4'E5B9;
+    x ^= x >> 27;
+    x *= 0x94D0'49BB'1331'11EB;
+    return x ^ x >> 31;
+}
+
+std::optional<std::int64_t> integralWord(double value) {
+    if (value >= -0x1p63 && value < 0x1p63 && value == std::trunc(value)) {
+        return static_cast<std::int64_t>(value);
+    }
+    return std::nullopt;
+}
+
+// `eq?` and `equal?` compare numbers by value, so a number hashes the same
+// whether it is exact or not.
+std::uint64_t hashNumber(ValuePtr number) {
+    if (auto word = number.isFlonum() ? integralWord(number.asFlonum()) : number.toInt64()) {
+        return mix(static_cast<std::uint64_t>(*word));
+    }
+    // The flonum equal to a bignum, if any, is its exact conversion.
+    return mix(std::bit_cast<std::uint64_t>(number.asNumber()));
+}
+
+std::uint64_t hashEq(ValuePtr key) {
+    if (key.isNumber()) {
+        return hashNumber(key);
+    }
+    return mix(std::bit_cast<std::uint64_t>(key));
+}
+
+std::uint64_t hashEqual(ValuePtr key, int& budget) {
+    switch (key.getType()) {
+        case ValueType::STRING: return mix(std::hash<std::string_view>{}(key.asString()));
+        case ValueType::PAIR: {
+            auto hash = PAIR_HASH_SEED;
+            for (; key.isPair() && budget > 0; key = key.asPair().getCdr()) {
+                budget--;
+                hash = mix(hash ^ hashEqual(key.asPair().getCar(), budget));
+            }
+            return key.isPair() ? hash : mix(hash ^ hashEqual(key, budget));
+        }
+        case ValueType::VECTOR: {
+            auto elements = key.asVector().getElements();
+            auto hash = mix(VECTOR_HASH_SEED ^ elements.size());
+            for (std::size_t i = 0; i < elements.size() && budget > 0; i++) {
+                budget--;
+                hash = mix(hash ^ hashEqual(elements[i], budget));
+            }
+            return hash;
+        }
+        default: return hashEq(key);
+    }
+}
+
+}  // namespace
+
+std::uint64_t HashTableValue::hashOf(ValuePtr key) const {
+    if (equivalence == Equivalence::EQ) {
+        return hashEq(key);
+    }
+    int budget = PAIR_HASH_BUDGET;
+    return hashEqual(key, budget);
+}
+
+std::size_t HashTableValue::probe(ValuePtr key, std::uint64_t hash) const {
+    auto equivalent = equivalence == Equivalence::EQ ? builtins::eqQ : builtins::equalQ;
+    auto mask = slots.size() - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+        auto&& slot = slots[i];
+        if (!slot.key || slot.key == key || (slot.hash == hash && equivalent(slot.key, key))) {
+            return i;
+        }
+    }
+}
+
+void HashTableValue::grow() {
+    std::vector<Slot> old(std::max(MIN_CAPACITY, slots.size() * 2));
+    old.swap(slots);
+    auto mask = slots.size() - 1;
+    for (auto&& slot : old) {
+        if (slot.key) {
+            auto i = slot.hash & mask;
+            while (slots[i].key) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slot;
+        }
+    }
+}
+
+const ValuePtr* HashTableValue::find(ValuePtr key) const {
+    if (count == 0) {
+        return nullptr;
+    }
+    auto&& slot = slots[probe(key, hashOf(key))];
+    return slot.key ? &slot.value : nullptr;
+}
+
+void HashTableValue::set(ValuePtr key, ValuePtr value) {
+    auto hash = hashOf(key);
+    if (!slots.empty()) {
+        if (auto&& slot = slots[probe(key, hash)]; slot.key) {
+            slot.value = value;
+            return;
+        }
+    }
+    if ((count + 1) * 4 > slots.size() * 3) {
+        grow();
+    }
+    slots[probe(key, hash)] = {key, value, hash};
+    count++;
+}
+
+bool HashTableValue::remove(ValuePtr key) {
+    if (count == 0) {
+        return false;
+    }
+    auto mask = slots.size() - 1;
+    auto gap = probe(key, hashOf(key));
+    if (!slots[gap].key) {
+        return false;
+    }
+    // Moves back each later entry of the probe sequence whose home slot is
+    // not between the gap and itself, as it would be unreachable otherwise.
+    for (auto i = (gap + 1) & mask; slots[i].key; i = (i + 1) & mask) {
+        auto home = slots[i].hash & mask;
+        if (((i - home) & mask) >= ((i - gap) & mask)) {
+            slots[gap] = slots[i];
+            gap = i;
+        }
+    }
+    slots[gap] = {};
+    count--;
+    return true;
+}
+
+void HashTableValue::trace(GcTracer& tracer) const {
+    forEach([&](ValuePtr key, ValuePtr value) {
+        tracer.mark(key.get());
+        tracer.mark(value.get());
+    });
+}
+
+std::string HashTableValue::toString() const {
+    return "#<hash-table>";
+}
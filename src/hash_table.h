@@ -0,0 +1,72 @@
+#ifndef HASH_TABLE_H
+#define HASH_TABLE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "./value.h"
+
+// A mutable hash table, keyed with the semantics of `eq?` or of `equal?`.
+// Entries are kept in one array with open addressing and linear probing;
+// removal shifts the rest of a probe sequence back rather than leaving
+// tombstones, so lookups never step over deleted entries.
+class HashTableValue final : public Value {
+public:
+    enum class Equivalence {
+        EQ,
+        EQUAL,
+    };
+
+private:
+    // Empty slots have the empty handle as their key, which no value is.
+    struct Slot {
+        ValuePtr key;
+        ValuePtr value;
+        std::uint64_t hash;
+    };
+
+    Equivalence equivalence;
+    // Empty, or a power of two slots that are at most 3/4 full.
+    std::vector<Slot> slots;
+    std::size_t count{0};
+
+    std::uint64_t hashOf(ValuePtr key) const;
+    // The slot holding `key`, or the empty slot where it would go.
+    std::size_t probe(ValuePtr key, std::uint64_t hash) const;
+    void grow();
+
+public:
+    explicit HashTableValue(Equivalence equivalence)
+        : Value(ValueType::HASH_TABLE), equivalence{equivalence} {}
+
+    Equivalence getEquivalence() const {
+        return equivalence;
+    }
+    std::size_t size() const {
+        return count;
+    }
+
+    // The value of `key`, or nullptr if it has none. Valid until the table
+    // is next modified.
+    const ValuePtr* find(ValuePtr key) const;
+    void set(ValuePtr key, ValuePtr value);
+    // Whether there was an entry to remove.
+    bool remove(ValuePtr key);
+
+    // Calls `f(key, value)` on every entry, in no particular order. `f` must
+    // not modify the table.
+    template <typename F>
+    void forEach(F f) const {
+        for (auto&& slot : slots) {
+            if (slot.key) {
+                f(slot.key, slot.value);
+            }
+        }
+    }
+
+    void trace(GcTracer& tracer) const override;
+    std::string toString() const override;
+};
+
+#endif
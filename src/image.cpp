@@ -0,0 +1,383 @@
+#include "./image.h"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "./aot.h"
+#include "./builtins.h"
+#include "./error.h"
+#include "./source_file.h"
+
+namespace {
+
+constexpr std::uint32_t IMAGE_MAGIC{0x474d494c};  // "LIMG" in little-endian order
+
+// FNV-1a, over the text and then the words of what an image depends on.
+constexpr std::uint32_t hashFormat(std::string_view text,
+                                   std::initializer_list<std::uint32_t> words) {
+    std::uint32_t hash{0x811C'9DC5};
+    auto add = [&hash](unsigned char byte) { hash = (hash ^ byte) * 0x0100'0193; };
+    for (auto c : text) {
+        add(c);
+    }
+    for (auto word : words) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            add(word >> shift);
+        }
+    }
+    return hash;
+}
+
+// Derived from the opcodes, the primitives CALL_PRIMITIVE names by index, the
+// value types the records store and the size of the records, so that an image
+// written by a build where any of them differs is refused rather than run.
+constexpr std::uint32_t IMAGE_VERSION{hashFormat(
+#define X(name, operands) #name " " #operands ";"
+    MINI_LISP_OPCODES(X)
+#undef X
+#define X(name, symbol, argc) #name " " symbol " " #argc ";"
+        MINI_LISP_PRIMITIVES(X)
+#undef X
+    ,
+    {static_cast<std::uint32_t>(ValueType::NIL), static_cast<std::uint32_t>(ValueType::BOOLEAN),
+     static_cast<std::uint32_t>(ValueType::NUMBER), static_cast<std::uint32_t>(ValueType::SYMBOL),
+     static_cast<std::uint32_t>(ValueType::STRING), static_cast<std::uint32_t>(ValueType::PAIR),
+     static_cast<std::uint32_t>(ValueType::BUILTIN_PROC),
+     static_cast<std::uint32_t>(ValueType::VECTOR), IMAGE_EXACT, sizeof(ImageHeader),
+     sizeof(ImageText), sizeof(ImageRange), sizeof(ImageValue), sizeof(ImagePrototype),
+     sizeof(ImageStep)})};
+
+static_assert(sizeof(ImageValue) == 3 * sizeof(std::uint32_t));
+static_assert(sizeof(ImagePrototype) == 13 * sizeof(std::uint32_t));
+
+template <typename T>
+void writeArray(std::ostream& os, const std::vector<T>& items) {
+    os.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+}
+
+}  // namespace
+
+ImageText ImageWriter::addText(std::string_view s) {
+    ImageText result{static_cast<std::uint32_t>(text.size()), static_cast<std::uint32_t>(s.size())};
+    text.append(s);
+    return result;
+}
+
+ImageRange ImageWriter::addWords(const std::vector<std::uint32_t>& table) {
+    ImageRange result{static_cast<std::uint32_t>(words.size()),
+                      static_cast<std::uint32_t>(table.size())};
+    words.insert(words.end(), table.begin(), table.end());
+    return result;
+}
+
+std::uint32_t ImageWriter::addValue(ValueType type, std::uint32_t first, std::uint32_t second,
+                                    std::uint32_t flags) {
+    values.push_back({static_cast<std::uint32_t>(type) | flags, first, second});
+    return values.size() - 1;
+}
+
+std::uint32_t ImageWriter::addTextValue(ValueType type, std::string_view s, std::uint32_t flags) {
+    auto [offset, length] = addText(s);
+    return addValue(type, offset, length, flags);
+}
+
+std::uint32_t ImageWriter::name(SymbolId id) {
+    auto [it, inserted] = nameIndices.try_emplace(id, names.size());
+    if (inserted) {
+        names.push_back(addText(IdentifierValue::nameOf(id)));
+    }
+    return it->second;
+}
+
+std::uint32_t ImageWriter::value(ValuePtr v) {
+    if (v.isNumber()) {
+        // Flonums by their bits, exact numbers by their digits, which the
+        // loader tells apart by the type of the record.
+        if (v.isFlonum()) {
+            auto bits = std::bit_cast<std::uint64_t>(v.asFlonum());
+            auto [it, inserted] = flonumIndices.try_emplace(bits, values.size());
+            if (inserted) {
+                addValue(ValueType::NUMBER, bits, bits >> 32);
+            }
+            return it->second;
+        }
+        auto [it, inserted] = integerIndices.try_emplace(v.toString(), values.size());
+        if (inserted) {
+            addTextValue(ValueType::NUMBER, it->first, IMAGE_EXACT);
+        }
+        return it->second;
+    }
+    auto type = v.getType();
+    auto key = std::pair{type, reinterpret_cast<std::uintptr_t>(v.get())};
+    if (type == ValueType::BOOLEAN) {
+        key.second = v.asBool();
+    }
+    if (auto it = valueIndices.find(key); it != valueIndices.end()) {
+        return it->second;
+    }
+    std::uint32_t index;
+    switch (type) {
+        case ValueType::NIL: index = addValue(type); break;
+        case ValueType::BOOLEAN: index = addValue(type, v.asBool()); break;
+        case ValueType::SYMBOL:
+            index = addTextValue(type, IdentifierValue::nameOf(*v.getSymbolId()));
+            break;
+        case ValueType::STRING: index = addTextValue(type, v.asString()); break;
+        case ValueType::PAIR: {
+            auto car = value(v.asPair().getCar());
+            auto cdr = value(v.asPair().getCdr());
+            index = addValue(type, car, cdr);
+            break;
+        }
+        case ValueType::VECTOR: {
+            // The elements go in as a list of their own, as for mini_lisp_aot.
+            auto elements = value(Value::nil());
+            auto vector = v.asVector().getElements();
+            for (auto it = vector.rbegin(); it != vector.rend(); ++it) {
+                auto car = value(*it);
+                elements = addValue(ValueType::PAIR, car, elements);
+            }
+            index = addValue(type, elements);
+            break;
+        }
+        case ValueType::BUILTIN_PROC: {
+            auto func = static_cast<const BuiltinProcValue*>(v.get())->getFunc();
+            std::string_view builtin;
+            for (auto&& [name, f] : BUILTINS) {
+                if (f == func) {
+                    builtin = name;
+                    break;
+                }
+            }
+            index = addTextValue(type, builtin);
+            break;
+        }
+        default: throw LispError("Cannot compile constant " + v.toString());
+    }
+    return valueIndices[key] = index;
+}
+
+std::uint32_t ImageWriter::prototype(const Prototype* proto) {
+    auto index = prototypes.size();
+    prototypes.emplace_back();
+    auto code = proto->getCode();
+    std::vector<std::uint32_t> codeWords(code, code + proto->getCodeSize());
+    std::vector<std::uint32_t> fixups;
+    for (auto offset : nameOperands(proto)) {
+        fixups.push_back(offset);
+        fixups.push_back(name(codeWords[offset]));
+        codeWords[offset] = 0;
+    }
+    std::vector<std::uint32_t> constants;
+    for (std::size_t k = 0; k < proto->getConstantCount(); k++) {
+        constants.push_back(value(proto->getConstants()[k]));
+    }
+    std::vector<std::uint32_t> nested;
+    for (std::size_t i = 0; i < proto->getProtoCount(); i++) {
+        nested.push_back(prototype(proto->getProtos()[i]));
+    }
+    prototypes[index] = {addWords(codeWords),
+                         addWords(fixups),
+                         addWords(constants),
+                         addWords(nested),
+                         static_cast<std::uint32_t>(proto->getCacheCount()),
+                         static_cast<std::uint32_t>(proto->getParamCount()),
+                         static_cast<std::uint32_t>(proto->getFrameSize()),
+                         static_cast<std::uint32_t>(proto->getMaxStack()),
+                         proto->needsHeapFrame()};
+    // The name offsets count pairs of words.
+    prototypes[index].names.count /= 2;
+    return index;
+}
+
+void ImageWriter::addForm(const Prototype* proto) {
+    steps.push_back({prototype(proto), false, {}});
+}
+
+void ImageWriter::addError(const std::string& message) {
+    steps.push_back({0, true, addText(message)});
+    text.push_back('\0');
+}
+
+bool ImageWriter::write(const char* filename) const {
+    ImageHeader header{IMAGE_MAGIC,
+                       IMAGE_VERSION,
+                       static_cast<std::uint32_t>(names.size()),
+                       static_cast<std::uint32_t>(values.size()),
+                       static_cast<std::uint32_t>(prototypes.size()),
+                       static_cast<std::uint32_t>(steps.size()),
+                       static_cast<std::uint32_t>(words.size()),
+                       static_cast<std::uint32_t>(text.size())};
+    std::ofstream output(filename, std::ios::binary);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeArray(output, names);
+    writeArray(output, values);
+    writeArray(output, prototypes);
+    writeArray(output, steps);
+    writeArray(output, words);
+    output.write(text.data(), text.size());
+    return static_cast<bool>(output);
+}
+
+namespace {
+
+// The tables of runProgram over a mapped image. Code, constants and nested
+// prototypes are used where they lie in the image; only the records holding
+// text are converted.
+class ImageProgram {
+private:
+    std::string_view data;
+    std::size_t position{0};
+    std::vector<std::string_view> names;
+    std::vector<AotValue> values;
+    std::vector<AotName> operands;
+    std::vector<AotPrototype> prototypes;
+    std::vector<AotStep> steps;
+
+    [[noreturn]] static void malformed() {
+        throw LispError("Malformed image");
+    }
+
+    static void check(bool condition) {
+        if (!condition) {
+            malformed();
+        }
+    }
+
+    // The next `count` records of the image.
+    template <typename T>
+    std::span<const T> take(std::size_t count) {
+        check(count <= (data.size() - position) / sizeof(T));
+        auto records = reinterpret_cast<const T*>(data.data() + position);
+        position += count * sizeof(T);
+        return {records, count};
+    }
+
+public:
+    explicit ImageProgram(std::string_view image) : data{image} {
+        check(reinterpret_cast<std::uintptr_t>(image.data()) % alignof(ImageHeader) == 0);
+        auto&& header = take<ImageHeader>(1)[0];
+        if (header.magic != IMAGE_MAGIC || header.version != IMAGE_VERSION) {
+            throw LispError("Not an image of this version of mini_lisp");
+        }
+        auto nameTexts = take<ImageText>(header.nameCount);
+        auto valueRecords = take<ImageValue>(header.valueCount);
+        auto protoRecords = take<ImagePrototype>(header.prototypeCount);
+        auto stepRecords = take<ImageStep>(header.stepCount);
+        auto words = take<std::uint32_t>(header.wordCount);
+        auto text = take<char>(header.textSize);
+        check(position == data.size());
+        auto textOf = [&](ImageText t) {
+            check(t.offset <= text.size() && t.length <= text.size() - t.offset);
+            return std::string_view(text.data() + t.offset, t.length);
+        };
+        auto wordsOf = [&](ImageRange range, std::size_t width = 1) {
+            check(range.offset <= words.size() &&
+                  range.count <= (words.size() - range.offset) / width);
+            return words.subspan(range.offset, range.count * width);
+        };
+
+        for (auto name : nameTexts) {
+            names.push_back(textOf(name));
+        }
+        for (std::uint32_t i = 0; i < valueRecords.size(); i++) {
+            auto [code, first, second] = valueRecords[i];
+            auto type = static_cast<ValueType>(code & ~IMAGE_EXACT);
+            AotValue value{};
+            value.type = type;
+            auto exact = code & IMAGE_EXACT;
+            check(!exact || type == ValueType::NUMBER);
+            switch (type) {
+                case ValueType::NIL: break;
+                case ValueType::BOOLEAN: value.bits = first; break;
+                case ValueType::NUMBER:
+                    if (exact) {
+                        value.text = textOf({first, second});
+                        check(!value.text.empty());
+                    } else {
+                        value.bits = first | std::uint64_t{second} << 32;
+                    }
+                    break;
+                case ValueType::SYMBOL:
+                case ValueType::STRING: value.text = textOf({first, second}); break;
+                case ValueType::BUILTIN_PROC:
+                    value.text = textOf({first, second});
+                    check(BUILTINS.contains(std::string(value.text)));
+                    break;
+                // Pairs and vectors refer to values before them.
+                case ValueType::PAIR: check(second < i); value.cdr = second; [[fallthrough]];
+                case ValueType::VECTOR: check(first < i); value.car = first; break;
+                default: malformed();
+            }
+            values.push_back(value);
+        }
+        // The names of all prototypes go in one vector, which the spans of the
+        // prototypes refer into once it is complete.
+        std::vector<ImageRange> nameRanges;
+        for (auto&& record : protoRecords) {
+            auto fixups = wordsOf(record.names, 2);
+            auto code = wordsOf(record.code);
+            nameRanges.push_back({static_cast<std::uint32_t>(operands.size()), record.names.count});
+            for (std::size_t i = 0; i < fixups.size(); i += 2) {
+                check(fixups[i] < code.size() && fixups[i + 1] < names.size());
+                operands.push_back({fixups[i], fixups[i + 1]});
+            }
+        }
+        for (std::size_t i = 0; i < protoRecords.size(); i++) {
+            auto&& record = protoRecords[i];
+            auto constants = wordsOf(record.constants);
+            auto protos = wordsOf(record.protos);
+            for (auto constant : constants) {
+                check(constant < values.size());
+            }
+            // Nested prototypes come after the one they are in, so none is its
+            // own ancestor.
+            for (auto nested : protos) {
+                check(nested > i && nested < protoRecords.size());
+            }
+            auto nameSpan = std::span<const AotName>(operands).subspan(nameRanges[i].offset,
+                                                                       nameRanges[i].count);
+            prototypes.push_back({wordsOf(record.code), nameSpan, constants, protos,
+                                  record.cacheCount, record.paramCount, record.frameSize,
+                                  record.maxStack, record.heapFrame != 0, nullptr});
+        }
+        for (auto&& record : stepRecords) {
+            if (record.failed) {
+                auto message = textOf(record.error);
+                auto end = message.data() + message.size();
+                check(end < text.data() + text.size() && *end == '\0');
+                steps.push_back({0, message.data()});
+            } else {
+                check(record.proto < prototypes.size());
+                steps.push_back({record.proto, nullptr});
+            }
+        }
+    }
+
+    AotProgram get() const {
+        return {names, values, prototypes, steps};
+    }
+};
+
+}  // namespace
+
+void runImage(const char* filename) {
+    std::optional<SourceFile> file;
+    std::optional<ImageProgram> program;
+    try {
+        file.emplace(filename);
+        program.emplace(file->getText());
+    } catch (std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::exit(1);
+    }
+    runProgram(program->get());
+}
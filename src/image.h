@@ -0,0 +1,117 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./bytecode.h"
+#include "./value.h"
+
+// A program image: the tables mini_lisp_aot writes for a program, without the
+// C++ translation, in a binary file. `mini_lisp --image` maps the file and runs
+// its forms on the VM without reading or compiling anything. Words are stored
+// in the byte order of the machine, and the bytecode is that of the build that
+// wrote the image; the version in the header is derived from both. The tables
+// are checked as they are loaded, but the code is trusted as the VM trusts the
+// compiler.
+
+// The file is an ImageHeader, then the names, values, prototypes and steps,
+// then the words that ImageRanges refer to, and last the text that ImageTexts
+// refer to. Each part is an array of the records below, which are made of
+// 32-bit words only.
+
+struct ImageHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t nameCount;
+    std::uint32_t valueCount;
+    std::uint32_t prototypeCount;
+    std::uint32_t stepCount;
+    std::uint32_t wordCount;
+    std::uint32_t textSize;
+};
+
+struct ImageText {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+struct ImageRange {
+    std::uint32_t offset;
+    std::uint32_t count;
+};
+
+// An AotValue, in as many words as its type needs: the bits of a flonum, low
+// word first, or the ImageText of its text, or its car and cdr. The type of an
+// exact number, which is stored as text, has IMAGE_EXACT added.
+constexpr std::uint32_t IMAGE_EXACT{0x100};
+
+struct ImageValue {
+    std::uint32_t type;
+    std::uint32_t first;
+    std::uint32_t second;
+};
+
+// An AotPrototype; each name takes two words, an offset and a name index.
+struct ImagePrototype {
+    ImageRange code;
+    ImageRange names;
+    ImageRange constants;
+    ImageRange protos;
+    std::uint32_t cacheCount;
+    std::uint32_t paramCount;
+    std::uint32_t frameSize;
+    std::uint32_t maxStack;
+    std::uint32_t heapFrame;
+};
+
+// An AotStep. The text of an error is followed by a NUL.
+struct ImageStep {
+    std::uint32_t proto;
+    std::uint32_t failed;
+    ImageText error;
+};
+
+// Collects the compiled top-level forms of a program and writes them as an
+// image. The constants of a form are found by address, so the forms must stay
+// alive until the image is written.
+class ImageWriter {
+private:
+    std::vector<ImageText> names;
+    std::unordered_map<SymbolId, std::uint32_t> nameIndices;
+    std::vector<ImageValue> values;
+    std::map<std::pair<ValueType, std::uintptr_t>, std::uint32_t> valueIndices;
+    std::unordered_map<std::uint64_t, std::uint32_t> flonumIndices;
+    std::unordered_map<std::string, std::uint32_t> integerIndices;
+    std::vector<ImagePrototype> prototypes;
+    std::vector<ImageStep> steps;
+    std::vector<std::uint32_t> words;
+    std::string text;
+
+    ImageText addText(std::string_view s);
+    ImageRange addWords(const std::vector<std::uint32_t>& table);
+    std::uint32_t addValue(ValueType type, std::uint32_t first = 0, std::uint32_t second = 0,
+                           std::uint32_t flags = 0);
+    std::uint32_t addTextValue(ValueType type, std::string_view s, std::uint32_t flags = 0);
+    std::uint32_t name(SymbolId id);
+    std::uint32_t value(ValuePtr v);
+    std::uint32_t prototype(const Prototype* proto);
+
+public:
+    void addForm(const Prototype* proto);
+    // The form could not be read or compiled; the program stops there.
+    void addError(const std::string& message);
+    // Returns false if the file cannot be written.
+    bool write(const char* filename) const;
+};
+
+// Runs the forms of an image in a fresh global environment, as runProgram
+// does. Exits if the file is not an image this build can run.
+void runImage(const char* filename);
+
+#endif
@@ -0,0 +1,805 @@
+#include "./jit.h"
+
+#include <cstring>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#include "./bytecode.h"
+#include "./eval_env.h"
+#include "./vm.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define MINI_LISP_JIT
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+bool jitEnabled = true;
+
+}  // namespace
+
+#ifdef MINI_LISP_JIT
+
+namespace {
+
+// Exit codes of compiled code, after those of JitExit.
+constexpr std::uint32_t EXIT_THROW{2};
+
+// An error raised by a call out of compiled code, which may not unwind through
+// it; NativeCode::run throws it again.
+thread_local std::exception_ptr pendingError;
+
+enum Reg : std::uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+};
+
+enum Cond : std::uint8_t {
+    CC_O = 0x0, CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7, CC_NP = 0xB,
+    CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF,
+};
+
+// Encodes the few x86-64 instructions the compiler needs. Memory operands are
+// always [base + disp32].
+class Assembler {
+private:
+    std::vector<std::uint8_t> code;
+    std::vector<std::size_t> labels;
+    // Offsets of rel32 fields, and the labels they refer to.
+    std::vector<std::pair<std::size_t, std::size_t>> fixups;
+
+    void byte(std::uint8_t value) {
+        code.push_back(value);
+    }
+    void dword(std::uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            byte(value >> (8 * i));
+        }
+    }
+    void rex(bool wide, std::uint8_t reg, std::uint8_t rm) {
+        std::uint8_t prefix = 0x40 | wide << 3 | (reg >> 3) << 2 | (rm >> 3);
+        if (prefix != 0x40) {
+            byte(prefix);
+        }
+    }
+    void direct(std::uint8_t reg, std::uint8_t rm) {
+        byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+    }
+    void memory(std::uint8_t reg, Reg base, std::int32_t disp) {
+        byte(0x80 | (reg & 7) << 3 | (base & 7));
+        if ((base & 7) == RSP) {
+            byte(0x24);
+        }
+        dword(disp);
+    }
+    void rel32(std::size_t label) {
+        fixups.emplace_back(code.size(), label);
+        dword(0);
+    }
+
+public:
+    std::size_t newLabel() {
+        labels.push_back(SIZE_MAX);
+        return labels.size() - 1;
+    }
+    void bind(std::size_t label) {
+        labels[label] = code.size();
+    }
+
+    void push(Reg reg) {
+        rex(false, 0, reg);
+        byte(0x50 + (reg & 7));
+    }
+    void pop(Reg reg) {
+        rex(false, 0, reg);
+        byte(0x58 + (reg & 7));
+    }
+    void ret() {
+        byte(0xC3);
+    }
+    void mov(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(0x89);
+        direct(src, dst);
+    }
+    void mov(Reg dst, std::uint64_t imm) {
+        rex(true, 0, dst);
+        byte(0xB8 + (dst & 7));
+        for (int i = 0; i < 8; i++) {
+            byte(imm >> (8 * i));
+        }
+    }
+    void load(Reg dst, Reg base, std::int32_t disp) {
+        rex(true, dst, base);
+        byte(0x8B);
+        memory(dst, base, disp);
+    }
+    void store(Reg base, std::int32_t disp, Reg src) {
+        rex(true, src, base);
+        byte(0x89);
+        memory(src, base, disp);
+    }
+    void store32(Reg base, std::int32_t disp, std::uint32_t imm) {
+        rex(false, 0, base);
+        byte(0xC7);
+        memory(0, base, disp);
+        dword(imm);
+    }
+    void load32(Reg dst, Reg base, std::int32_t disp) {
+        rex(false, dst, base);
+        byte(0x8B);
+        memory(dst, base, disp);
+    }
+    // cmp dword [base + disp], src
+    void cmp32(Reg base, std::int32_t disp, Reg src) {
+        rex(false, src, base);
+        byte(0x39);
+        memory(src, base, disp);
+    }
+    // cmp byte [base + disp], imm
+    void cmp8(Reg base, std::int32_t disp, std::uint8_t imm) {
+        rex(false, 0, base);
+        byte(0x80);
+        memory(7, base, disp);
+        byte(imm);
+    }
+    void lea(Reg dst, Reg base, std::int32_t disp) {
+        rex(true, dst, base);
+        byte(0x8D);
+        memory(dst, base, disp);
+    }
+    void add(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(0x01);
+        direct(src, dst);
+    }
+    void add(Reg dst, std::int32_t imm) {
+        rex(true, 0, dst);
+        byte(0x81);
+        direct(0, dst);
+        dword(imm);
+    }
+    void sub(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(0x29);
+        direct(src, dst);
+    }
+    void imul(Reg dst, Reg src) {
+        rex(true, dst, src);
+        byte(0x0F);
+        byte(0xAF);
+        direct(dst, src);
+    }
+    void or_(Reg dst, Reg src) {
+        rex(true, src, dst);
+        byte(0x09);
+        direct(src, dst);
+    }
+    // shl (4), shr (5) or sar (7) by an immediate count.
+    void shift(int kind, Reg reg, std::uint8_t count) {
+        rex(true, 0, reg);
+        byte(0xC1);
+        direct(kind, reg);
+        byte(count);
+    }
+    void shl(Reg reg, std::uint8_t count) {
+        shift(4, reg, count);
+    }
+    void shr(Reg reg, std::uint8_t count) {
+        shift(5, reg, count);
+    }
+    void sar(Reg reg, std::uint8_t count) {
+        shift(7, reg, count);
+    }
+    // cmp r32, imm
+    void cmp32(Reg reg, std::uint32_t imm) {
+        rex(false, 0, reg);
+        byte(0x81);
+        direct(7, reg);
+        dword(imm);
+    }
+    void cmp(Reg a, Reg b) {
+        rex(true, b, a);
+        byte(0x39);
+        direct(b, a);
+    }
+    void test32(Reg a, Reg b) {
+        rex(false, b, a);
+        byte(0x85);
+        direct(b, a);
+    }
+    void test(Reg a, Reg b) {
+        rex(true, b, a);
+        byte(0x85);
+        direct(b, a);
+    }
+    void call(const void* function) {
+        mov(RAX, reinterpret_cast<std::uint64_t>(function));
+        byte(0xFF);
+        direct(2, RAX);
+    }
+    void jump(std::size_t label) {
+        byte(0xE9);
+        rel32(label);
+    }
+    void jump(Cond cond, std::size_t label) {
+        byte(0x0F);
+        byte(0x80 + cond);
+        rel32(label);
+    }
+    // setcc on the low byte of rax, rcx, rdx or rbx.
+    void set(Cond cond, Reg reg) {
+        byte(0x0F);
+        byte(0x90 + cond);
+        direct(0, reg);
+    }
+    // al &= cl
+    void andLowBytes() {
+        byte(0x20);
+        direct(RCX, RAX);
+    }
+    // eax = al
+    void zeroExtend() {
+        byte(0x0F);
+        byte(0xB6);
+        direct(RAX, RAX);
+    }
+    void movq(int xmm, Reg src) {
+        byte(0x66);
+        rex(true, xmm, src);
+        byte(0x0F);
+        byte(0x6E);
+        direct(xmm, src);
+    }
+    void movq(Reg dst, int xmm) {
+        byte(0x66);
+        rex(true, xmm, dst);
+        byte(0x0F);
+        byte(0x7E);
+        direct(xmm, dst);
+    }
+    // cvtsi2sd xmm, r64, after clearing xmm: the conversion keeps its upper
+    // half, and would otherwise wait for whatever last wrote it.
+    void convert(int xmm, Reg src) {
+        rex(false, xmm, xmm);
+        byte(0x0F);
+        byte(0x57);
+        direct(xmm, xmm);
+        byte(0xF2);
+        rex(true, xmm, src);
+        byte(0x0F);
+        byte(0x2A);
+        direct(xmm, src);
+    }
+    // addsd, subsd, mulsd (prefix F2) and ucomisd (prefix 66) on xmm registers.
+    void sse(std::uint8_t prefix, std::uint8_t op, int dst, int src) {
+        byte(prefix);
+        byte(0x0F);
+        byte(op);
+        direct(dst, src);
+    }
+
+    // The code with jumps resolved.
+    std::vector<std::uint8_t> finish() {
+        for (auto [offset, label] : fixups) {
+            auto target = static_cast<std::int32_t>(labels[label] - (offset + 4));
+            std::memcpy(&code[offset], &target, 4);
+        }
+        return std::move(code);
+    }
+};
+
+std::uint32_t callFromNative(JitFrame* frame, ValuePtr* args, std::uint32_t argc) {
+    try {
+        args[-1] = callProcedure(args[-1], {args, argc}, *frame->env);
+        return 0;
+    } catch (...) {
+        pendingError = std::current_exception();
+        return EXIT_THROW;
+    }
+}
+
+// A slot of a frame around the closure, as LOCAL_UP reads it.
+const ValuePtr* outerSlot(JitFrame* frame, std::uint32_t depth, std::uint32_t slot) {
+    return &frame->env->lookupLocal(depth - 1, slot);
+}
+
+// Whether a tail call of `callee` with `argc` arguments starts the running
+// code over in the same environment, so that it can be a jump.
+std::uint32_t isSelfCall(JitFrame* frame, const ValuePtr* callee, const Prototype* proto,
+                         std::uint32_t argc) {
+    if (callee->getType() != ValueType::LAMBDA) {
+        return 0;
+    }
+    auto lambda = static_cast<const LambdaValue*>(callee->get());
+    return lambda->getProto() == proto && lambda->getEnv() == frame->env &&
+           argc == proto->getParamCount();
+}
+
+// Failures, allocation ones included, are left for the VM to run into again.
+ValuePtr* primitiveFromNative(Primitive primitive, ValuePtr* sp) {
+    try {
+        return runPrimitive(primitive, sp);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+}  // namespace
+
+// Translates bytecode one instruction at a time, keeping the VM's registers
+// in callee-saved ones: r12 the stack pointer, r13 the frame, rbx the global
+// caches and r15 the JitFrame. Arithmetic and comparisons of fixnums and
+// flonums run inline, and of bignums through runPrimitive; anything
+// they are not ready for, such as a non-number, an unbound variable or a
+// redefined builtin, exits to the VM at the start of the instruction, with
+// the stack as the VM expects it there.
+class JitCompiler {
+private:
+    const Prototype& proto;
+    const std::uint32_t* code;
+    Assembler as;
+    std::vector<std::size_t> targets;  // label of every code offset
+    std::vector<std::pair<std::size_t, std::uint32_t>> resumes;
+    std::size_t epilogue;
+
+    static constexpr std::int32_t WORD{sizeof(ValuePtr)};
+
+    static std::uint64_t bits(ValuePtr value) {
+        return value.bits;
+    }
+
+    // A label exiting to the VM at `pc`.
+    std::size_t resume(std::uint32_t pc) {
+        auto label = as.newLabel();
+        resumes.emplace_back(label, pc);
+        return label;
+    }
+
+    void pushRax() {
+        as.store(R12, 0, RAX);
+        as.add(R12, WORD);
+    }
+    // rax = locals[slot], leaving for `exit` if it is unbound.
+    void loadLocal(Reg dst, std::uint32_t slot, std::size_t exit) {
+        as.load(dst, R13, slot * WORD);
+        as.mov(RCX, ValuePtr::EMPTY_BITS);
+        as.cmp(dst, RCX);
+        as.jump(CC_E, exit);
+    }
+    // Leaves for `exit` unless the cache holds the stock primitive.
+    void guardStock(std::uint32_t cache, std::size_t exit) {
+        auto base = static_cast<std::int32_t>(cache * sizeof(GlobalCache));
+        as.load(RAX, RBX, base + offsetof(GlobalCache, binding));
+        as.test(RAX, RAX);
+        as.jump(CC_E, exit);
+        as.load32(RCX, RAX, offsetof(GlobalBinding, version));
+        as.cmp32(RBX, base + offsetof(GlobalCache, version), RCX);
+        as.jump(CC_NE, exit);
+        as.cmp8(RBX, base + offsetof(GlobalCache, stock), 0);
+        as.jump(CC_E, exit);
+    }
+    // Leaves for `other` unless `reg` holds a fixnum; clobbers rcx.
+    void checkFixnum(Reg reg, std::size_t other) {
+        as.mov(RCX, reg);
+        as.shr(RCX, ValuePtr::TAG_SHIFT);
+        as.cmp32(RCX, static_cast<std::uint32_t>(ValuePtr::TAG_FIXNUM >> ValuePtr::TAG_SHIFT));
+        as.jump(CC_NE, other);
+    }
+    // The fixnum payload of `reg`, sign-extended in place.
+    void unboxFixnum(Reg reg) {
+        as.shl(reg, 64 - ValuePtr::TAG_SHIFT);
+        as.sar(reg, 64 - ValuePtr::TAG_SHIFT);
+    }
+    // xmm = the flonum or fixnum in `reg`, leaving for `other` if it is
+    // neither; clobbers rcx.
+    void loadDouble(int xmm, Reg reg, std::size_t other) {
+        auto flonum = as.newLabel();
+        auto done = as.newLabel();
+        checkFixnum(reg, flonum);
+        unboxFixnum(reg);
+        as.convert(xmm, reg);
+        as.jump(done);
+        as.bind(flonum);
+        as.mov(RCX, ValuePtr::TAG_MIN);
+        as.cmp(reg, RCX);
+        as.jump(CC_AE, other);
+        as.movq(xmm, reg);
+        as.bind(done);
+    }
+    // Replaces the two numbers on top of the stack with the result of the
+    // primitive.
+    void numeric(Primitive primitive, std::size_t exit) {
+        auto arithmetic = primitive == Primitive::ADD || primitive == Primitive::SUB ||
+                          primitive == Primitive::MUL;
+        auto fixnums = as.newLabel();
+        auto mixed = as.newLabel();
+        auto flonums = as.newLabel();
+        auto slow = as.newLabel();
+        auto done = as.newLabel();
+        auto end = as.newLabel();
+        as.load(RAX, R12, -2 * WORD);
+        as.load(RDX, R12, -1 * WORD);
+        as.mov(RCX, ValuePtr::TAG_MIN);
+        as.cmp(RAX, RCX);
+        as.jump(CC_AE, fixnums);
+        as.cmp(RDX, RCX);
+        as.jump(CC_AE, mixed);
+        as.movq(0, RAX);
+        as.movq(1, RDX);
+        as.jump(flonums);
+
+        as.bind(fixnums);
+        checkFixnum(RAX, slow);
+        checkFixnum(RDX, mixed);
+        unboxFixnum(RAX);
+        unboxFixnum(RDX);
+        auto compare = [&](Cond cond) {
+            as.cmp(RAX, RDX);
+            as.set(cond, RAX);
+        };
+        switch (primitive) {
+            // Sums and differences of 48-bit values cannot overflow 64 bits.
+            case Primitive::ADD: as.add(RAX, RDX); break;
+            case Primitive::SUB: as.sub(RAX, RDX); break;
+            case Primitive::MUL:
+                as.imul(RAX, RDX);
+                as.jump(CC_O, slow);
+                break;
+            case Primitive::NUM_EQ: compare(CC_E); break;
+            case Primitive::LT: compare(CC_L); break;
+            case Primitive::GT: compare(CC_G); break;
+            case Primitive::LE: compare(CC_LE); break;
+            case Primitive::GE: compare(CC_GE); break;
+            default: break;
+        }
+        if (arithmetic) {
+            // Results outside the fixnum range become bignums out of line.
+            as.mov(RCX, RAX);
+            unboxFixnum(RCX);
+            as.cmp(RCX, RAX);
+            as.jump(CC_NE, slow);
+            as.shl(RAX, 64 - ValuePtr::TAG_SHIFT);
+            as.shr(RAX, 64 - ValuePtr::TAG_SHIFT);
+            as.mov(RCX, ValuePtr::TAG_FIXNUM);
+            as.or_(RAX, RCX);
+        } else {
+            booleanFromAl();
+        }
+        as.jump(done);
+
+        // A fixnum and a flonum; fixnums are exact as doubles.
+        as.bind(mixed);
+        loadDouble(0, RAX, slow);
+        loadDouble(1, RDX, slow);
+        as.bind(flonums);
+        auto flonumArithmetic = [&](std::uint8_t op) {
+            as.sse(0xF2, op, 0, 1);
+            as.movq(RAX, 0);
+        };
+        auto flonumCompare = [&](int a, int b, Cond cond) {
+            as.sse(0x66, 0x2E, a, b);
+            as.set(cond, RAX);
+        };
+        switch (primitive) {
+            case Primitive::ADD: flonumArithmetic(0x58); break;
+            case Primitive::SUB: flonumArithmetic(0x5C); break;
+            case Primitive::MUL: flonumArithmetic(0x59); break;
+            case Primitive::NUM_EQ:
+                // Unordered compares set ZF too; NaNs are equal to nothing.
+                flonumCompare(0, 1, CC_E);
+                as.set(CC_NP, RCX);
+                as.andLowBytes();
+                break;
+            case Primitive::LT: flonumCompare(1, 0, CC_A); break;
+            case Primitive::GT: flonumCompare(0, 1, CC_A); break;
+            case Primitive::LE: flonumCompare(1, 0, CC_AE); break;
+            case Primitive::GE: flonumCompare(0, 1, CC_AE); break;
+            default: break;
+        }
+        if (!arithmetic) {
+            booleanFromAl();
+        }
+        // Results need no canonicalizing: NaNs made by the hardware, or
+        // passed on from the canonical operands, are canonical too.
+        as.jump(done);
+
+        // Bignums and overflows.
+        as.bind(slow);
+        as.mov(RDI, static_cast<std::uint64_t>(primitive));
+        as.mov(RSI, R12);
+        as.call(reinterpret_cast<const void*>(primitiveFromNative));
+        as.test(RAX, RAX);
+        as.jump(CC_E, exit);
+        as.mov(R12, RAX);
+        as.jump(end);
+
+        as.bind(done);
+        as.store(R12, -2 * WORD, RAX);
+        as.add(R12, -WORD);
+        as.bind(end);
+    }
+    // rax = #t if al is 1, #f if 0.
+    void booleanFromAl() {
+        static_assert(ValuePtr::TRUE_BITS == ValuePtr::FALSE_BITS + 1);
+        as.zeroExtend();
+        as.mov(RCX, ValuePtr::FALSE_BITS);
+        as.add(RAX, RCX);
+    }
+
+    // Translates the instruction at `pc`; false if it has no translation, in
+    // which case the VM runs it.
+    bool translate(std::uint32_t pc) {
+        auto op = static_cast<OpCode>(code[pc]);
+        auto operand = [&](std::size_t i) { return code[pc + 1 + i]; };
+        auto slot = [&](std::size_t i) { return static_cast<std::int32_t>(operand(i) * WORD); };
+        switch (op) {
+            case OpCode::CONST:
+                as.mov(RAX, bits(proto.getConstants()[operand(0)]));
+                pushRax();
+                return true;
+            case OpCode::NIL:
+                as.mov(RAX, ValuePtr::NIL_BITS);
+                pushRax();
+                return true;
+            case OpCode::LOCAL:
+                loadLocal(RAX, operand(0), resume(pc));
+                pushRax();
+                return true;
+            case OpCode::LOCAL_CONST:
+                loadLocal(RAX, operand(0), resume(pc));
+                pushRax();
+                as.mov(RAX, bits(proto.getConstants()[operand(2)]));
+                pushRax();
+                return true;
+            case OpCode::LOCAL_LOCAL: {
+                // Both are checked before either is pushed, so that the VM
+                // can redo the instruction.
+                auto exit = resume(pc);
+                loadLocal(RDX, operand(0), exit);
+                loadLocal(RAX, operand(2), exit);
+                as.store(R12, 0, RDX);
+                as.store(R12, WORD, RAX);
+                as.add(R12, 2 * WORD);
+                return true;
+            }
+            case OpCode::LOCAL_UP:
+                as.mov(RDI, R15);
+                as.mov(RSI, operand(0));
+                as.mov(RDX, operand(1));
+                as.call(reinterpret_cast<const void*>(outerSlot));
+                as.load(RAX, RAX, 0);
+                as.mov(RCX, ValuePtr::EMPTY_BITS);
+                as.cmp(RAX, RCX);
+                as.jump(CC_E, resume(pc));
+                pushRax();
+                return true;
+            case OpCode::GLOBAL: {
+                auto base = static_cast<std::int32_t>(operand(1) * sizeof(GlobalCache));
+                as.load(RAX, RBX, base + offsetof(GlobalCache, binding));
+                as.test(RAX, RAX);
+                as.jump(CC_E, resume(pc));
+                as.load(RAX, RAX, offsetof(GlobalBinding, value));
+                pushRax();
+                return true;
+            }
+            case OpCode::DEFINE_LOCAL:
+                as.load(RAX, R12, -WORD);
+                as.store(R13, slot(0), RAX);
+                as.mov(RAX, bits(proto.getConstants()[operand(1)]));
+                as.store(R12, -WORD, RAX);
+                return true;
+            case OpCode::POP: as.add(R12, -WORD); return true;
+            case OpCode::JUMP: as.jump(targets[operand(0)]); return true;
+            case OpCode::JUMP_IF_FALSE:
+                as.add(R12, -WORD);
+                as.load(RAX, R12, 0);
+                as.mov(RCX, ValuePtr::FALSE_BITS);
+                as.cmp(RAX, RCX);
+                as.jump(CC_E, targets[operand(0)]);
+                return true;
+            case OpCode::JUMP_IF_FALSE_OR_POP:
+            case OpCode::JUMP_IF_TRUE_OR_POP:
+                as.load(RAX, R12, -WORD);
+                as.mov(RCX, ValuePtr::FALSE_BITS);
+                as.cmp(RAX, RCX);
+                as.jump(op == OpCode::JUMP_IF_FALSE_OR_POP ? CC_E : CC_NE, targets[operand(0)]);
+                as.add(R12, -WORD);
+                return true;
+            case OpCode::GUARD: {
+                auto base = static_cast<std::int32_t>(operand(1) * sizeof(GlobalCache));
+                as.load(RAX, RBX, base + offsetof(GlobalCache, binding));
+                as.load32(RCX, RAX, offsetof(GlobalBinding, version));
+                as.cmp32(RBX, base + offsetof(GlobalCache, version), RCX);
+                as.jump(CC_NE, targets[operand(2)]);
+                return true;
+            }
+            case OpCode::BIND: {
+                auto count = static_cast<std::int32_t>(operand(1));
+                as.add(R12, -count * WORD);
+                for (std::int32_t i = 0; i < count; i++) {
+                    as.load(RAX, R12, i * WORD);
+                    as.store(R13, slot(0) + i * WORD, RAX);
+                }
+                return true;
+            }
+            case OpCode::CALL: {
+                auto argc = static_cast<std::int32_t>(operand(0));
+                as.mov(RDI, R15);
+                as.lea(RSI, R12, -argc * WORD);
+                as.mov(RDX, operand(0));
+                as.call(reinterpret_cast<const void*>(callFromNative));
+                // The exit code is already in eax.
+                as.test32(RAX, RAX);
+                as.jump(CC_NE, epilogue);
+                as.add(R12, -argc * WORD);
+                return true;
+            }
+            case OpCode::TAIL_CALL: {
+                if (proto.needsHeapFrame()) {
+                    return false;
+                }
+                // Self calls reuse the frame; the VM sees to the others.
+                auto argc = static_cast<std::int32_t>(operand(0));
+                as.mov(RDI, R15);
+                as.lea(RSI, R12, -(argc + 1) * WORD);
+                as.mov(RDX, reinterpret_cast<std::uint64_t>(&proto));
+                as.mov(RCX, operand(0));
+                as.call(reinterpret_cast<const void*>(isSelfCall));
+                as.test32(RAX, RAX);
+                as.jump(CC_E, resume(pc));
+                for (std::int32_t i = 0; i < argc; i++) {
+                    as.load(RAX, R12, (i - argc) * WORD);
+                    as.store(R13, i * WORD, RAX);
+                }
+                auto frameSize = static_cast<std::int32_t>(proto.getFrameSize());
+                as.mov(RAX, ValuePtr::EMPTY_BITS);
+                for (auto i = argc; i < frameSize; i++) {
+                    as.store(R13, i * WORD, RAX);
+                }
+                as.lea(R12, R13, frameSize * WORD);
+                as.jump(targets[0]);
+                return true;
+            }
+            case OpCode::CALL_PRIMITIVE: {
+                auto primitive = static_cast<Primitive>(operand(0));
+                auto exit = resume(pc);
+                guardStock(operand(3), exit);
+                switch (primitive) {
+                    case Primitive::NULL_Q:
+                        as.load(RDX, R12, -WORD);
+                        as.mov(RCX, ValuePtr::NIL_BITS);
+                        as.cmp(RDX, RCX);
+                        as.set(CC_E, RAX);
+                        booleanFromAl();
+                        as.store(R12, -WORD, RAX);
+                        break;
+                    case Primitive::CAR:
+                    case Primitive::CDR:
+                    case Primitive::CONS:
+                        as.mov(RDI, operand(0));
+                        as.mov(RSI, R12);
+                        as.call(reinterpret_cast<const void*>(primitiveFromNative));
+                        as.test(RAX, RAX);
+                        as.jump(CC_E, exit);
+                        as.mov(R12, RAX);
+                        break;
+                    default: numeric(primitive, exit); break;
+                }
+                return true;
+            }
+            case OpCode::RETURN:
+                as.load(RAX, R12, -WORD);
+                as.store(R15, offsetof(JitFrame, result), RAX);
+                as.mov(RAX, static_cast<std::uint64_t>(JitExit::RETURN));
+                as.jump(epilogue);
+                return true;
+            default:
+                // Closures need the heap frame, and definitions of globals and
+                // errors are left to the VM.
+                return false;
+        }
+    }
+
+public:
+    explicit JitCompiler(const Prototype& proto) : proto{proto}, code{proto.getCode()} {}
+
+    std::vector<std::uint8_t> compile() {
+        auto size = proto.getCodeSize();
+        targets.resize(size);
+        for (auto&& target : targets) {
+            target = as.newLabel();
+        }
+        epilogue = as.newLabel();
+
+        // Four pushes and a pad keep the stack 16-byte aligned for calls.
+        as.push(RBX);
+        as.push(R12);
+        as.push(R13);
+        as.push(R15);
+        as.add(RSP, -8);
+        as.mov(R15, RDI);
+        as.load(R13, R15, offsetof(JitFrame, locals));
+        as.load(R12, R15, offsetof(JitFrame, sp));
+        as.load(RBX, R15, offsetof(JitFrame, caches));
+
+        for (std::uint32_t pc = 0; pc < size; pc += 1 + operandCount(code[pc])) {
+            as.bind(targets[pc]);
+            if (!translate(pc)) {
+                as.jump(resume(pc));
+            }
+        }
+
+        for (auto [label, pc] : resumes) {
+            as.bind(label);
+            as.store(R15, offsetof(JitFrame, sp), R12);
+            as.store32(R15, offsetof(JitFrame, pc), pc);
+            as.mov(RAX, static_cast<std::uint64_t>(JitExit::RESUME));
+            as.jump(epilogue);
+        }
+
+        as.bind(epilogue);
+        as.add(RSP, 8);
+        as.pop(R15);
+        as.pop(R13);
+        as.pop(R12);
+        as.pop(RBX);
+        as.ret();
+        return as.finish();
+    }
+};
+
+#endif
+
+bool isJitEnabled() {
+    return jitEnabled;
+}
+
+void setJitEnabled(bool enabled) {
+    jitEnabled = enabled;
+}
+
+NativeCode::~NativeCode() {
+#ifdef MINI_LISP_JIT
+    if (memory) {
+        munmap(memory, size);
+    }
+#endif
+}
+
+JitExit NativeCode::run(JitFrame& frame) const {
+    auto exit = entry(&frame);
+#ifdef MINI_LISP_JIT
+    if (exit == EXIT_THROW) {
+        std::rethrow_exception(std::exchange(pendingError, nullptr));
+    }
+#endif
+    return static_cast<JitExit>(exit);
+}
+
+#ifdef MINI_LISP_JIT
+
+std::unique_ptr<NativeCode> compileNative(const Prototype& proto) {
+    auto bytes = JitCompiler(proto).compile();
+    auto memory = mmap(nullptr, bytes.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                       -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(memory, bytes.data(), bytes.size());
+    if (mprotect(memory, bytes.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, bytes.size());
+        return nullptr;
+    }
+    return std::make_unique<NativeCode>(memory, bytes.size());
+}
+
+#else
+
+std::unique_ptr<NativeCode> compileNative(const Prototype&) {
+    return nullptr;
+}
+
+#endif
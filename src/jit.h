@@ -0,0 +1,67 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "./value.h"
+
+class EvaluateEnv;
+class Prototype;
+struct GlobalCache;
+
+// Prototypes entered this many times are compiled to machine code.
+constexpr std::uint32_t JIT_THRESHOLD{1000};
+
+bool isJitEnabled();
+void setJitEnabled(bool enabled);
+
+// The state of an activation, shared between the VM and compiled code, which
+// works on the VM's frame and operand stack in place.
+struct JitFrame {
+    ValuePtr* locals;
+    ValuePtr* sp;
+    GlobalCache* caches;
+    EvaluateEnv* env;
+    const Prototype* proto;
+    ValuePtr result;   // set on JitExit::RETURN
+    std::uint32_t pc;  // set on JitExit::RESUME, along with sp
+};
+
+enum class JitExit : std::uint32_t {
+    RETURN,
+    // Continue in the VM at `pc`, because a type guard failed or the
+    // instruction there is one the compiled code leaves to the VM.
+    RESUME,
+};
+
+// Machine code for one prototype: either compiled by the JIT into executable
+// memory of its own, or compiled ahead of time and linked into the program.
+class NativeCode {
+public:
+    // Returns a JitExit.
+    using Entry = std::uint32_t (*)(JitFrame*);
+
+private:
+    Entry entry;
+    void* memory{nullptr};
+    std::size_t size{0};
+
+public:
+    explicit NativeCode(Entry entry) : entry{entry} {}
+    NativeCode(void* memory, std::size_t size)
+        : entry{reinterpret_cast<Entry>(memory)}, memory{memory}, size{size} {}
+    NativeCode(const NativeCode&) = delete;
+    NativeCode& operator=(const NativeCode&) = delete;
+    ~NativeCode();
+
+    // Runs from the start of the prototype, with the frame set up. Errors are
+    // thrown as they would be by the VM.
+    JitExit run(JitFrame& frame) const;
+};
+
+// nullptr where there is no JIT for the platform.
+std::unique_ptr<NativeCode> compileNative(const Prototype& proto);
+
+#endif
@@ -0,0 +1,224 @@
+#include "./lexer.h"
+
+#include <limits>
+#include <optional>
+
+#include "./char_class.h"
+#include "./error.h"
+#include "./tokenizer.h"
+
+namespace {
+
+std::optional<TokenType> punctuationType(char c) {
+    switch (c) {
+        case '(': return TokenType::LEFT_PAREN;
+        case ')': return TokenType::RIGHT_PAREN;
+        case '\'': return TokenType::QUOTE;
+        case '`': return TokenType::QUASIQUOTE;
+        case ',': return TokenType::UNQUOTE;
+        default: return std::nullopt;
+    }
+}
+
+}  // namespace
+
+Lexemes::Lexemes(std::string_view source, bool final) : source{source}, final{final} {
+    if (source.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw SyntaxError("Source text too large");
+    }
+    try {
+        scan();
+    } catch (SyntaxError&) {
+        // Raised again by the Lexemes of the text from the malformed lexeme
+        // on, once the ones before it have been read.
+        if (lexemes.empty()) {
+            throw;
+        }
+    }
+}
+
+void Lexemes::scan() {
+    auto push = [&](TokenType type, std::size_t start, std::size_t end) {
+        lexemes.push_back({type, false, static_cast<std::uint32_t>(start),
+                           static_cast<std::uint32_t>(end - start)});
+    };
+    auto& kernels = ScanKernels::get();
+    auto text = source.data();
+    auto size = source.size();
+    std::size_t pos = 0;
+    for (; pos < size; end = pos) {
+        auto c = source[pos];
+        if (c == ';') {
+            auto newline = kernels.findNewline(text, size, pos);
+            if (newline == size && !final) {
+                // The comment may go on in the text after this.
+                break;
+            }
+            pos = newline;
+        } else if (isSpace(c)) {
+            pos = kernels.skipSpace(text, size, pos + 1);
+        } else if (auto type = punctuationType(c)) {
+            push(*type, pos, pos + 1);
+            pos++;
+        } else if (c == '#' && !Tokenizer::isRadixPrefix(source, pos)) {
+            if (pos + 1 == source.size() && !final) {
+                break;
+            }
+            auto next = pos + 1 < source.size() ? source[pos + 1] : '\0';
+            if (next == '(') {
+                push(TokenType::VECTOR_PAREN, pos, pos + 2);
+            } else if (next == 't' || next == 'f') {
+                push(TokenType::BOOLEAN_LITERAL, pos, pos + 2);
+            } else {
+                throw SyntaxError("Unexpected character after #");
+            }
+            pos += 2;
+        } else if (c == '"') {
+            auto after = scanString(pos + 1);
+            if (after == std::string_view::npos) {
+                break;
+            }
+            pos = after;
+        } else {
+            auto start = pos;
+            pos = kernels.findDelimiter(text, size, pos + 1);
+            if (pos == size && !final) {
+                pos = start;
+                break;
+            }
+            push(Tokenizer::classifyAtom(source.substr(start, pos - start)), start, pos);
+        }
+    }
+    end = pos;
+}
+
+// Scans a string literal whose contents start at `start`, and returns the
+// position after its closing quote, or npos if the text ends before it but is
+// not final.
+std::size_t Lexemes::scanString(std::size_t start) {
+    auto& kernels = ScanKernels::get();
+    auto end = kernels.findStringEnd(source.data(), source.size(), start);
+    if (end == source.size()) {
+        return unterminatedString();
+    }
+    if (source[end] == '"') {
+        lexemes.push_back({TokenType::STRING_LITERAL, false, static_cast<std::uint32_t>(start),
+                           static_cast<std::uint32_t>(end - start)});
+        return end + 1;
+    }
+    std::string value(source.substr(start, end - start));
+    // Each time round, `pos` is at a quote or a backslash.
+    for (auto pos = end; pos < source.size();) {
+        if (source[pos] == '"') {
+            lexemes.push_back({TokenType::STRING_LITERAL, true,
+                               static_cast<std::uint32_t>(unescaped.size()),
+                               static_cast<std::uint32_t>(value.size())});
+            unescaped.push_back(std::move(value));
+            return pos + 1;
+        }
+        if (pos + 1 >= source.size()) {
+            break;
+        }
+        auto next = source[pos + 1];
+        value += next == 'n' ? '\n' : next;
+        auto run = kernels.findStringEnd(source.data(), source.size(), pos + 2);
+        value.append(source.substr(pos + 2, run - (pos + 2)));
+        pos = run;
+    }
+    return unterminatedString();
+}
+
+std::size_t Lexemes::unterminatedString() const {
+    if (final) {
+        throw SyntaxError("Unexpected end of string literal");
+    }
+    return std::string_view::npos;
+}
+
+namespace {
+
+// The size of the text TokenStream scans at a time, unless a single lexeme is
+// longer.
+constexpr std::size_t CHUNK_SIZE{64 * 1024};
+
+}  // namespace
+
+// Appends the next line of input to the buffer, or as much of it as fits in a
+// chunk.
+void TokenStream::readLine() {
+    line.resize(CHUNK_SIZE + 1);
+    input->getline(line.data(), line.size());
+    std::size_t count = input->gcount();
+    if (input->eof()) {
+        exhausted = true;
+        buffer.append(line.data(), count);
+    } else if (input->fail()) {
+        // A line longer than a chunk, which goes on in the next one.
+        input->clear();
+        buffer.append(line.data(), count);
+    } else {
+        // The newline is read but not stored.
+        buffer.append(line.data(), count - 1).push_back('\n');
+    }
+    rest = buffer;
+}
+
+bool TokenStream::refill() {
+    lexemes.reset();
+    position = 0;
+    auto size = CHUNK_SIZE;
+    while (true) {
+        if (input && !exhausted) {
+            buffer.erase(0, buffer.size() - rest.size());
+            rest = buffer;
+            if (rest.size() < size) {
+                readLine();
+            }
+        }
+        auto final = exhausted && rest.size() <= size;
+        lexemes.emplace(rest.substr(0, size), final);
+        rest.remove_prefix(lexemes->getEnd());
+        if (!lexemes->get().empty()) {
+            return true;
+        }
+        if (final) {
+            return false;
+        }
+        // Only whitespace and comments, or a lexeme that goes on past the
+        // chunk, which is then made larger, or past the input read so far.
+        if (lexemes->getEnd() == 0 && rest.size() >= size) {
+            size *= 2;
+        }
+    }
+}
+
+TokenPtr TokenStream::next() {
+    if (!lexemes || position == lexemes->get().size()) {
+        if (!refill()) {
+            return nullptr;
+        }
+    }
+    return lexemes->toToken(lexemes->get()[position++]);
+}
+
+std::string_view Lexemes::getText(const Lexeme& lexeme) const {
+    if (lexeme.unescaped) {
+        return unescaped[lexeme.offset];
+    }
+    return source.substr(lexeme.offset, lexeme.length);
+}
+
+TokenPtr Lexemes::toToken(const Lexeme& lexeme) const {
+    auto text = getText(lexeme);
+    switch (lexeme.type) {
+        case TokenType::VECTOR_PAREN: return Token::vectorParen();
+        case TokenType::BOOLEAN_LITERAL:
+            return std::make_unique<BooleanLiteralToken>(text[1] == 't');
+        case TokenType::STRING_LITERAL:
+            return std::make_unique<StringLiteralToken>(std::string(text));
+        case TokenType::DOT:
+        case TokenType::NUMERIC_LITERAL:
+        case TokenType::IDENTIFIER: return Tokenizer::atomToken(text);
+        default: return Token::fromChar(text[0]);
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "./token.h"
+
+// A token as the characters of the source text it spans, a plain value so that
+// a whole file scans into one contiguous array without allocating per token.
+struct Lexeme {
+    TokenType type;
+    // Whether this is a string literal with escape sequences, whose contents
+    // are at index `offset` of Lexemes::unescaped instead.
+    bool unescaped;
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+static_assert(std::is_trivially_copyable_v<Lexeme> && sizeof(Lexeme) == 12);
+
+// The lexemes of a source text, read as Tokenizer reads it, which must outlive
+// them. Only string literals with escape sequences are copied out of it.
+class Lexemes {
+private:
+    std::string_view source;
+    // Whether the source ends with `source`, rather than going on in text
+    // not read yet.
+    bool final;
+    std::size_t end{0};
+    std::vector<Lexeme> lexemes;
+    std::vector<std::string> unescaped;
+
+    void scan();
+    std::size_t scanString(std::size_t pos);
+    std::size_t unterminatedString() const;
+
+public:
+    // Throws a SyntaxError if `source` starts with a malformed lexeme, and
+    // stops before one that comes later. Unless the source is final, a lexeme
+    // that may go on past its end is left for the next text too.
+    explicit Lexemes(std::string_view source, bool final = true);
+
+    std::span<const Lexeme> get() const {
+        return lexemes;
+    }
+    // How much of the source the lexemes and the whitespace and comments
+    // between them take up; all of it if it is final.
+    std::size_t getEnd() const {
+        return end;
+    }
+    // The name of an identifier, the text of a number or boolean, and the
+    // contents of a string literal.
+    std::string_view getText(const Lexeme& lexeme) const;
+    TokenPtr toToken(const Lexeme& lexeme) const;
+};
+
+// The Tokens of a source text, scanned a chunk at a time as a Reader asks for
+// them, so that reading takes memory for one chunk and the form being read
+// rather than for the whole text. The text is either in memory already, such
+// as a mapped SourceFile, or read from a stream a line at a time.
+class TokenStream {
+private:
+    std::istream* input{nullptr};
+    // What has been read from `input`.
+    std::string buffer;
+    std::vector<char> line;
+    // The text after the lexemes scanned so far.
+    std::string_view rest;
+    bool exhausted{true};
+    std::optional<Lexemes> lexemes;
+    // The index of the next lexeme to make a Token of.
+    std::size_t position{0};
+
+    void readLine();
+    bool refill();
+
+public:
+    // Over `text`, which must outlive the stream.
+    explicit TokenStream(std::string_view text) : rest{text} {}
+    explicit TokenStream(std::istream& input) : input{&input}, exhausted{false} {}
+
+    // The next token, or null at the end of the text.
+    TokenPtr next();
+};
+
+#endif
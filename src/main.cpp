@@ -1,12 +1,55 @@
 #ifndef __EMSCRIPTEN__
 
+#include <cstring>
+#include <iostream>
+
+#include "./compiler.h"
+#include "./gc.h"
+#include "./image.h"
+#include "./jit.h"
 #include "./repl.h"
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
+    GcHeap::registerStack(&argc);
+    int arg = 1;
+    // Reports how many calls the compiler folded into constants, on exit.
+    bool foldStats = false;
+    for (; arg < argc; arg++) {
+        if (std::strcmp(argv[arg], "--fold-stats") == 0) {
+            foldStats = true;
+        } else if (std::strcmp(argv[arg], "--no-jit") == 0) {
+            // Runs everything on the bytecode VM.
+            setJitEnabled(false);
+        } else {
+            break;
+        }
+    }
+    if (arg == argc) {
         readEvalPrintLoop();
+    } else if (std::strcmp(argv[arg], "--disassemble") == 0) {
+        if (arg + 1 == argc) {
+            std::cerr << "Usage: " << argv[0] << " --disassemble FILE" << std::endl;
+            return 1;
+        }
+        disassembleFile(argv[arg + 1]);
+    } else if (std::strcmp(argv[arg], "--compile-image") == 0) {
+        if (arg + 2 >= argc) {
+            std::cerr << "Usage: " << argv[0] << " --compile-image OUTPUT FILE" << std::endl;
+            return 1;
+        }
+        compileImage(argv[arg + 2], argv[arg + 1]);
+    } else if (std::strcmp(argv[arg], "--image") == 0) {
+        if (arg + 1 == argc) {
+            std::cerr << "Usage: " << argv[0] << " --image IMAGE" << std::endl;
+            return 1;
+        }
+        runImage(argv[arg + 1]);
     } else {
-        loadFile(argv[1]);
+        loadFile(argv[arg]);
+    }
+    if (foldStats) {
+        std::cerr << "Folded " << Compiler::getFoldedCount() << " call nodes into constants"
+                  << std::endl;
     }
 }
 
@@ -0,0 +1,287 @@
+#include "./node.h"
+
+#include "./bytecode.h"
+
+namespace {
+
+void finish(CodeBuilder& builder, bool tail) {
+    if (tail) {
+        builder.emitReturn();
+    }
+}
+
+}  // namespace
+
+void ConstantNode::emit(CodeBuilder& builder, bool tail) const {
+    builder.emitConstant(value);
+    finish(builder, tail);
+}
+
+void ConstantNode::trace(GcTracer& tracer) const {
+    tracer.mark(value.get());
+}
+
+void LocalNode::emit(CodeBuilder& builder, bool tail) const {
+    builder.emitLocal(depth, slot, name);
+    finish(builder, tail);
+}
+
+void GlobalNode::emit(CodeBuilder& builder, bool tail) const {
+    builder.emitGlobal(name);
+    finish(builder, tail);
+}
+
+void DefineLocalNode::emit(CodeBuilder& builder, bool tail) const {
+    value->emit(builder, false);
+    builder.emitDefineLocal(slot, name);
+    finish(builder, tail);
+}
+
+void DefineLocalNode::trace(GcTracer& tracer) const {
+    tracer.mark(value);
+}
+
+void DefineGlobalNode::emit(CodeBuilder& builder, bool tail) const {
+    value->emit(builder, false);
+    builder.emitDefineGlobal(name);
+    finish(builder, tail);
+}
+
+void DefineGlobalNode::trace(GcTracer& tracer) const {
+    tracer.mark(value);
+}
+
+void IfNode::emit(CodeBuilder& builder, bool tail) const {
+    test->emit(builder, false);
+    auto otherwise = builder.emitJump(OpCode::JUMP_IF_FALSE);
+    auto depth = builder.getDepth();
+    consequent->emit(builder, tail);
+    auto end = tail ? 0 : builder.emitJump(OpCode::JUMP);
+    builder.bind(otherwise);
+    builder.setDepth(depth);
+    if (alternative) {
+        alternative->emit(builder, tail);
+    } else {
+        builder.emitNil();
+        finish(builder, tail);
+    }
+    if (!tail) {
+        builder.bind(end);
+    }
+}
+
+void IfNode::trace(GcTracer& tracer) const {
+    tracer.mark(test);
+    tracer.mark(consequent);
+    tracer.mark(alternative);
+}
+
+namespace {
+
+// `and` and `or`: every operand but the last may end the evaluation early,
+// with its own value.
+void emitShortCircuit(CodeBuilder& builder, bool tail, const std::vector<Node*>& operands,
+                      OpCode exit, bool empty) {
+    if (operands.empty()) {
+        builder.emitConstant(Value::fromBoolean(empty));
+        finish(builder, tail);
+        return;
+    }
+    std::vector<CodeBuilder::Label> exits;
+    for (std::size_t i = 0; i + 1 < operands.size(); i++) {
+        operands[i]->emit(builder, false);
+        exits.push_back(builder.emitJump(exit));
+    }
+    auto depth = builder.getDepth() + 1;
+    operands.back()->emit(builder, tail);
+    for (auto label : exits) {
+        builder.bind(label);
+    }
+    builder.setDepth(depth);
+    if (tail && !exits.empty()) {
+        builder.emitReturn();
+    }
+}
+
+}  // namespace
+
+void AndNode::emit(CodeBuilder& builder, bool tail) const {
+    emitShortCircuit(builder, tail, operands, OpCode::JUMP_IF_FALSE_OR_POP, true);
+}
+
+void AndNode::trace(GcTracer& tracer) const {
+    for (auto operand : operands) {
+        tracer.mark(operand);
+    }
+}
+
+void OrNode::emit(CodeBuilder& builder, bool tail) const {
+    emitShortCircuit(builder, tail, operands, OpCode::JUMP_IF_TRUE_OR_POP, false);
+}
+
+void OrNode::trace(GcTracer& tracer) const {
+    for (auto operand : operands) {
+        tracer.mark(operand);
+    }
+}
+
+void SequenceNode::emit(CodeBuilder& builder, bool tail) const {
+    for (std::size_t i = 0; i + 1 < body.size(); i++) {
+        body[i]->emit(builder, false);
+        builder.emitPop();
+    }
+    body.back()->emit(builder, tail);
+}
+
+void SequenceNode::trace(GcTracer& tracer) const {
+    for (auto node : body) {
+        tracer.mark(node);
+    }
+}
+
+void CondNode::emit(CodeBuilder& builder, bool tail) const {
+    auto depth = builder.getDepth();
+    std::vector<CodeBuilder::Label> ends;
+    for (auto&& [test, body] : clauses) {
+        if (!test) {
+            if (body) {
+                body->emit(builder, tail);
+            } else {
+                builder.emitConstant(Value::fromBoolean(true));
+                finish(builder, tail);
+            }
+            if (!tail) {
+                ends.push_back(builder.emitJump(OpCode::JUMP));
+            }
+            break;
+        }
+        test->emit(builder, false);
+        if (!body) {
+            ends.push_back(builder.emitJump(OpCode::JUMP_IF_TRUE_OR_POP));
+            continue;
+        }
+        auto next = builder.emitJump(OpCode::JUMP_IF_FALSE);
+        body->emit(builder, tail);
+        if (!tail) {
+            ends.push_back(builder.emitJump(OpCode::JUMP));
+        }
+        builder.bind(next);
+        builder.setDepth(depth);
+    }
+    builder.setDepth(depth);
+    builder.emitNil();
+    finish(builder, tail);
+    for (auto label : ends) {
+        builder.bind(label);
+    }
+    builder.setDepth(depth + 1);
+    if (tail && !ends.empty()) {
+        builder.emitReturn();
+    }
+}
+
+void CondNode::trace(GcTracer& tracer) const {
+    for (auto&& [test, body] : clauses) {
+        tracer.mark(test);
+        tracer.mark(body);
+    }
+}
+
+void LambdaNode::emit(CodeBuilder& builder, bool tail) const {
+    auto proto = new Prototype(paramCount, frameSize);
+    CodeBuilder nested(proto);
+    body->emit(nested, true);
+    builder.emitClosure(proto);
+    finish(builder, tail);
+}
+
+void LambdaNode::trace(GcTracer& tracer) const {
+    tracer.mark(body);
+}
+
+void LetNode::emit(CodeBuilder& builder, bool tail) const {
+    for (auto value : values) {
+        value->emit(builder, false);
+    }
+    if (!values.empty()) {
+        builder.emitBind(slot, values.size());
+    }
+    body->emit(builder, tail);
+}
+
+void LetNode::trace(GcTracer& tracer) const {
+    tracer.mark(body);
+    for (auto value : values) {
+        tracer.mark(value);
+    }
+}
+
+void CallNode::emit(CodeBuilder& builder, bool tail) const {
+    callee->emit(builder, false);
+    for (auto arg : args) {
+        arg->emit(builder, false);
+    }
+    builder.emitCall(args.size(), tail);
+}
+
+void CallNode::trace(GcTracer& tracer) const {
+    tracer.mark(callee);
+    for (auto arg : args) {
+        tracer.mark(arg);
+    }
+}
+
+void PrimitiveCallNode::emit(CodeBuilder& builder, bool tail) const {
+    for (auto arg : args) {
+        arg->emit(builder, false);
+    }
+    builder.emitPrimitive(primitive, name, args.size());
+    finish(builder, tail);
+}
+
+void PrimitiveCallNode::trace(GcTracer& tracer) const {
+    for (auto arg : args) {
+        tracer.mark(arg);
+    }
+}
+
+void FoldedNode::emit(CodeBuilder& builder, bool tail) const {
+    std::vector<CodeBuilder::Label> changed;
+    for (auto&& [name, binding] : guards) {
+        changed.push_back(builder.emitGuard(name, binding));
+    }
+    auto depth = builder.getDepth();
+    builder.emitConstant(value);
+    finish(builder, tail);
+    auto end = tail ? 0 : builder.emitJump(OpCode::JUMP);
+    for (auto label : changed) {
+        builder.bind(label);
+    }
+    builder.setDepth(depth);
+    call->emit(builder, tail);
+    if (!tail) {
+        builder.bind(end);
+    }
+}
+
+void FoldedNode::trace(GcTracer& tracer) const {
+    tracer.mark(value.get());
+    tracer.mark(call);
+}
+
+void ConsNode::emit(CodeBuilder& builder, bool tail) const {
+    car->emit(builder, false);
+    cdr->emit(builder, false);
+    builder.emitCons();
+    finish(builder, tail);
+}
+
+void ConsNode::trace(GcTracer& tracer) const {
+    tracer.mark(car);
+    tracer.mark(cdr);
+}
+
+void ErrorNode::emit(CodeBuilder& builder, bool tail) const {
+    builder.emitError(message);
+    finish(builder, tail);
+}
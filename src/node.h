@@ -0,0 +1,282 @@
+#ifndef NODE_H
+#define NODE_H
+
+#include <concepts>
+#include <string>
+#include <vector>
+
+#include "./gc.h"
+#include "./value.h"
+
+class CodeBuilder;
+struct GlobalBinding;
+enum class Primitive : std::uint32_t;
+
+// A pre-analysed expression. The compiler turns every top-level form and
+// lambda body into a tree of nodes, with syntax checked and local variables
+// resolved, and the tree is then translated into bytecode.
+class Node : public GcObject {
+public:
+    // Emits code that pushes the value of this node; in tail position, code
+    // that returns it from the current activation instead.
+    virtual void emit(CodeBuilder& builder, bool tail) const = 0;
+};
+
+// Nodes held by C++ code while a tree is being built.
+using NodeVector = std::vector<Node*, GcRootAllocator<Node*>>;
+
+// The arguments are evaluated before the node is allocated, so that building
+// them cannot trigger a collection that sees the half-built node.
+template <std::derived_from<Node> T, typename... Args>
+T* makeNode(Args&&... args) {
+    return new T(std::forward<Args>(args)...);
+}
+
+class ConstantNode final : public Node {
+private:
+    ValuePtr value;
+
+public:
+    ConstantNode(ValuePtr value) : value{value} {}
+
+    ValuePtr getValue() const {
+        return value;
+    }
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// A local variable, `depth` frames up from the current one.
+class LocalNode final : public Node {
+private:
+    std::uint32_t depth;
+    std::uint32_t slot;
+    SymbolId name;
+
+public:
+    LocalNode(std::uint32_t depth, std::uint32_t slot, SymbolId name)
+        : depth{depth}, slot{slot}, name{name} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+};
+
+class GlobalNode final : public Node {
+private:
+    SymbolId name;
+
+public:
+    GlobalNode(SymbolId name) : name{name} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+};
+
+// An internal define, which always targets the current frame.
+class DefineLocalNode final : public Node {
+private:
+    std::uint32_t slot;
+    SymbolId name;
+    Node* value;
+
+public:
+    DefineLocalNode(std::uint32_t slot, SymbolId name, Node* value)
+        : slot{slot}, name{name}, value{value} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+class DefineGlobalNode final : public Node {
+private:
+    SymbolId name;
+    Node* value;
+
+public:
+    DefineGlobalNode(SymbolId name, Node* value) : name{name}, value{value} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+class IfNode final : public Node {
+private:
+    Node* test;
+    Node* consequent;
+    Node* alternative;  // nullptr if absent
+
+public:
+    IfNode(Node* test, Node* consequent, Node* alternative)
+        : test{test}, consequent{consequent}, alternative{alternative} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+class AndNode final : public Node {
+private:
+    std::vector<Node*> operands;
+
+public:
+    AndNode(const NodeVector& operands) : operands(operands.begin(), operands.end()) {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+class OrNode final : public Node {
+private:
+    std::vector<Node*> operands;
+
+public:
+    OrNode(const NodeVector& operands) : operands(operands.begin(), operands.end()) {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// `begin` and procedure bodies; never empty.
+class SequenceNode final : public Node {
+private:
+    std::vector<Node*> body;
+
+public:
+    SequenceNode(const NodeVector& body) : body(body.begin(), body.end()) {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+class CondNode final : public Node {
+public:
+    struct Clause {
+        Node* test;  // nullptr for else
+        Node* body;  // nullptr if the clause yields its test
+    };
+
+private:
+    std::vector<Clause> clauses;
+
+public:
+    CondNode(std::vector<Clause> clauses) : clauses{std::move(clauses)} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// A lambda body, compiled into a prototype of its own. Frames hold the
+// parameters in the first slots, followed by the body's internal defines.
+class LambdaNode final : public Node {
+private:
+    std::size_t paramCount;
+    std::size_t frameSize;
+    Node* body;
+
+public:
+    LambdaNode(std::size_t paramCount, std::size_t frameSize, Node* body)
+        : paramCount{paramCount}, frameSize{frameSize}, body{body} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// Stores the values in consecutive slots of the current frame, from `slot`
+// on, and runs the body; let gets no frame or closure of its own.
+class LetNode final : public Node {
+private:
+    std::uint32_t slot;
+    std::vector<Node*> values;
+    Node* body;
+
+public:
+    LetNode(std::uint32_t slot, const NodeVector& values, Node* body)
+        : slot{slot}, values(values.begin(), values.end()), body{body} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+class CallNode final : public Node {
+private:
+    Node* callee;
+    std::vector<Node*> args;
+
+public:
+    CallNode(Node* callee, const NodeVector& args)
+        : callee{callee}, args(args.begin(), args.end()) {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// A call of a global named like one of the primitives, which the VM runs
+// inline for as long as the global holds the stock builtin.
+class PrimitiveCallNode final : public Node {
+private:
+    Primitive primitive;
+    SymbolId name;
+    std::vector<Node*> args;
+
+public:
+    PrimitiveCallNode(Primitive primitive, SymbolId name, const NodeVector& args)
+        : primitive{primitive}, name{name}, args(args.begin(), args.end()) {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// A call of pure builtins on constants, evaluated by the compiler. The value
+// is a constant of the prototype; `call` is run instead once any of the
+// globals the value was computed with has been redefined.
+class FoldedNode final : public Node {
+public:
+    struct Guard {
+        SymbolId name;
+        GlobalBinding* binding;
+    };
+
+private:
+    ValuePtr value;
+    std::vector<Guard> guards;
+    Node* call;
+
+public:
+    FoldedNode(ValuePtr value, std::vector<Guard> guards, Node* call)
+        : value{value}, guards{std::move(guards)}, call{call} {}
+
+    ValuePtr getValue() const {
+        return value;
+    }
+    const std::vector<Guard>& getGuards() const {
+        return guards;
+    }
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// Builds a fresh pair on every evaluation, for quasiquote templates.
+class ConsNode final : public Node {
+private:
+    Node* car;
+    Node* cdr;
+
+public:
+    ConsNode(Node* car, Node* cdr) : car{car}, cdr{cdr} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+    void trace(GcTracer& tracer) const override;
+};
+
+// A malformed form. The error is raised when the form is evaluated, as the
+// interpreter always did, rather than when the enclosing form is compiled.
+class ErrorNode final : public Node {
+private:
+    std::string message;
+
+public:
+    ErrorNode(std::string message) : message{std::move(message)} {}
+
+    void emit(CodeBuilder& builder, bool tail) const override;
+};
+
+#endif
@@ -0,0 +1,315 @@
+#include "./number.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <optional>
+#include <string>
+
+#include "./error.h"
+
+namespace {
+
+// `value` must be integral and finite.
+BigInt integralToBigInt(double value) {
+    if (std::abs(value) < 0x1p63) {
+        return BigInt(static_cast<std::int64_t>(value));
+    }
+    int exponent;
+    auto fraction = std::frexp(value, &exponent);
+    BigInt result(static_cast<std::int64_t>(std::ldexp(fraction, 53)));
+    for (exponent -= 53; exponent > 0; exponent -= 30) {
+        result = result * BigInt(std::int64_t{1} << std::min(exponent, 30));
+    }
+    return result;
+}
+
+// Compares without rounding `b`, which may well be far from a double.
+std::partial_ordering compareExact(const BigInt& a, double b) {
+    if (std::isnan(b)) {
+        return std::partial_ordering::unordered;
+    } else if (std::isinf(b)) {
+        return b > 0 ? std::partial_ordering::less : std::partial_ordering::greater;
+    }
+    auto whole = std::trunc(b);
+    if (auto order = a <=> integralToBigInt(whole); order != 0) {
+        return order;
+    }
+    return 0.0 <=> b - whole;
+}
+
+// Exact integers that fit in a machine word, bignums included, are added,
+// subtracted, multiplied and compared without going through BigInt.
+template <typename F>
+std::optional<ValuePtr> wordArithmetic(ValuePtr a, ValuePtr b, F op) {
+    if (!a.isInteger() || !b.isInteger()) {
+        return std::nullopt;
+    }
+    auto x = a.toInt64();
+    auto y = b.toInt64();
+    std::int64_t result;
+    if (x && y && !op(*x, *y, &result)) {
+        return ValuePtr::fromInteger(result);
+    }
+    return std::nullopt;
+}
+
+bool addOverflows(std::int64_t x, std::int64_t y, std::int64_t* sum) {
+    if (y > 0 ? x > INT64_MAX - y : x < INT64_MIN - y) {
+        return true;
+    }
+    *sum = x + y;
+    return false;
+}
+
+bool subOverflows(std::int64_t x, std::int64_t y, std::int64_t* difference) {
+    if (y < 0 ? x > INT64_MAX + y : x < INT64_MIN + y) {
+        return true;
+    }
+    *difference = x - y;
+    return false;
+}
+
+bool mulOverflows(std::int64_t x, std::int64_t y, std::int64_t* product) {
+    return detail::multiplyOverflows(x, y, *product);
+}
+
+void checkDivisor(ValuePtr b) {
+    if (numberIsZero(b)) {
+        throw LispError("Division by zero");
+    }
+}
+
+}  // namespace
+
+namespace detail {
+
+ValuePtr addSlow(ValuePtr a, ValuePtr b) {
+    if (auto result = wordArithmetic(a, b, addOverflows)) {
+        return *result;
+    } else if (a.isInteger() && b.isInteger()) {
+        return ValuePtr::fromBigInt(a.toBigInt() + b.toBigInt());
+    }
+    return ValuePtr::fromNumber(a.asNumber() + b.asNumber());
+}
+
+ValuePtr subSlow(ValuePtr a, ValuePtr b) {
+    if (auto result = wordArithmetic(a, b, subOverflows)) {
+        return *result;
+    } else if (a.isInteger() && b.isInteger()) {
+        return ValuePtr::fromBigInt(a.toBigInt() - b.toBigInt());
+    }
+    return ValuePtr::fromNumber(a.asNumber() - b.asNumber());
+}
+
+ValuePtr mulSlow(ValuePtr a, ValuePtr b) {
+    if (auto result = wordArithmetic(a, b, mulOverflows)) {
+        return *result;
+    } else if (a.isInteger() && b.isInteger()) {
+        return ValuePtr::fromBigInt(a.toBigInt() * b.toBigInt());
+    }
+    return ValuePtr::fromNumber(a.asNumber() * b.asNumber());
+}
+
+std::partial_ordering compareSlow(ValuePtr a, ValuePtr b) {
+    if (a.isInteger() && b.isInteger()) {
+        if (auto x = a.toInt64(), y = b.toInt64(); x && y) {
+            return *x <=> *y;
+        }
+        return a.toBigInt() <=> b.toBigInt();
+    } else if (a.isBignum()) {
+        return compareExact(a.toBigInt(), b.asFlonum());
+    } else if (b.isBignum()) {
+        return 0 <=> compareExact(b.toBigInt(), a.asFlonum());
+    }
+    // A fixnum and a flonum; doubles hold every fixnum exactly.
+    return a.asNumber() <=> b.asNumber();
+}
+
+}  // namespace detail
+
+ValuePtr numberNegate(ValuePtr a) {
+    if (a.isFixnum()) {
+        return ValuePtr::fromInteger(-a.asFixnum());
+    } else if (a.isBignum()) {
+        return ValuePtr::fromBigInt(-a.toBigInt());
+    }
+    return ValuePtr::fromNumber(-a.asFlonum());
+}
+
+ValuePtr numberAbs(ValuePtr a) {
+    if (a.isFlonum()) {
+        return ValuePtr::fromNumber(std::abs(a.asFlonum()));
+    }
+    return numberCompare(a, ValuePtr::fromFixnum(0)) < 0 ? numberNegate(a) : a;
+}
+
+ValuePtr numberDivide(ValuePtr a, ValuePtr b) {
+    if (a.isInteger() && b.isInteger() && !numberIsZero(b)) {
+        if (a.isFixnum() && b.isFixnum()) {
+            if (a.asFixnum() % b.asFixnum() == 0) {
+                return ValuePtr::fromInteger(a.asFixnum() / b.asFixnum());
+            }
+        } else if (auto [quotient, remainder] = BigInt::divide(a.toBigInt(), b.toBigInt());
+                   remainder.isZero()) {
+            return ValuePtr::fromBigInt(std::move(quotient));
+        }
+    }
+    return ValuePtr::fromNumber(a.asNumber() / b.asNumber());
+}
+
+ValuePtr numberQuotient(ValuePtr a, ValuePtr b) {
+    checkDivisor(b);
+    if (a.isFixnum() && b.isFixnum()) {
+        return ValuePtr::fromInteger(a.asFixnum() / b.asFixnum());
+    } else if (a.isInteger() && b.isInteger()) {
+        return ValuePtr::fromBigInt(BigInt::divide(a.toBigInt(), b.toBigInt()).first);
+    }
+    return ValuePtr::fromNumber(std::trunc(a.asNumber() / b.asNumber()));
+}
+
+ValuePtr numberRemainder(ValuePtr a, ValuePtr b) {
+    checkDivisor(b);
+    if (a.isFixnum() && b.isFixnum()) {
+        return ValuePtr::fromFixnum(a.asFixnum() % b.asFixnum());
+    } else if (a.isInteger() && b.isInteger()) {
+        return ValuePtr::fromBigInt(BigInt::divide(a.toBigInt(), b.toBigInt()).second);
+    }
+    return ValuePtr::fromNumber(std::fmod(a.asNumber(), b.asNumber()));
+}
+
+ValuePtr numberModulo(ValuePtr a, ValuePtr b) {
+    auto remainder = numberRemainder(a, b);
+    if (!numberIsZero(remainder) &&
+        (numberCompare(remainder, ValuePtr::fromFixnum(0)) < 0) !=
+            (numberCompare(b, ValuePtr::fromFixnum(0)) < 0)) {
+        return numberAdd(remainder, b);
+    }
+    return remainder;
+}
+
+ValuePtr numberExpt(ValuePtr a, ValuePtr b) {
+    if (a.isInteger() && b.isFixnum()) {
+        auto exponent = b.asFixnum();
+        if (exponent < 0) {
+            return numberDivide(ValuePtr::fromFixnum(1), numberExpt(a, numberNegate(b)));
+        }
+        auto result = ValuePtr::fromFixnum(1);
+        for (auto base = a;; base = numberMul(base, base)) {
+            if (exponent & 1) {
+                result = numberMul(result, base);
+            }
+            if ((exponent >>= 1) == 0) {
+                return result;
+            }
+        }
+    }
+    return ValuePtr::fromNumber(std::pow(a.asNumber(), b.asNumber()));
+}
+
+bool numberIsZero(ValuePtr a) {
+    // Bignums are never zero.
+    return a.isFixnum() ? a.asFixnum() == 0 : a.isFlonum() && a.asFlonum() == 0;
+}
+
+bool numberIsEven(ValuePtr a) {
+    if (a.isFixnum()) {
+        return (a.asFixnum() & 1) == 0;
+    } else if (a.isBignum()) {
+        auto word = a.toInt64();
+        return word ? (*word & 1) == 0 : !a.toBigInt().isOdd();
+    }
+    return std::fmod(a.asFlonum(), 2) == 0;
+}
+
+namespace {
+
+bool isDigit(char c, int radix) {
+    return (c >= '0' && c <= '9') ||
+           (radix == 16 && ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')));
+}
+
+int digitValue(char c) {
+    return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+// Whether a decimal flonum literal that from_chars found out of range is too
+// large, rather than too small, for a double: the power of ten of its first
+// nonzero digit is at least 308 then, and below -323 otherwise.
+bool overflows(std::string_view magnitude) {
+    auto exponentStart = magnitude.find_first_of("eE");
+    auto mantissa = magnitude.substr(0, exponentStart);
+    auto point = std::min(mantissa.find('.'), mantissa.size());
+    auto first = mantissa.find_first_not_of("0.");
+    if (first == std::string_view::npos) {
+        return false;
+    }
+    std::int64_t power = first < point ? static_cast<std::int64_t>(point - first) - 1
+                                       : -static_cast<std::int64_t>(first - point);
+    if (exponentStart != std::string_view::npos) {
+        auto exponent = magnitude.substr(exponentStart + 1);
+        auto negative = exponent[0] == '-';
+        std::int64_t value = 0;
+        for (auto c : exponent.substr(exponent[0] == '-' || exponent[0] == '+')) {
+            // Saturates well past any power a double can reach.
+            value = std::min<std::int64_t>(value * 10 + (c - '0'), 1'000'000'000);
+        }
+        power += negative ? -value : value;
+    }
+    return power > 0;
+}
+
+}  // namespace
+
+std::optional<NumericLiteral> parseNumericLiteral(std::string_view text) {
+    int radix = 10;
+    if (text.size() > 2 && text[0] == '#' && (text[1] == 'x' || text[1] == 'X')) {
+        radix = 16;
+        text.remove_prefix(2);
+    }
+    auto negative = !text.empty() && text[0] == '-';
+    auto magnitude = text.substr(!text.empty() && (text[0] == '-' || text[0] == '+'));
+    if (magnitude.empty()) {
+        return std::nullopt;
+    }
+    if (std::all_of(magnitude.begin(), magnitude.end(),
+                    [&](char c) { return isDigit(c, radix); })) {
+        return NumericLiteral{text, radix};
+    }
+    // from_chars would also read "inf" and "nan", which are symbols here.
+    if (radix != 10 || !(isDigit(magnitude[0], 10) || magnitude[0] == '.')) {
+        return std::nullopt;
+    }
+    double value;
+    auto end = magnitude.data() + magnitude.size();
+    auto [last, error] = std::from_chars(magnitude.data(), end, value);
+    if (last != end) {
+        return std::nullopt;
+    }
+    if (error == std::errc::result_out_of_range) {
+        // from_chars gives no value then; subnormals are in range, so the
+        // value rounds to infinity or to zero.
+        value = overflows(magnitude) ? HUGE_VAL : 0.0;
+    }
+    return NumericLiteral{{}, 10, negative ? -value : value};
+}
+
+std::optional<ValuePtr> parseNumber(std::string_view text) {
+    if (auto literal = parseNumericLiteral(text)) {
+        return literal->toValue();
+    }
+    return std::nullopt;
+}
+
+ValuePtr parseInteger(std::string_view text, int radix) {
+    // Up to 14 decimal or 11 hex digits always fit in a fixnum.
+    auto digits = text.substr(text[0] == '-' || text[0] == '+');
+    if (digits.size() <= (radix == 16 ? 11u : 14u)) {
+        std::int64_t value = 0;
+        for (auto c : digits) {
+            value = value * radix + digitValue(c);
+        }
+        return ValuePtr::fromFixnum(text[0] == '-' ? -value : value);
+    }
+    return ValuePtr::fromBigInt(BigInt::parse(text, radix));
+}
@@ -0,0 +1,123 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+#include <compare>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+
+#include "./value.h"
+
+// Arithmetic on numbers, which are exact integers (fixnums or bignums) or
+// flonums; see ValuePtr. Exact operands give an exact result, which becomes a
+// bignum rather than overflowing; a flonum operand makes the result a flonum.
+// Operands must be numbers.
+//
+// The all-fixnum and all-flonum cases are inline, so that integer loops stay
+// in integer registers; everything else is in number.cpp.
+
+namespace detail {
+
+ValuePtr addSlow(ValuePtr a, ValuePtr b);
+ValuePtr subSlow(ValuePtr a, ValuePtr b);
+ValuePtr mulSlow(ValuePtr a, ValuePtr b);
+std::partial_ordering compareSlow(ValuePtr a, ValuePtr b);
+
+// Stores x * y in `product` unless that overflows.
+inline bool multiplyOverflows(std::int64_t x, std::int64_t y, std::int64_t& product) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(x, y, &product);
+#else
+    // Only used on fixnums, whose magnitudes are far from overflowing abs().
+    if (x != 0 && std::abs(y) > INT64_MAX / std::abs(x)) {
+        return true;
+    }
+    product = x * y;
+    return false;
+#endif
+}
+
+}  // namespace detail
+
+inline ValuePtr numberAdd(ValuePtr a, ValuePtr b) {
+    if (a.isFixnum() && b.isFixnum()) {
+        // Fixnums are 48-bit, so their sum fits in 64.
+        return ValuePtr::fromInteger(a.asFixnum() + b.asFixnum());
+    } else if (a.isFlonum() && b.isFlonum()) {
+        return ValuePtr::fromNumber(a.asFlonum() + b.asFlonum());
+    }
+    return detail::addSlow(a, b);
+}
+
+inline ValuePtr numberSub(ValuePtr a, ValuePtr b) {
+    if (a.isFixnum() && b.isFixnum()) {
+        return ValuePtr::fromInteger(a.asFixnum() - b.asFixnum());
+    } else if (a.isFlonum() && b.isFlonum()) {
+        return ValuePtr::fromNumber(a.asFlonum() - b.asFlonum());
+    }
+    return detail::subSlow(a, b);
+}
+
+inline ValuePtr numberMul(ValuePtr a, ValuePtr b) {
+    if (std::int64_t product; a.isFixnum() && b.isFixnum() &&
+                              !detail::multiplyOverflows(a.asFixnum(), b.asFixnum(), product)) {
+        return ValuePtr::fromInteger(product);
+    } else if (a.isFlonum() && b.isFlonum()) {
+        return ValuePtr::fromNumber(a.asFlonum() * b.asFlonum());
+    }
+    return detail::mulSlow(a, b);
+}
+
+// Unordered if either is NaN, so that every comparison with NaN is false.
+inline std::partial_ordering numberCompare(ValuePtr a, ValuePtr b) {
+    if (a.isFixnum() && b.isFixnum()) {
+        return a.asFixnum() <=> b.asFixnum();
+    } else if (a.isFlonum() && b.isFlonum()) {
+        return a.asFlonum() <=> b.asFlonum();
+    }
+    return detail::compareSlow(a, b);
+}
+
+ValuePtr numberNegate(ValuePtr a);
+ValuePtr numberAbs(ValuePtr a);
+// Exact if both are exact and `b` divides `a`, a flonum otherwise.
+ValuePtr numberDivide(ValuePtr a, ValuePtr b);
+// Division rounding toward zero, its remainder, which has the sign of `a`,
+// and the modulo, which has the sign of `b`. These throw on a zero divisor.
+ValuePtr numberQuotient(ValuePtr a, ValuePtr b);
+ValuePtr numberRemainder(ValuePtr a, ValuePtr b);
+ValuePtr numberModulo(ValuePtr a, ValuePtr b);
+// Exact if `a` is exact and `b` is an exact non-negative integer.
+ValuePtr numberExpt(ValuePtr a, ValuePtr b);
+bool numberIsZero(ValuePtr a);
+// Whether `a` is a multiple of 2, exact or not.
+bool numberIsEven(ValuePtr a);
+
+// An exact integer from optionally signed digits in `radix`, 10 or 16.
+ValuePtr parseInteger(std::string_view text, int radix = 10);
+
+// What a numeric literal denotes, as found without allocating or throwing.
+struct NumericLiteral {
+    // The optionally signed digits of an exact integer, which the literal
+    // holds; empty for a flonum.
+    std::string_view digits;
+    int radix{10};
+    double value{};
+
+    bool isExact() const {
+        return !digits.empty();
+    }
+    ValuePtr toValue() const {
+        return isExact() ? parseInteger(digits, radix) : ValuePtr::fromNumber(value);
+    }
+};
+
+// A numeric literal in the syntax of the reader: an exact integer of
+// optionally signed decimal digits, or hex digits after #x, or a flonum with a
+// decimal point, an exponent or both, rounded to the nearest double. Empty if
+// `text` is none of these.
+std::optional<NumericLiteral> parseNumericLiteral(std::string_view text);
+std::optional<ValuePtr> parseNumber(std::string_view text);
+
+#endif
@@ -1,13 +1,21 @@
 #include "./reader.h"
 
 #include "./error.h"
+#include "./number.h"
 
-void Reader::checkEmpty() {
+bool Reader::fill() {
     while (tokens.empty()) {
         if (!eofHandler || !eofHandler(topLevel)) {
-            throw EOFError();
+            return false;
         }
     }
+    return true;
+}
+
+void Reader::checkEmpty() {
+    if (!fill()) {
+        throw EOFError();
+    }
 }
 
 const Token* Reader::peek() {
@@ -22,44 +30,46 @@ TokenPtr Reader::pop() {
     return top;
 }
 
-std::unique_ptr<Value> Reader::readValue() {
+ValuePtr Reader::readValue() {
     auto token = pop();
     topLevel = false;
     if (token->getType() == TokenType::LEFT_PAREN) {
         auto next = peek();
         return readTails();
+    } else if (token->getType() == TokenType::VECTOR_PAREN) {
+        return readVector();
     } else if (auto quoteName = token->getQuoteName()) {
-        return std::make_unique<PairValue>(
-            std::make_unique<IdentifierValue>(*quoteName),
-            std::make_unique<PairValue>(read(), std::make_unique<NilValue>()));
+        return makeValue<PairValue>(IdentifierValue::intern(*quoteName),
+                                    makeValue<PairValue>(read(), Value::nil()));
     } else if (token->getType() == TokenType::NUMERIC_LITERAL) {
-        auto value = static_cast<NumericLiteralToken&>(*token).getValue();
-        return std::make_unique<NumberValue>(value);
+        auto& literal = static_cast<NumericLiteralToken&>(*token);
+        return literal.isExact() ? parseInteger(literal.getDigits(), literal.getRadix())
+                                 : Value::fromNumber(literal.getValue());
     } else if (token->getType() == TokenType::BOOLEAN_LITERAL) {
         auto value = static_cast<BooleanLiteralToken&>(*token).getValue();
-        return std::make_unique<BooleanValue>(value);
+        return Value::fromBoolean(value);
     } else if (token->getType() == TokenType::STRING_LITERAL) {
         auto value = static_cast<StringLiteralToken&>(*token).getValue();
-        return std::make_unique<StringValue>(value);
+        return makeValue<StringValue>(value);
     } else if (token->getType() == TokenType::IDENTIFIER) {
         auto name = static_cast<IdentifierToken&>(*token).getName();
-        return std::make_unique<IdentifierValue>(name);
+        return IdentifierValue::intern(name);
     } else {
         throw SyntaxError("Unexpected token " + token->toString());
     }
 }
 
-std::unique_ptr<Value> Reader::readTails() {
+ValuePtr Reader::readTails() {
     if (peek()->getType() == TokenType::RIGHT_PAREN) {
         tokens.pop_front();
-        return std::make_unique<NilValue>();
+        return Value::nil();
     }
     auto car = readValue();
-    std::unique_ptr<Value> cdr;
+    ValuePtr cdr;
     if (peek()->getType() == TokenType::DOT) {
         tokens.pop_front();
         cdr = readValue();
-        if (tokens.empty()) {
+        if (!fill()) {
             throw SyntaxError("Unexpected EOF; expect an element after .");
         }
         auto token = pop();
@@ -69,10 +79,19 @@ std::unique_ptr<Value> Reader::readTails() {
     } else {
         cdr = readTails();
     }
-    return std::make_unique<PairValue>(std::move(car), std::move(cdr));
+    return makeValue<PairValue>(std::move(car), std::move(cdr));
+}
+
+ValuePtr Reader::readVector() {
+    ValueVector elements;
+    while (peek()->getType() != TokenType::RIGHT_PAREN) {
+        elements.push_back(readValue());
+    }
+    tokens.pop_front();
+    return makeValue<VectorValue>(elements);
 }
 
-std::unique_ptr<Value> Reader::read() {
+ValuePtr Reader::read() {
     topLevel = true;
     return readValue();
 }
\ No newline at end of file
@@ -15,17 +15,20 @@ private:
     std::function<EofHandler> eofHandler;
     bool topLevel{true};
 
+    // Whether there is a token, asking eofHandler for more if there is none.
+    bool fill();
     void checkEmpty();
     const Token* peek();
     TokenPtr pop();
-    std::unique_ptr<Value> readValue();
-    std::unique_ptr<Value> readTails();
+    ValuePtr readValue();
+    ValuePtr readTails();
+    ValuePtr readVector();
 
 public:
     Reader(std::deque<TokenPtr>& tokenSrc, std::function<EofHandler> eofHandler = {})
         : tokens{tokenSrc}, eofHandler{std::move(eofHandler)} {}
 
-    std::unique_ptr<Value> read();
+    ValuePtr read();
 };
 
 #endif
\ No newline at end of file
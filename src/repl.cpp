@@ -1,15 +1,24 @@
 #include "./repl.h"
 
 #include <algorithm>
-#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
 #include <iterator>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include "./bytecode.h"
+#include "./compiler.h"
 #include "./error.h"
 #include "./eval_env.h"
+#include "./gc.h"
+#include "./image.h"
+#include "./lexer.h"
 #include "./reader.h"
+#include "./source_file.h"
 #include "./tokenizer.h"
 
 namespace rg = std::ranges;
@@ -27,10 +36,11 @@ void readEvalPrintLoop() {
         return true;
     });
     auto env = EvaluateEnv::createGlobal();
+    GcRoot envRoot(env);
     while (true) {
         try {
             auto result = env->eval(reader.read());
-            result->print();
+            result.print();
         } catch (EOFError&) {
             break;
         } catch (std::runtime_error& e) {
@@ -40,26 +50,106 @@ void readEvalPrintLoop() {
     }
 }
 
-void loadFile(const char* filename) {
-    std::ifstream file(filename);
-    if (!file) {
-        std::cerr << "Error: Cannot open file " << filename << std::endl;
+namespace {
+
+SourceFile openFile(const char* filename) {
+    try {
+        return SourceFile(filename);
+    } catch (std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
         std::exit(1);
     }
-    std::string line;
-    std::deque<TokenPtr> tokens;
-    while (std::getline(file, line)) {
-        rg::move(Tokenizer::tokenize(line), std::back_inserter(tokens));
+}
+
+// Calls `read` with the tokens of the file, or of standard input for "-", as a
+// stream; see TokenStream.
+template <typename F>
+void withTokenStream(const char* filename, F read) {
+    if (std::strcmp(filename, "-") == 0) {
+        TokenStream stream(std::cin);
+        read(stream);
+    } else {
+        auto file = openFile(filename);
+        TokenStream stream(file.getText());
+        read(stream);
     }
-    auto env = EvaluateEnv::createGlobal();
-    Reader reader(tokens);
-    try {
-        while (true) {
-            env->eval(reader.read());
+}
+
+// Hands `tokens` one token of `stream` at a time, so that a Reader never
+// holds more than the form it is reading.
+std::function<EofHandler> feed(TokenStream& stream, std::deque<TokenPtr>& tokens) {
+    return [&stream, &tokens](bool) {
+        auto token = stream.next();
+        if (!token) {
+            return false;
         }
-    } catch (EOFError&) {
-    } catch (std::runtime_error& e) {
-        std::cerr << "Error: " << e.what() << std::endl;
-        tokens.clear();
+        tokens.push_back(std::move(token));
+        return true;
+    };
+}
+
+}  // namespace
+
+void loadFile(const char* filename) {
+    withTokenStream(filename, [](TokenStream& stream) {
+        auto env = EvaluateEnv::createGlobal();
+        GcRoot envRoot(env);
+        std::deque<TokenPtr> tokens;
+        Reader reader(tokens, feed(stream, tokens));
+        try {
+            while (true) {
+                env->eval(reader.read());
+            }
+        } catch (EOFError&) {
+        } catch (std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    });
+}
+
+void disassembleFile(const char* filename) {
+    withTokenStream(filename, [](TokenStream& stream) {
+        auto env = EvaluateEnv::createGlobal();
+        GcRoot envRoot(env);
+        std::deque<TokenPtr> tokens;
+        Reader reader(tokens, feed(stream, tokens));
+        try {
+            while (true) {
+                Compiler compiler(*env);
+                compiler.compileTopLevel(reader.read())->disassemble(std::cout);
+                std::cout << std::endl;
+            }
+        } catch (EOFError&) {
+        } catch (std::runtime_error& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+    });
+}
+
+void compileImage(const char* filename, const char* output) {
+    ImageWriter writer;
+    withTokenStream(filename, [&writer](TokenStream& stream) {
+        // As for mini_lisp_aot, the forms are compiled with the stock builtins,
+        // and the guards of folded calls catch the forms that redefine them.
+        auto env = EvaluateEnv::createGlobal();
+        GcRoot envRoot(env);
+        std::vector<Prototype*, GcRootAllocator<Prototype*>> forms;
+        std::deque<TokenPtr> tokens;
+        Reader reader(tokens, feed(stream, tokens));
+        try {
+            while (true) {
+                Compiler compiler(*env);
+                forms.push_back(compiler.compileTopLevel(reader.read()));
+                writer.addForm(forms.back());
+            }
+        } catch (EOFError&) {
+        } catch (std::runtime_error& e) {
+            // Reported when the image gets there.
+            writer.addError(e.what());
+        }
+    });
+    if (!writer.write(output)) {
+        std::cerr << "Error: Cannot write " << output << std::endl;
+        std::exit(1);
     }
-}
\ No newline at end of file
+}
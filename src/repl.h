@@ -2,6 +2,13 @@
 #define REPL_H
 
 void readEvalPrintLoop();
+// Runs each top-level form of the file, or of standard input for "-", as soon
+// as it is read.
 void loadFile(const char* filename);
+// Prints the bytecode of every top-level form in the file without running it.
+void disassembleFile(const char* filename);
+// Compiles every top-level form in the file without running it, and writes
+// them as an image for runImage.
+void compileImage(const char* filename, const char* output);
 
 #endif
\ No newline at end of file
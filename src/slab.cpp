@@ -0,0 +1,118 @@
+#include "./slab.h"
+
+#include <new>
+#include <unordered_set>
+
+namespace {
+
+struct FreeNode {
+    FreeNode* next;
+};
+
+struct SizeClass {
+    FreeNode* freeList{nullptr};
+    char* bump{nullptr};
+    char* bumpEnd{nullptr};
+    SlabAllocator::ClassStats stats{};
+};
+
+}  // namespace
+
+// The free lists are constant-initialized so that the hot paths reach them
+// without going through a thread-local initialization guard.
+struct SlabPool {
+    std::array<SizeClass, SlabAllocator::CLASS_COUNT> classes;
+};
+
+struct SlabChunks {
+    std::vector<SlabAllocator::Chunk*> chunks;
+    std::unordered_set<const void*> chunkSet;
+};
+
+namespace {
+
+constinit thread_local SlabPool pool;
+thread_local SlabChunks chunkRegistry;
+
+}  // namespace
+
+void* SlabAllocator::allocate(std::size_t size) {
+    if (size > MAX_SIZE) {
+        return ::operator new(size);
+    }
+    auto& sizeClass = pool.classes[classOf(size)];
+    auto objectSize = (classOf(size) + 1) * GRANULE;
+    char* result;
+    if (auto node = sizeClass.freeList) {
+        sizeClass.freeList = node->next;
+        result = reinterpret_cast<char*>(node);
+    } else {
+        if (sizeClass.bump == sizeClass.bumpEnd) {
+            auto memory = ::operator new(CHUNK_SIZE, std::align_val_t{CHUNK_SIZE});
+            auto chunk = new (memory) Chunk{};
+            chunk->objectSize = objectSize;
+            chunk->slots = (CHUNK_SIZE - HEADER_SIZE) / objectSize;
+            chunkRegistry.chunks.push_back(chunk);
+            chunkRegistry.chunkSet.insert(chunk);
+            sizeClass.bump = chunk->objects();
+            sizeClass.bumpEnd = sizeClass.bump + chunk->slots * objectSize;
+            sizeClass.stats.reservedBytes += CHUNK_SIZE;
+        }
+        result = sizeClass.bump;
+        sizeClass.bump += objectSize;
+    }
+    auto chunk = reinterpret_cast<Chunk*>(reinterpret_cast<std::uintptr_t>(result) &
+                                          ~(CHUNK_SIZE - 1));
+    auto index = (result - chunk->objects()) / objectSize;
+    chunk->allocated[index / 64] |= std::uint64_t{1} << (index % 64);
+    sizeClass.stats.allocatedObjects++;
+    sizeClass.stats.allocatedBytes += objectSize;
+    sizeClass.stats.liveObjects++;
+    return result;
+}
+
+void SlabAllocator::deallocate(void* ptr, std::size_t size) {
+    if (size > MAX_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+    auto& sizeClass = pool.classes[classOf(size)];
+    auto chunk =
+        reinterpret_cast<Chunk*>(reinterpret_cast<std::uintptr_t>(ptr) & ~(CHUNK_SIZE - 1));
+    auto index = (static_cast<char*>(ptr) - chunk->objects()) / chunk->objectSize;
+    chunk->allocated[index / 64] &= ~(std::uint64_t{1} << (index % 64));
+    auto node = static_cast<FreeNode*>(ptr);
+    node->next = sizeClass.freeList;
+    sizeClass.freeList = node;
+    sizeClass.stats.liveObjects--;
+}
+
+void* SlabAllocator::findObject(const void* address) {
+    auto raw = reinterpret_cast<std::uintptr_t>(address);
+    auto chunk = reinterpret_cast<Chunk*>(raw & ~(CHUNK_SIZE - 1));
+    if (!chunkRegistry.chunkSet.contains(chunk)) {
+        return nullptr;
+    }
+    auto begin = reinterpret_cast<std::uintptr_t>(chunk->objects());
+    if (raw < begin) {
+        return nullptr;
+    }
+    auto index = (raw - begin) / chunk->objectSize;
+    if (index >= chunk->slots || !(chunk->allocated[index / 64] >> (index % 64) & 1)) {
+        return nullptr;
+    }
+    return chunk->objects() + index * chunk->objectSize;
+}
+
+const std::vector<SlabAllocator::Chunk*>& SlabAllocator::chunks() {
+    return chunkRegistry.chunks;
+}
+
+SlabAllocator::Stats SlabAllocator::stats() {
+    Stats result;
+    for (std::size_t i = 0; i < CLASS_COUNT; i++) {
+        result[i] = pool.classes[i].stats;
+        result[i].objectSize = (i + 1) * GRANULE;
+    }
+    return result;
+}
@@ -0,0 +1,78 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Size-class slab allocator for small, fixed-size heap objects. Requests are
+// rounded up to a multiple of GRANULE; each size class carves its objects out
+// of CHUNK_SIZE-aligned chunks and recycles them through a thread-local free
+// list. Every chunk keeps a bitmap of its allocated slots so that an arbitrary
+// address can be mapped back to the object containing it. Chunks are never
+// returned to the system.
+class SlabAllocator {
+public:
+    static constexpr std::size_t GRANULE{16};
+    static constexpr std::size_t MAX_SIZE{256};
+    static constexpr std::size_t CLASS_COUNT{MAX_SIZE / GRANULE};
+    static constexpr std::size_t CHUNK_SIZE{64 * 1024};
+
+    struct ClassStats {
+        std::size_t objectSize;
+        std::uint64_t allocatedObjects;
+        std::uint64_t allocatedBytes;
+        std::uint64_t liveObjects;
+        std::uint64_t reservedBytes;
+    };
+    using Stats = std::array<ClassStats, CLASS_COUNT>;
+
+    static void* allocate(std::size_t size);
+    static void deallocate(void* ptr, std::size_t size);
+
+    // The start of the allocated object containing `address`, if any.
+    static void* findObject(const void* address);
+    // Calls `visit(object, size)` on every object allocated by this thread.
+    // `visit` may deallocate the object it is given.
+    template <typename F>
+    static void forEachObject(F&& visit);
+
+    // Counters of the calling thread since it started.
+    static Stats stats();
+
+private:
+    friend struct SlabChunks;
+
+    struct Chunk {
+        std::uint32_t objectSize;
+        std::uint32_t slots;
+        std::uint64_t allocated[CHUNK_SIZE / GRANULE / 64];
+
+        char* objects() {
+            return reinterpret_cast<char*>(this) + HEADER_SIZE;
+        }
+    };
+    static constexpr std::size_t HEADER_SIZE{(sizeof(Chunk) + GRANULE - 1) / GRANULE * GRANULE};
+
+    static const std::vector<Chunk*>& chunks();
+
+    static std::size_t classOf(std::size_t size) {
+        return (size + GRANULE - 1) / GRANULE - 1;
+    }
+};
+
+template <typename F>
+void SlabAllocator::forEachObject(F&& visit) {
+    for (auto chunk : chunks()) {
+        for (std::size_t word = 0; word * 64 < chunk->slots; word++) {
+            for (auto bits = chunk->allocated[word]; bits != 0; bits &= bits - 1) {
+                auto index = word * 64 + std::countr_zero(bits);
+                visit(chunk->objects() + index * chunk->objectSize, std::size_t{chunk->objectSize});
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "./source_file.h"
+
+#include <fstream>
+#include <iterator>
+
+#include "./error.h"
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCE_FILE_MMAP
+#endif
+
+SourceFile::SourceFile(const char* filename) {
+#ifdef SOURCE_FILE_MMAP
+    // Only regular files of some length can be mapped; the others, such as
+    // pipes, are read below.
+    if (auto fd = open(filename, O_RDONLY); fd >= 0) {
+        struct stat status;
+        if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+            auto size = static_cast<std::size_t>(status.st_size);
+            auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, size, MADV_SEQUENTIAL);
+                close(fd);
+                text = std::string_view(static_cast<const char*>(data), size);
+                mapped = true;
+                return;
+            }
+        }
+        close(fd);
+    }
+#endif
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw LispError(std::string("Cannot open file ") + filename);
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    text = contents;
+}
+
+SourceFile::~SourceFile() {
+#ifdef SOURCE_FILE_MMAP
+    if (mapped) {
+        munmap(const_cast<char*>(text.data()), text.size());
+    }
+#endif
+}
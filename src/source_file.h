@@ -0,0 +1,30 @@
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// The contents of a file, mapped into memory where the platform supports it so
+// that large files are neither copied nor read in full before they are used,
+// and read into a string otherwise.
+class SourceFile {
+private:
+    std::string_view text;
+    // Whether `text` is a mapping to unmap, rather than a view of `contents`.
+    bool mapped{false};
+    std::string contents;
+
+public:
+    // Throws a LispError if the file cannot be read.
+    explicit SourceFile(const char* filename);
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+    ~SourceFile();
+
+    std::string_view getText() const {
+        return text;
+    }
+};
+
+#endif
@@ -23,6 +23,10 @@ TokenPtr Token::dot() {
     return TokenPtr(new Token(TokenType::DOT));
 }
 
+TokenPtr Token::vectorParen() {
+    return TokenPtr(new Token(TokenType::VECTOR_PAREN));
+}
+
 std::optional<std::string> Token::getQuoteName() const {
     switch (type) {
         case TokenType::QUOTE: return "quote";
@@ -36,6 +40,7 @@ std::string Token::toString() const {
     switch (type) {
         case TokenType::LEFT_PAREN: return "(LEFT_PAREN)"; break;
         case TokenType::RIGHT_PAREN: return "(RIGHT_PAREN)"; break;
+        case TokenType::VECTOR_PAREN: return "(VECTOR_PAREN)"; break;
         case TokenType::QUOTE: return "(QUOTE)"; break;
         case TokenType::QUASIQUOTE: return "(QUASIQUOTE)"; break;
         case TokenType::UNQUOTE: return "(UNQUOTE)"; break;
@@ -69,7 +74,10 @@ std::string BooleanLiteralToken::toString() const {
 }
 
 std::string NumericLiteralToken::toString() const {
-    return "(NUMERIC_LITERAL " + std::to_string(value) + ")";
+    if (!isExact()) {
+        return "(NUMERIC_LITERAL " + std::to_string(value) + ")";
+    }
+    return "(NUMERIC_LITERAL " + (radix == 16 ? "#x" + digits : digits) + ")";
 }
 
 std::string StringLiteralToken::toString() const {
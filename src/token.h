@@ -1,14 +1,16 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <ostream>
 #include <string>
 
-enum class TokenType {
+enum class TokenType : std::uint8_t {
     LEFT_PAREN,
     RIGHT_PAREN,
+    VECTOR_PAREN,
     QUOTE,
     QUASIQUOTE,
     UNQUOTE,
@@ -34,6 +36,8 @@ public:
 
     static TokenPtr fromChar(char c);
     static TokenPtr dot();
+    // The `#(` that opens a vector literal.
+    static TokenPtr vectorParen();
 
     TokenType getType() const {
         return type;
@@ -60,14 +64,29 @@ public:
 
 class NumericLiteralToken : public Token {
 private:
-    double value;
+    double value{};
+    // The optionally signed digits of an exact integer in `radix`, which
+    // `value` may not hold; empty for flonums.
+    std::string digits;
+    int radix{10};
 
 public:
     NumericLiteralToken(double value) : Token(TokenType::NUMERIC_LITERAL), value{value} {}
+    explicit NumericLiteralToken(std::string digits, int radix = 10)
+        : Token(TokenType::NUMERIC_LITERAL), digits{std::move(digits)}, radix{radix} {}
 
+    bool isExact() const {
+        return !digits.empty();
+    }
     double getValue() const {
         return value;
     }
+    const std::string& getDigits() const {
+        return digits;
+    }
+    int getRadix() const {
+        return radix;
+    }
     std::string toString() const override;
 };
 
@@ -1,27 +1,27 @@
 #include "./tokenizer.h"
 
-#include <cctype>
-#include <set>
-#include <stdexcept>
-
+#include "./char_class.h"
 #include "./error.h"
-
-const std::set<char> TOKEN_END{'(', ')', '\'', '`', ',', '"'};
+#include "./number.h"
 
 TokenPtr Tokenizer::nextToken(int& pos) {
-    while (pos < input.size()) {
+    auto& kernels = ScanKernels::get();
+    auto text = input.data();
+    auto size = input.size();
+    while (pos < size) {
         auto c = input[pos];
         if (c == ';') {
-            while (pos < input.size() && input[pos] != '\n') {
-                pos++;
-            }
-        } else if (std::isspace(c)) {
-            pos++;
+            pos = kernels.findNewline(text, size, pos);
+        } else if (isSpace(c)) {
+            pos = kernels.skipSpace(text, size, pos + 1);
         } else if (auto token = Token::fromChar(c)) {
             pos++;
             return token;
-        } else if (c == '#') {
-            if (auto result = BooleanLiteralToken::fromChar(input[pos + 1])) {
+        } else if (c == '#' && !isRadixPrefix(input, pos)) {
+            if (input[pos + 1] == '(') {
+                pos += 2;
+                return Token::vectorParen();
+            } else if (auto result = BooleanLiteralToken::fromChar(input[pos + 1])) {
                 pos += 2;
                 return result;
             } else {
@@ -30,49 +30,66 @@ TokenPtr Tokenizer::nextToken(int& pos) {
         } else if (c == '"') {
             std::string string;
             pos++;
-            while (pos < input.size()) {
-                if (input[pos] == '"') {
+            while (pos < size) {
+                auto run = kernels.findStringEnd(text, size, pos);
+                string.append(text + pos, run - pos);
+                pos = run;
+                if (pos == size) {
+                    break;
+                } else if (input[pos] == '"') {
                     pos++;
                     return std::make_unique<StringLiteralToken>(string);
-                } else if (input[pos] == '\\') {
-                    if (pos + 1 >= input.size()) {
-                        throw SyntaxError("Unexpected end of string literal");
-                    }
-                    auto next = input[pos + 1];
-                    if (next == 'n') {
-                        string += '\n';
-                    } else {
-                        string += next;
-                    }
-                    pos += 2;
+                } else if (pos + 1 >= size) {
+                    break;
+                }
+                auto next = input[pos + 1];
+                if (next == 'n') {
+                    string += '\n';
                 } else {
-                    string += input[pos];
-                    pos++;
+                    string += next;
                 }
+                pos += 2;
             }
             throw SyntaxError("Unexpected end of string literal");
         } else {
             int start = pos;
-            do {
-                pos++;
-            } while (pos < input.size() && !std::isspace(input[pos]) &&
-                     !TOKEN_END.contains(input[pos]));
-            auto text = input.substr(start, pos - start);
-            if (text == ".") {
-                return Token::dot();
-            }
-            if (std::isdigit(text[0]) || text[0] == '+' || text[0] == '-' || text[0] == '.') {
-                try {
-                    return std::make_unique<NumericLiteralToken>(std::stod(text));
-                } catch (std::invalid_argument& e) {
-                }
-            }
-            return std::make_unique<IdentifierToken>(text);
+            pos = kernels.findDelimiter(text, size, pos + 1);
+            return atomToken(std::string_view(input).substr(start, pos - start));
         }
     }
     return nullptr;
 }
 
+bool Tokenizer::isRadixPrefix(std::string_view text, std::size_t pos) {
+    return pos + 1 < text.size() && (text[pos + 1] == 'x' || text[pos + 1] == 'X');
+}
+
+TokenType Tokenizer::classifyAtom(std::string_view text) {
+    if (text == ".") {
+        return TokenType::DOT;
+    } else if (parseNumericLiteral(text)) {
+        return TokenType::NUMERIC_LITERAL;
+    } else if (text[0] == '#') {
+        throw SyntaxError("Malformed number " + std::string(text));
+    }
+    return TokenType::IDENTIFIER;
+}
+
+TokenPtr Tokenizer::atomToken(std::string_view text) {
+    if (text == ".") {
+        return Token::dot();
+    } else if (auto literal = parseNumericLiteral(text)) {
+        if (literal->isExact()) {
+            return std::make_unique<NumericLiteralToken>(std::string(literal->digits),
+                                                         literal->radix);
+        }
+        return std::make_unique<NumericLiteralToken>(literal->value);
+    } else if (text[0] == '#') {
+        throw SyntaxError("Malformed number " + std::string(text));
+    }
+    return std::make_unique<IdentifierToken>(std::string(text));
+}
+
 std::deque<TokenPtr> Tokenizer::tokenize() {
     std::deque<TokenPtr> tokens;
     int pos = 0;
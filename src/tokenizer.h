@@ -3,6 +3,7 @@
 
 #include <deque>
 #include <string>
+#include <string_view>
 
 #include "./token.h"
 
@@ -16,6 +17,14 @@ private:
 
 public:
     static std::deque<TokenPtr> tokenize(const std::string& input);
+
+    // What an atom, a run of characters up to a delimiter, reads as: DOT,
+    // NUMERIC_LITERAL or IDENTIFIER. These throw a SyntaxError for a #x atom
+    // that is not a number.
+    static TokenType classifyAtom(std::string_view text);
+    static TokenPtr atomToken(std::string_view text);
+    // Whether the `#` at `pos` starts a #x number, which is read as an atom.
+    static bool isRadixPrefix(std::string_view text, std::size_t pos);
 };
 
 #endif
\ No newline at end of file
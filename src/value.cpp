@@ -1,99 +1,56 @@
 #include "./value.h"
 
 #include <cmath>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <unordered_map>
 
+#include "./bytecode.h"
 #include "./error.h"
 #include "./eval_env.h"
+#include "./vm.h"
 
-bool Value::isSymbol() const {
-    return typeid(*this) == typeid(IdentifierValue);
-}
-
-bool Value::isNil() const {
-    return typeid(*this) == typeid(NilValue);
-}
-
-bool Value::isBoolean() const {
-    return typeid(*this) == typeid(BooleanValue);
-}
-
-bool Value::isString() const {
-    return typeid(*this) == typeid(StringValue);
-}
-
-bool Value::isNumber() const {
-    return typeid(*this) == typeid(NumberValue);
-}
-
-bool Value::isPair() const {
-    return typeid(*this) == typeid(PairValue);
-}
-
-bool Value::isAtom() const {
-    return isNil() || isSymbol() || isBoolean() || isNumber() || isString();
-}
-
-bool Value::isSelfEvaluating() const {
-    return isBoolean() || isNumber() || isString();
-}
-
-bool Value::isProcedure() const {
-    return typeid(*this) == typeid(BuiltinProcValue) || typeid(*this) == typeid(LambdaValue);
-}
-
-bool Value::isList() const {
+bool ValuePtr::isList() const {
     auto current = this;
     while (!current->isNil()) {
         if (!current->isPair()) {
             return false;
         }
-        auto pair = static_cast<const PairValue*>(current);
-        current = pair->getCdr().get();
+        auto pair = static_cast<const PairValue*>(current->get());
+        current = &pair->getCdr();
     }
     return true;
 }
 
-bool Value::isTrue() const {
-    if (!isBoolean()) return true;
-    auto boolean = static_cast<const BooleanValue*>(this);
-    return boolean->getValue();
-}
-
-const std::string* Value::getSymbolName() const {
+std::optional<SymbolId> ValuePtr::getSymbolId() const {
     if (isSymbol()) {
-        auto symbol = static_cast<const IdentifierValue*>(this);
-        return &symbol->getName();
+        return static_cast<const IdentifierValue*>(get())->getId();
     } else {
-        return nullptr;
+        return std::nullopt;
     }
 }
 
-bool Value::asBool() const {
-    return static_cast<const BooleanValue*>(this)->getValue();
-}
-
-double Value::asNumber() const {
-    return static_cast<const NumberValue*>(this)->getValue();
+std::string_view ValuePtr::asString() const {
+    return static_cast<const StringValue*>(get())->getValue();
 }
 
-const std::string& Value::asString() const {
-    return static_cast<const StringValue*>(this)->getValue();
+const PairValue& ValuePtr::asPair() const {
+    return static_cast<const PairValue&>(*get());
 }
 
-const PairValue& Value::asPair() const {
-    return static_cast<const PairValue&>(*this);
+const VectorValue& ValuePtr::asVector() const {
+    return static_cast<const VectorValue&>(*get());
 }
 
-std::vector<ValuePtr> Value::toVector() const {
-    std::vector<ValuePtr> result;
+ValueVector ValuePtr::toVector() const {
+    ValueVector result;
     auto current = this;
     while (current->isPair()) {
-        auto&& [car, cdr] = static_cast<const PairValue&>(*current);
-        result.push_back(car);
-        current = cdr.get();
+        auto& pair = current->asPair();
+        result.push_back(pair.getCar());
+        current = &pair.getCdr();
     }
     if (!current->isNil()) {
         throw LispError("Malformed list: expected pair or nil, got " + current->toString() + ".");
@@ -101,34 +58,108 @@ std::vector<ValuePtr> Value::toVector() const {
     return result;
 }
 
-ValuePtr Value::nil() {
-    return std::make_shared<NilValue>();
+ValuePtr ValuePtr::fromWord(std::int64_t value) {
+    return makeValue<BigIntValue>(value);
+}
+
+ValuePtr ValuePtr::fromBigInt(BigInt value) {
+    if (auto word = value.toInt64()) {
+        return fromInteger(*word);
+    }
+    return makeValue<BigIntValue>(std::move(value));
+}
+
+ArgBuffer::ArgBuffer(ValuePtr list) {
+    for (; list.isPair(); list = list.asPair().getCdr()) {
+        push_back(list.asPair().getCar());
+    }
+    if (!list.isNil()) {
+        throw LispError("Malformed list: expected pair or nil, got " + list.toString() + ".");
+    }
+}
+
+std::string ValuePtr::toString() const {
+    switch (getType()) {
+        case ValueType::NIL: return "()";
+        case ValueType::BOOLEAN: return asBool() ? "#t" : "#f";
+        case ValueType::NUMBER: {
+            if (isFixnum()) {
+                return std::to_string(asFixnum());
+            } else if (isBignum()) {
+                return get()->toString();
+            }
+            // Integral flonums print without a fraction, like exact integers.
+            auto value = asFlonum();
+            if (value == 0) {
+                return "0";
+            } else if (value == std::floor(value) && std::isfinite(value)) {
+                char buffer[512];
+                std::snprintf(buffer, sizeof(buffer), "%.0f", value);
+                return buffer;
+            }
+            return std::to_string(value);
+        }
+        default: return get()->toString();
+    }
 }
 
-ValuePtr Value::fromBoolean(bool value) {
-    return std::make_shared<BooleanValue>(value);
+namespace {
+
+struct SymbolTable {
+    std::unordered_map<std::string, SymbolId> byName;
+    ValueVector byId;
+};
+
+// Function-local so that other translation units may intern symbols during
+// their own static initialization. The table is a GC root, so symbols are
+// never collected.
+SymbolTable& symbolTable() {
+    static SymbolTable table;
+    return table;
 }
 
-ValuePtr Value::fromNumber(double value) {
-    return std::make_shared<NumberValue>(value);
+}  // namespace
+
+ValuePtr IdentifierValue::intern(const std::string& name) {
+    return symbolTable().byId[idOf(name)];
 }
 
-ValuePtr Value::fromVector(const std::vector<ValuePtr>& values) {
+SymbolId IdentifierValue::idOf(const std::string& name) {
+    auto& table = symbolTable();
+    if (auto it = table.byName.find(name); it != table.byName.end()) {
+        return it->second;
+    }
+    auto id = SymbolId(table.byId.size());
+    table.byId.push_back(new IdentifierValue(name, id));
+    table.byName.emplace(name, id);
+    return id;
+}
+
+const std::string& IdentifierValue::nameOf(SymbolId id) {
+    return static_cast<const IdentifierValue&>(*symbolTable().byId.at(id)).getName();
+}
+
+ValuePtr Value::fromVector(const ValueVector& values) {
     ValuePtr result = Value::nil();
     for (auto it = values.rbegin(); it != values.rend(); ++it) {
-        result = std::make_shared<PairValue>(*it, result);
+        result = makeValue<PairValue>(*it, std::move(result));
     }
     return result;
 }
 
+void PairValue::trace(GcTracer& tracer) const {
+    tracer.mark(car.get());
+    tracer.mark(cdr.get());
+}
+
 std::string PairValue::toString() const {
     std::stringstream ss;
-    ss << "(" << *this->car;
-    const Value* cdr = this->cdr.get();
+    ss << "(" << car;
+    const ValuePtr* cdr = &this->cdr;
     while (cdr->isPair()) {
-        auto pair = static_cast<const PairValue*>(cdr);
-        ss << " " << *pair->getCar();
-        cdr = pair->getCdr().get();
+        auto& pair = cdr->asPair();
+        ss << " " << pair.getCar();
+        cdr = &pair.getCdr();
     }
     if (cdr->isNil()) {
         ss << ")";
@@ -138,14 +169,88 @@ std::string PairValue::toString() const {
     return ss.str();
 }
 
-std::string NumberValue::toString() const {
-    return value == std::floor(value) && std::isfinite(value) ? std::to_string(std::int64_t(value))
-                                                              : std::to_string(value);
+void VectorValue::trace(GcTracer& tracer) const {
+    for (auto element : elements) {
+        tracer.mark(element.get());
+    }
+}
+
+std::string VectorValue::toString() const {
+    std::stringstream ss;
+    ss << "#(";
+    for (std::size_t i = 0; i < elements.size(); i++) {
+        ss << (i ? " " : "") << elements[i];
+    }
+    ss << ")";
+    return ss.str();
+}
+
+namespace {
+
+// Concatenations shorter than this are copied rather than made into ropes.
+constexpr std::size_t MIN_ROPE_LENGTH{64};
+
+}  // namespace
+
+std::shared_ptr<const std::string> StringValue::makeBuffer(std::string value) {
+    auto bytes = value.capacity();
+    GcHeap::noteExternalAllocation(bytes);
+    return std::shared_ptr<const std::string>(new std::string(std::move(value)),
+                                              [bytes](const std::string* buffer) {
+                                                  GcHeap::noteExternalFree(bytes);
+                                                  delete buffer;
+                                              });
+}
+
+ValuePtr StringValue::concat(const StringValue& a, const StringValue& b) {
+    if (a.size() + b.size() < MIN_ROPE_LENGTH) {
+        std::string result;
+        result.reserve(a.size() + b.size());
+        result.append(a.getValue()).append(b.getValue());
+        return makeValue<StringValue>(std::move(result));
+    }
+    auto rope = new StringValue(nullptr, 0, a.size() + b.size());
+    rope->left = &a;
+    rope->right = &b;
+    return rope;
+}
+
+// Iterative, since a rope built by appending in a loop is as deep as the loop
+// is long.
+void StringValue::flatten() const {
+    std::string result;
+    result.reserve(length);
+    std::vector<const StringValue*> pending{this};
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        if (node->left) {
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        } else {
+            result.append(*node->buffer, node->offset, node->length);
+        }
+    }
+    buffer = makeBuffer(std::move(result));
+    offset = 0;
+    left = right = nullptr;
+}
+
+ValuePtr StringValue::substring(std::size_t start, std::size_t end) const {
+    if (left) {
+        flatten();
+    }
+    return makeValue<StringValue>(buffer, offset + start, end - start);
+}
+
+void StringValue::trace(GcTracer& tracer) const {
+    tracer.mark(left);
+    tracer.mark(right);
 }
 
 std::string StringValue::toString() const {
     std::stringstream ss;
-    ss << std::quoted(value);
+    ss << std::quoted(getValue());
     return ss.str();
 }
 
@@ -157,20 +262,28 @@ std::string LambdaValue::toString() const {
     return "#<procedure>";
 }
 
-ValuePtr LambdaValue::apply(const std::vector<ValuePtr>& args) {
-    auto childEnv = env->createChild(params, args);
-    auto result = childEnv->evalList(body);
-    return result.back();
+void LambdaValue::trace(GcTracer& tracer) const {
+    tracer.mark(proto);
+    tracer.mark(env);
 }
 
-std::ostream& Value::print() const {
-    if (isSymbol() || isPair() || isNil()) {
-        return std::cout << '\'' << toString() << std::endl;
-    } else {
-        return std::cout << toString() << std::endl;
+ValuePtr LambdaValue::apply(ArgSpan args) const {
+    return execute(proto, env, args);
+}
+
+std::ostream& ValuePtr::print() const {
+    switch (getType()) {
+        case ValueType::SYMBOL:
+        case ValueType::PAIR:
+        case ValueType::NIL: return std::cout << '\'' << toString() << std::endl;
+        default: return std::cout << toString() << std::endl;
     }
 }
 
 std::ostream& operator<<(std::ostream& os, const Value& value) {
     return os << value.toString();
-}
\ No newline at end of file
+}
+
+std::ostream& operator<<(std::ostream& os, const ValuePtr& value) {
+    return os << value.toString();
+}
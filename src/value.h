@@ -1,123 +1,401 @@
 #ifndef VALUE_H
 #define VALUE_H
 
+#include <algorithm>
+#include <bit>
 #include <concepts>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "./bigint.h"
+#include "./gc.h"
+
 class Value;
-using ValuePtr = std::shared_ptr<Value>;
 class PairValue;
+class VectorValue;
+
+using SymbolId = std::uint32_t;
+
+enum class ValueType : std::uint8_t {
+    NIL,
+    BOOLEAN,
+    NUMBER,
+    SYMBOL,
+    STRING,
+    PAIR,
+    BUILTIN_PROC,
+    LAMBDA,
+    HASH_TABLE,
+    VECTOR,
+    F64VECTOR,
+};
+
+class ValuePtr;
+// Values held by C++ code outside the stack, e.g. argument lists.
+using ValueVector = std::vector<ValuePtr, GcRootAllocator<ValuePtr>>;
+
+// A NaN-boxed value handle. Flonums, fixnums, booleans and nil are stored
+// inline in the 64 bits of the handle; everything else is a pointer to a
+// garbage-collected heap `Value`. Any bit pattern whose upper 16 bits are
+// TAG_MIN or above is a tagged immediate rather than a double, so NaNs are
+// canonicalized below it.
+//
+// Numbers are exact integers or flonums (doubles). Exact integers that fit in
+// the 48-bit payload are fixnums; larger ones are BigIntValues on the heap, so
+// every exact integer has exactly one representation.
+class ValuePtr {
+private:
+    static constexpr int TAG_SHIFT{48};
+    static constexpr std::uint64_t PAYLOAD_MASK{(std::uint64_t{1} << TAG_SHIFT) - 1};
+    static constexpr std::uint64_t TAG_HEAP{std::uint64_t{0xFFF9} << TAG_SHIFT};
+    static constexpr std::uint64_t TAG_CONST{std::uint64_t{0xFFFA} << TAG_SHIFT};
+    static constexpr std::uint64_t TAG_FIXNUM{std::uint64_t{0xFFFB} << TAG_SHIFT};
+    // 0xFFFC - 0xFFFF are reserved for further immediate kinds.
+    static constexpr std::uint64_t TAG_MIN{TAG_HEAP};
+    static constexpr std::uint64_t CANONICAL_NAN{0x7FF8'0000'0000'0000};
+    static constexpr std::uint64_t SIGN_BIT{0x8000'0000'0000'0000};
+
+    static constexpr std::uint64_t EMPTY_BITS{TAG_CONST | 0};
+    static constexpr std::uint64_t NIL_BITS{TAG_CONST | 1};
+    static constexpr std::uint64_t FALSE_BITS{TAG_CONST | 2};
+    static constexpr std::uint64_t TRUE_BITS{TAG_CONST | 3};
+
+    std::uint64_t bits;
+
+    struct RawBits {};
+    ValuePtr(std::uint64_t bits, RawBits) : bits{bits} {}
+
+    bool isHeap() const {
+        return (bits >> TAG_SHIFT) == (TAG_HEAP >> TAG_SHIFT);
+    }
+
+    // Compiled code tests and builds handles from their bits.
+    friend class JitCompiler;
 
-class Value {
 public:
-    virtual std::string toString() const = 0;
-    virtual ~Value() = default;
-    auto operator<=>(const Value&) const = default;
+    static constexpr std::int64_t FIXNUM_MAX{(std::int64_t{1} << (TAG_SHIFT - 1)) - 1};
+    static constexpr std::int64_t FIXNUM_MIN{-FIXNUM_MAX - 1};
 
-    std::ostream& print() const;
+    // The empty handle; never the result of evaluating an expression.
+    ValuePtr() : bits{EMPTY_BITS} {}
+    ValuePtr(std::nullptr_t) : ValuePtr() {}
+    ValuePtr(Value* object);
+
+    static ValuePtr nil() {
+        return {NIL_BITS, RawBits{}};
+    }
+    static ValuePtr fromBoolean(bool value) {
+        return {value ? TRUE_BITS : FALSE_BITS, RawBits{}};
+    }
+    static ValuePtr fromNumber(double value) {
+        auto bits = std::bit_cast<std::uint64_t>(value);
+        return {value == value ? bits : CANONICAL_NAN | (bits & SIGN_BIT), RawBits{}};
+    }
+    // `value` must be within [FIXNUM_MIN, FIXNUM_MAX].
+    static ValuePtr fromFixnum(std::int64_t value) {
+        return {TAG_FIXNUM | (static_cast<std::uint64_t>(value) & PAYLOAD_MASK), RawBits{}};
+    }
+    static ValuePtr fromInteger(std::int64_t value) {
+        return value >= FIXNUM_MIN && value <= FIXNUM_MAX ? fromFixnum(value) : fromWord(value);
+    }
+    // A bignum holding `value`, which is outside the fixnum range.
+    static ValuePtr fromWord(std::int64_t value);
+    // A fixnum if `value` fits in one.
+    static ValuePtr fromBigInt(BigInt value);
+
+    explicit operator bool() const {
+        return bits != EMPTY_BITS;
+    }
+    // Identity comparison, i.e. `eq?` on everything but numbers.
+    bool operator==(const ValuePtr& other) const {
+        return bits == other.bits;
+    }
+
+    // The heap object this handle refers to, or nullptr for immediates.
+    Value* get() const {
+        return isHeap() ? reinterpret_cast<Value*>(bits & PAYLOAD_MASK) : nullptr;
+    }
+    Value& operator*() const {
+        return *get();
+    }
+
+    ValueType getType() const;
 
     bool isSymbol() const;
-    bool isNil() const;
-    bool isBoolean() const;
-    bool isNumber() const;
+    bool isNil() const {
+        return bits == NIL_BITS;
+    }
+    bool isBoolean() const {
+        return bits == TRUE_BITS || bits == FALSE_BITS;
+    }
+    bool isFlonum() const {
+        return bits < TAG_MIN;
+    }
+    bool isFixnum() const {
+        return (bits >> TAG_SHIFT) == (TAG_FIXNUM >> TAG_SHIFT);
+    }
+    bool isBignum() const;
+    // An exact integer, fixnum or bignum.
+    bool isInteger() const {
+        return isFixnum() || isBignum();
+    }
+    bool isNumber() const {
+        return isFlonum() || isFixnum() || isBignum();
+    }
     bool isString() const;
     bool isPair() const;
+    bool isVector() const;
     bool isAtom() const;
     bool isSelfEvaluating() const;
     bool isProcedure() const;
 
     bool isList() const;
-    bool isTrue() const;
+    bool isTrue() const {
+        return bits != FALSE_BITS;
+    }
 
-    const std::string* getSymbolName() const;
+    std::optional<SymbolId> getSymbolId() const;
 
-    bool asBool() const;
+    bool asBool() const {
+        return bits == TRUE_BITS;
+    }
+    double asFlonum() const {
+        return std::bit_cast<double>(bits);
+    }
+    std::int64_t asFixnum() const {
+        return static_cast<std::int64_t>(bits << (64 - TAG_SHIFT)) >> (64 - TAG_SHIFT);
+    }
+    // Any exact integer as a BigInt, and as an int64 if it fits in one.
+    BigInt toBigInt() const;
+    std::optional<std::int64_t> toInt64() const;
+    // Any number, converted to a double if it is exact.
     double asNumber() const;
-    const std::string& asString() const;
+    std::string_view asString() const;
     const PairValue& asPair() const;
-    std::vector<ValuePtr> toVector() const;
+    const VectorValue& asVector() const;
+    ValueVector toVector() const;
 
-    static ValuePtr nil();
-    static ValuePtr fromBoolean(bool);
-    static ValuePtr fromNumber(double);
-    static ValuePtr fromVector(const std::vector<ValuePtr>&);
+    std::string toString() const;
+    std::ostream& print() const;
 };
 
-class NilValue final : public Value {
+// Base of every heap-allocated value. The type tag lets ValuePtr dispatch on
+// the kind of value without a virtual call or RTTI.
+class Value : public GcObject {
+private:
+    ValueType type;
+
+protected:
+    explicit Value(ValueType type) : type{type} {}
+
 public:
-    NilValue() = default;
-    bool operator==(const NilValue&) const = default;
-    std::string toString() const override {
-        return "()";
+    ValueType getType() const {
+        return type;
+    }
+
+    virtual std::string toString() const = 0;
+
+    static ValuePtr nil() {
+        return ValuePtr::nil();
     }
+    static ValuePtr fromBoolean(bool value) {
+        return ValuePtr::fromBoolean(value);
+    }
+    static ValuePtr fromNumber(double value) {
+        return ValuePtr::fromNumber(value);
+    }
+    static ValuePtr fromInteger(std::int64_t value) {
+        return ValuePtr::fromInteger(value);
+    }
+    static ValuePtr fromVector(const ValueVector&);
 };
 
+inline ValuePtr::ValuePtr(Value* object)
+    : bits{object ? TAG_HEAP | reinterpret_cast<std::uintptr_t>(object) : EMPTY_BITS} {}
+
+// Must not be called on the empty handle.
+inline ValueType ValuePtr::getType() const {
+    if (isFlonum() || isFixnum()) {
+        return ValueType::NUMBER;
+    } else if (isHeap()) {
+        return get()->getType();
+    } else {
+        return bits == NIL_BITS ? ValueType::NIL : ValueType::BOOLEAN;
+    }
+}
+
+inline bool ValuePtr::isSymbol() const {
+    return isHeap() && get()->getType() == ValueType::SYMBOL;
+}
+
+inline bool ValuePtr::isString() const {
+    return isHeap() && get()->getType() == ValueType::STRING;
+}
+
+inline bool ValuePtr::isPair() const {
+    return isHeap() && get()->getType() == ValueType::PAIR;
+}
+
+inline bool ValuePtr::isVector() const {
+    return isHeap() && get()->getType() == ValueType::VECTOR;
+}
+
+inline bool ValuePtr::isBignum() const {
+    return isHeap() && get()->getType() == ValueType::NUMBER;
+}
+
+namespace detail {
+
+constexpr unsigned typeMask(std::same_as<ValueType> auto... types) {
+    return (0u | ... | (1u << unsigned(types)));
+}
+
+}  // namespace detail
+
+inline bool ValuePtr::isAtom() const {
+    constexpr auto mask = detail::typeMask(ValueType::NIL, ValueType::SYMBOL, ValueType::BOOLEAN,
+                                           ValueType::NUMBER, ValueType::STRING);
+    return mask >> unsigned(getType()) & 1;
+}
+
+inline bool ValuePtr::isSelfEvaluating() const {
+    constexpr auto mask = detail::typeMask(ValueType::BOOLEAN, ValueType::NUMBER,
+                                           ValueType::STRING, ValueType::VECTOR);
+    return mask >> unsigned(getType()) & 1;
+}
+
+inline bool ValuePtr::isProcedure() const {
+    return isHeap() && (get()->getType() == ValueType::BUILTIN_PROC ||
+                        get()->getType() == ValueType::LAMBDA);
+}
+
+template <std::derived_from<Value> T, typename... Args>
+ValuePtr makeValue(Args&&... args) {
+    static_assert(sizeof(T) <= GcHeap::MAX_OBJECT_SIZE, "value type too large for the collector");
+    return ValuePtr(new T(std::forward<Args>(args)...));
+}
+
+// Symbols are interned: there is exactly one IdentifierValue per name, so
+// symbols compare by identity and are keyed everywhere by their SymbolId.
 class IdentifierValue final : public Value {
 private:
     std::string name;
+    SymbolId id;
+
+    IdentifierValue(const std::string& name, SymbolId id)
+        : Value(ValueType::SYMBOL), name{name}, id{id} {}
 
 public:
-    IdentifierValue(const std::string& name) : name{name} {}
-    bool operator==(const IdentifierValue&) const = default;
+    static ValuePtr intern(const std::string& name);
+    static SymbolId idOf(const std::string& name);
+    static const std::string& nameOf(SymbolId id);
 
     const std::string& getName() const {
         return name;
     }
+    SymbolId getId() const {
+        return id;
+    }
 
     std::string toString() const override {
         return name;
     }
 };
 
-class BooleanValue final : public Value {
+// An exact integer outside the fixnum range; see ValuePtr. Those that fit in
+// a machine word are kept as one, which spares them a BigInt and the
+// arithmetic on them its allocations.
+class BigIntValue final : public Value {
 private:
-    bool value;
+    std::optional<std::int64_t> word;
+    BigInt value;
 
 public:
-    BooleanValue(bool value) : value{value} {}
-    bool operator==(const BooleanValue&) const = default;
+    explicit BigIntValue(std::int64_t word) : Value(ValueType::NUMBER), word{word} {}
+    explicit BigIntValue(BigInt value) : Value(ValueType::NUMBER), value{std::move(value)} {}
 
-    bool getValue() const {
-        return value;
+    std::optional<std::int64_t> getWord() const {
+        return word;
+    }
+    BigInt getValue() const {
+        return word ? BigInt(*word) : value;
     }
 
     std::string toString() const override {
-        return value ? "#t" : "#f";
+        return word ? std::to_string(*word) : value.toString();
     }
 };
 
-class NumberValue final : public Value {
-private:
-    double value;
-
-public:
-    NumberValue(double value) : value{value} {}
-    auto operator<=>(const NumberValue&) const = default;
+inline BigInt ValuePtr::toBigInt() const {
+    return isFixnum() ? BigInt(asFixnum()) : static_cast<const BigIntValue*>(get())->getValue();
+}
 
-    double getValue() const {
-        return value;
+inline std::optional<std::int64_t> ValuePtr::toInt64() const {
+    if (isFixnum()) {
+        return asFixnum();
     }
-
-    std::string toString() const override;
-};
-
+    return static_cast<const BigIntValue*>(get())->getWord();
+}
+
+inline double ValuePtr::asNumber() const {
+    if (isFlonum()) {
+        return asFlonum();
+    } else if (auto word = toInt64()) {
+        return static_cast<double>(*word);
+    }
+    return toBigInt().toDouble();
+}
+
+// An immutable string. It is either a view of a shared buffer, so that
+// substrings copy nothing, or a rope: the concatenation of two strings, which
+// is only copied into a buffer of its own when its contents are first needed.
+// Appending to a long string in a loop thus copies it once in the end rather
+// than on every append.
 class StringValue final : public Value {
 private:
-    std::string value;
+    mutable std::shared_ptr<const std::string> buffer;
+    mutable std::size_t offset{0};
+    std::size_t length;
+    // The halves of a rope until it is flattened; null otherwise.
+    mutable const StringValue* left{nullptr};
+    mutable const StringValue* right{nullptr};
+
+    void flatten() const;
+    // A buffer whose storage counts toward garbage collection until the last
+    // string sharing it is gone.
+    static std::shared_ptr<const std::string> makeBuffer(std::string value);
 
 public:
-    StringValue(const std::string& value) : value{value} {}
-    auto operator<=>(const StringValue&) const = default;
+    StringValue(std::string value)
+        : Value(ValueType::STRING), buffer{makeBuffer(std::move(value))}, length{buffer->size()} {}
+    // Characters [offset, offset + length) of `buffer`.
+    StringValue(std::shared_ptr<const std::string> buffer, std::size_t offset, std::size_t length)
+        : Value(ValueType::STRING), buffer{std::move(buffer)}, offset{offset}, length{length} {}
+
+    // `a` followed by `b`; short results are copied right away.
+    static ValuePtr concat(const StringValue& a, const StringValue& b);
 
-    const std::string& getValue() const {
-        return value;
+    std::size_t size() const {
+        return length;
+    }
+    // Valid as long as this string is.
+    std::string_view getValue() const {
+        if (left) {
+            flatten();
+        }
+        return std::string_view(*buffer).substr(offset, length);
     }
+    // Characters [start, end), which must be within the string.
+    ValuePtr substring(std::size_t start, std::size_t end) const;
 
+    void trace(GcTracer& tracer) const override;
     std::string toString() const override;
 };
 
@@ -127,12 +405,13 @@ private:
     ValuePtr cdr;
 
 public:
-    PairValue(ValuePtr car, ValuePtr cdr) : car{std::move(car)}, cdr{std::move(cdr)} {}
+    PairValue(ValuePtr car, ValuePtr cdr)
+        : Value(ValueType::PAIR), car{std::move(car)}, cdr{std::move(cdr)} {}
 
-    ValuePtr getCar() const {
+    const ValuePtr& getCar() const {
         return car;
     }
-    ValuePtr getCdr() const {
+    const ValuePtr& getCdr() const {
         return cdr;
     }
     void setCar(ValuePtr v) {
@@ -141,6 +420,7 @@ public:
     void setCdr(ValuePtr v) {
         cdr = v;
     }
+    void trace(GcTracer& tracer) const override;
     std::string toString() const override;
 
     template <std::size_t I>
@@ -167,38 +447,131 @@ struct std::tuple_element<I, PairValue> {
 
 class EvaluateEnv;
 
-using BuiltinFuncTypeNoEnv = ValuePtr(const std::vector<ValuePtr>&);
-using BuiltinFuncType = ValuePtr(const std::vector<ValuePtr>&, EvaluateEnv&);
+// The arguments of a call. The VM passes a view of its operand stack, so
+// calling a procedure copies nothing.
+using ArgSpan = std::span<const ValuePtr>;
+
+// Arguments gathered by C++ code, e.g. from the list given to `apply`. Up to
+// INLINE_CAPACITY of them are kept inline, where the collector finds them with
+// the rest of the C++ stack; only longer lists spill into a rooted vector.
+// Meant to live on the stack.
+class ArgBuffer {
+public:
+    static constexpr std::size_t INLINE_CAPACITY{6};
+
+private:
+    ValuePtr inlineArgs[INLINE_CAPACITY];
+    ValueVector spilled;
+    std::size_t count{0};
+
+public:
+    ArgBuffer() = default;
+    // The elements of `list`, which must be a proper list.
+    explicit ArgBuffer(ValuePtr list);
+
+    void push_back(ValuePtr value) {
+        if (count < INLINE_CAPACITY) {
+            inlineArgs[count] = value;
+        } else {
+            if (count == INLINE_CAPACITY) {
+                spilled.assign(inlineArgs, inlineArgs + INLINE_CAPACITY);
+            }
+            spilled.push_back(value);
+        }
+        count++;
+    }
+    std::size_t size() const {
+        return count;
+    }
+    const ValuePtr* data() const {
+        return count > INLINE_CAPACITY ? spilled.data() : inlineArgs;
+    }
+    operator ArgSpan() const {
+        return {data(), count};
+    }
+};
+
+// A fixed-size array of values, with O(1) access by index.
+class VectorValue final : public Value {
+private:
+    std::vector<ValuePtr> elements;
+
+public:
+    explicit VectorValue(std::span<const ValuePtr> elements)
+        : Value(ValueType::VECTOR), elements(elements.begin(), elements.end()) {
+        GcHeap::noteExternalAllocation(this->elements.capacity() * sizeof(ValuePtr));
+    }
+    VectorValue(std::size_t size, ValuePtr fill) : Value(ValueType::VECTOR), elements(size, fill) {
+        GcHeap::noteExternalAllocation(elements.capacity() * sizeof(ValuePtr));
+    }
+    ~VectorValue() override {
+        GcHeap::noteExternalFree(elements.capacity() * sizeof(ValuePtr));
+    }
+
+    std::size_t size() const {
+        return elements.size();
+    }
+    std::span<const ValuePtr> getElements() const {
+        return elements;
+    }
+    // `index` must be less than size().
+    const ValuePtr& operator[](std::size_t index) const {
+        return elements[index];
+    }
+    void set(std::size_t index, ValuePtr value) {
+        elements[index] = value;
+    }
+    void fill(ValuePtr value) {
+        std::fill(elements.begin(), elements.end(), value);
+    }
+
+    void trace(GcTracer& tracer) const override;
+    std::string toString() const override;
+};
+
+using BuiltinFuncTypeNoEnv = ValuePtr(ArgSpan);
+using BuiltinFuncType = ValuePtr(ArgSpan, EvaluateEnv&);
 
 class BuiltinProcValue final : public Value {
 private:
     BuiltinFuncType* func;
 
 public:
-    BuiltinProcValue(BuiltinFuncType* func) : func{std::move(func)} {}
+    BuiltinProcValue(BuiltinFuncType* func) : Value(ValueType::BUILTIN_PROC), func{func} {}
 
-    ValuePtr apply(const std::vector<ValuePtr>& args, EvaluateEnv& env) const {
+    BuiltinFuncType* getFunc() const {
+        return func;
+    }
+    ValuePtr apply(ArgSpan args, EvaluateEnv& env) const {
         return func(args, env);
     }
     std::string toString() const override;
 };
 
+class Prototype;
+
 class LambdaValue final : public Value {
 private:
-    std::vector<std::string> params;
-    ValuePtr body;
-    std::shared_ptr<EvaluateEnv> env;
+    const Prototype* proto;
+    EvaluateEnv* env;
 
 public:
-    LambdaValue(const std::vector<std::string>& params, ValuePtr body,
-                std::shared_ptr<EvaluateEnv> env)
-        : params{params}, body{std::move(body)}, env{std::move(env)} {}
+    LambdaValue(const Prototype* proto, EvaluateEnv* env)
+        : Value(ValueType::LAMBDA), proto{proto}, env{env} {}
 
-    ValuePtr apply(const std::vector<ValuePtr>& args);
+    const Prototype* getProto() const {
+        return proto;
+    }
+    EvaluateEnv* getEnv() const {
+        return env;
+    }
+    ValuePtr apply(ArgSpan args) const;
 
+    void trace(GcTracer& tracer) const override;
     std::string toString() const override;
 };
 
 std::ostream& operator<<(std::ostream& os, const Value& value);
+std::ostream& operator<<(std::ostream& os, const ValuePtr& value);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,414 @@
+#include "./vm.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+
+#include "./builtins.h"
+#include "./bytecode.h"
+#include "./error.h"
+#include "./eval_env.h"
+#include "./jit.h"
+#include "./number.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MINI_LISP_COMPUTED_GOTO
+#endif
+
+namespace {
+
+// Frames and operand stacks that fit in this many slots together live in the
+// activation's C++ frame.
+constexpr std::size_t INLINE_STACK_SIZE{32};
+
+bool isApply(ValuePtr proc) {
+    return proc.getType() == ValueType::BUILTIN_PROC &&
+           static_cast<const BuiltinProcValue*>(proc.get())->getFunc() == apply;
+}
+
+BuiltinFuncType* stockBuiltin(Primitive primitive) {
+    switch (primitive) {
+        case Primitive::ADD: return add;
+        case Primitive::SUB: return sub;
+        case Primitive::MUL: return mult;
+        case Primitive::NUM_EQ: return eq;
+        case Primitive::LT: return lt;
+        case Primitive::GT: return gt;
+        case Primitive::LE: return lteq;
+        case Primitive::GE: return gteq;
+        case Primitive::CAR: return car;
+        case Primitive::CDR: return cdr;
+        case Primitive::CONS: return cons;
+        case Primitive::NULL_Q: return nullQ;
+    }
+    return nullptr;
+}
+
+bool isStock(ValuePtr value, Primitive primitive) {
+    return value.getType() == ValueType::BUILTIN_PROC &&
+           static_cast<const BuiltinProcValue*>(value.get())->getFunc() == stockBuiltin(primitive);
+}
+
+template <typename F>
+ValuePtr* numeric(ValuePtr* sp, F op) {
+    if (!sp[-2].isNumber() || !sp[-1].isNumber()) {
+        return nullptr;
+    }
+    sp[-2] = op(sp[-2], sp[-1]);
+    return sp - 1;
+}
+
+}  // namespace
+
+ValuePtr* runPrimitive(Primitive primitive, ValuePtr* sp) {
+    switch (primitive) {
+        case Primitive::ADD: return numeric(sp, numberAdd);
+        case Primitive::SUB: return numeric(sp, numberSub);
+        case Primitive::MUL: return numeric(sp, numberMul);
+        case Primitive::NUM_EQ:
+            return numeric(sp, [](ValuePtr a, ValuePtr b) {
+                return Value::fromBoolean(numberCompare(a, b) == 0);
+            });
+        case Primitive::LT:
+            return numeric(sp, [](ValuePtr a, ValuePtr b) {
+                return Value::fromBoolean(numberCompare(a, b) < 0);
+            });
+        case Primitive::GT:
+            return numeric(sp, [](ValuePtr a, ValuePtr b) {
+                return Value::fromBoolean(numberCompare(a, b) > 0);
+            });
+        case Primitive::LE:
+            return numeric(sp, [](ValuePtr a, ValuePtr b) {
+                return Value::fromBoolean(numberCompare(a, b) <= 0);
+            });
+        case Primitive::GE:
+            return numeric(sp, [](ValuePtr a, ValuePtr b) {
+                return Value::fromBoolean(numberCompare(a, b) >= 0);
+            });
+        case Primitive::CAR:
+            if (!sp[-1].isPair()) {
+                return nullptr;
+            }
+            sp[-1] = sp[-1].asPair().getCar();
+            return sp;
+        case Primitive::CDR:
+            if (!sp[-1].isPair()) {
+                return nullptr;
+            }
+            sp[-1] = sp[-1].asPair().getCdr();
+            return sp;
+        case Primitive::CONS: sp[-2] = makeValue<PairValue>(sp[-2], sp[-1]); return sp - 1;
+        case Primitive::NULL_Q: sp[-1] = Value::fromBoolean(sp[-1].isNil()); return sp;
+    }
+    return nullptr;
+}
+
+ValuePtr callProcedure(ValuePtr proc, ArgSpan args, EvaluateEnv& env) {
+    switch (proc.getType()) {
+        case ValueType::BUILTIN_PROC:
+            return static_cast<const BuiltinProcValue*>(proc.get())->apply(args, env);
+        case ValueType::LAMBDA: return static_cast<const LambdaValue*>(proc.get())->apply(args);
+        default: throw LispError("Not a procedure " + proc.toString());
+    }
+}
+
+ValuePtr execute(const Prototype* proto, EvaluateEnv* env, ArgSpan args) {
+    // Frames that no closure can see are kept at the bottom of the stack
+    // buffer, below the operand stack. The buffer is scanned by the collector
+    // along with the rest of the C++ stack, or is a root if it had to move to
+    // the heap. Slots above the stack pointer are never read, so the inline
+    // one is left uninitialized.
+    alignas(ValuePtr) std::byte inlineStack[INLINE_STACK_SIZE * sizeof(ValuePtr)];
+    ValueVector heapStack;
+    ValuePtr* stack = reinterpret_cast<ValuePtr*>(inlineStack);
+    // The frame of the running code, and the heap frame holding it if any;
+    // `env` is the environment the code was closed over.
+    ValuePtr* locals;
+    EvaluateEnv* frame;
+
+    // Arguments spread from the list given to `apply` in a tail call.
+    ArgBuffer spread;
+
+    // Sets up the frame of `proto` with `args`, which may lie in the operand
+    // stack of the activation being replaced.
+    auto enter = [&](ArgSpan args) {
+        auto frameSize = proto->getFrameSize();
+        if (args.size() != proto->getParamCount()) {
+            throw LispError("Procedure expected " + std::to_string(proto->getParamCount()) +
+                            " parameters, got " + std::to_string(args.size()));
+        }
+        if (proto->needsHeapFrame()) {
+            frame = env->createChild(frameSize, args);
+            locals = frame->getSlots();
+            frameSize = 0;
+        } else {
+            frame = nullptr;
+        }
+        auto bind = [&](ArgSpan args) {
+            if (!frame) {
+                // Arguments never sit below their slots, so copying forward
+                // is safe even when they overlap.
+                locals = stack;
+                for (std::size_t i = 0; i < args.size(); i++) {
+                    locals[i] = args[i];
+                }
+                std::fill(locals + args.size(), locals + frameSize, ValuePtr());
+            }
+            return stack + frameSize;
+        };
+        auto size = frameSize + proto->getMaxStack();
+        if (size > INLINE_STACK_SIZE && size > heapStack.size()) {
+            ArgBuffer saved;
+            for (auto&& arg : frame ? ArgSpan() : args) {
+                saved.push_back(arg);
+            }
+            heapStack.resize(size);
+            stack = heapStack.data();
+            return bind(saved);
+        }
+        return bind(args);
+    };
+
+    const std::uint32_t* code = proto->getCode();
+    const ValuePtr* constants = proto->getConstants();
+    GlobalCache* caches = proto->getCaches();
+    const std::uint32_t* pc = code;
+    ValuePtr* sp = enter(args);
+
+    // The procedure and arguments of a tail call.
+    ValuePtr callee;
+    ArgSpan callArgs;
+
+    JitFrame jit;
+
+    auto local = [&](std::uint32_t slot, SymbolId name) {
+        auto&& value = locals[slot];
+        if (!value) {
+            throw LispError("Unbound variable " + IdentifierValue::nameOf(name));
+        }
+        return value;
+    };
+    // Bindings are looked up once per instruction, then reached through the
+    // cache.
+    auto global = [&](GlobalCache& cache, SymbolId name) -> GlobalBinding& {
+        if (!cache.binding) {
+            cache.binding = env->findBinding(name);
+            if (!cache.binding) {
+                throw LispError("Unbound variable " + IdentifierValue::nameOf(name));
+            }
+        }
+        return *cache.binding;
+    };
+
+#ifdef MINI_LISP_COMPUTED_GOTO
+    static void* const DISPATCH_TABLE[]{
+#define X(name, operands) &&op_##name,
+        MINI_LISP_OPCODES(X)
+#undef X
+    };
+#define TARGET(name) op_##name:
+#define DISPATCH() goto* DISPATCH_TABLE[*pc++]
+#else
+#define TARGET(name) case OpCode::name:
+#define DISPATCH() continue
+#endif
+
+start:
+    // Hot code runs as machine code, which hands back to the VM part way when
+    // it meets something it does not handle.
+    if (auto native = proto->enterNative()) {
+        jit.locals = locals;
+        jit.sp = sp;
+        jit.caches = caches;
+        jit.env = env;
+        jit.proto = proto;
+        if (native->run(jit) == JitExit::RETURN) {
+            return jit.result;
+        }
+        pc = code + jit.pc;
+        sp = jit.sp;
+    }
+#ifdef MINI_LISP_COMPUTED_GOTO
+    DISPATCH();
+#else
+    while (true) {
+        switch (static_cast<OpCode>(*pc++)) {
+#endif
+
+    TARGET(CONST) {
+        *sp++ = constants[*pc++];
+        DISPATCH();
+    }
+    TARGET(NIL) {
+        *sp++ = Value::nil();
+        DISPATCH();
+    }
+    TARGET(LOCAL) {
+        *sp++ = local(pc[0], pc[1]);
+        pc += 2;
+        DISPATCH();
+    }
+    TARGET(LOCAL_UP) {
+        // The running code's own frame is not in the chain of `env`.
+        auto&& value = env->lookupLocal(pc[0] - 1, pc[1]);
+        if (!value) {
+            throw LispError("Unbound variable " + IdentifierValue::nameOf(pc[2]));
+        }
+        *sp++ = value;
+        pc += 3;
+        DISPATCH();
+    }
+    TARGET(GLOBAL) {
+        *sp++ = global(caches[pc[1]], pc[0]).value;
+        pc += 2;
+        DISPATCH();
+    }
+    TARGET(DEFINE_LOCAL) {
+        locals[pc[0]] = sp[-1];
+        sp[-1] = constants[pc[1]];
+        pc += 2;
+        DISPATCH();
+    }
+    TARGET(DEFINE_GLOBAL) {
+        auto&& symbol = constants[*pc++];
+        env->defineBinding(*symbol.getSymbolId(), sp[-1]);
+        sp[-1] = symbol;
+        DISPATCH();
+    }
+    TARGET(POP) {
+        sp--;
+        DISPATCH();
+    }
+    TARGET(JUMP) {
+        pc = code + *pc;
+        DISPATCH();
+    }
+    TARGET(JUMP_IF_FALSE) {
+        pc = (*--sp).isTrue() ? pc + 1 : code + *pc;
+        DISPATCH();
+    }
+    TARGET(JUMP_IF_FALSE_OR_POP) {
+        if (sp[-1].isTrue()) {
+            sp--;
+            pc++;
+        } else {
+            pc = code + *pc;
+        }
+        DISPATCH();
+    }
+    TARGET(JUMP_IF_TRUE_OR_POP) {
+        if (sp[-1].isTrue()) {
+            pc = code + *pc;
+        } else {
+            sp--;
+            pc++;
+        }
+        DISPATCH();
+    }
+    TARGET(GUARD) {
+        auto&& cache = caches[pc[1]];
+        pc = cache.version == cache.binding->version ? pc + 3 : code + pc[2];
+        DISPATCH();
+    }
+    TARGET(CLOSURE) {
+        *sp++ = makeValue<LambdaValue>(proto->getProtos()[*pc++], frame);
+        DISPATCH();
+    }
+    TARGET(BIND) {
+        auto count = pc[1];
+        sp -= count;
+        std::copy(sp, sp + count, locals + pc[0]);
+        pc += 2;
+        DISPATCH();
+    }
+    TARGET(CALL) {
+        auto argc = *pc++;
+        auto args = sp - argc;
+        sp = args - 1;
+        *sp = callProcedure(*sp, {args, argc}, *env);
+        sp++;
+        DISPATCH();
+    }
+    TARGET(TAIL_CALL) {
+        auto argc = *pc++;
+        callee = (sp - argc)[-1];
+        callArgs = {sp - argc, argc};
+        goto tail_call;
+    }
+    tail_call: {
+        if (callArgs.size() == 2 && isApply(callee)) {
+            callee = callArgs[0];
+            spread = ArgBuffer(callArgs[1]);
+            callArgs = spread;
+        }
+        if (callee.getType() != ValueType::LAMBDA) {
+            return callProcedure(callee, callArgs, *env);
+        }
+        auto lambda = static_cast<const LambdaValue*>(callee.get());
+        env = lambda->getEnv();
+        proto = lambda->getProto();
+        sp = enter(callArgs);
+        code = proto->getCode();
+        constants = proto->getConstants();
+        caches = proto->getCaches();
+        pc = code;
+        goto start;
+    }
+    TARGET(CALL_PRIMITIVE) {
+        auto primitive = static_cast<Primitive>(pc[0]);
+        auto&& cache = caches[pc[3]];
+        auto&& binding = global(cache, pc[2]);
+        if (cache.version != binding.version) {
+            cache.version = binding.version;
+            cache.stock = isStock(binding.value, primitive);
+        }
+        if (cache.stock) {
+            if (auto top = runPrimitive(primitive, sp)) {
+                sp = top;
+                pc += 4;
+                DISPATCH();
+            }
+        }
+        auto argc = pc[1];
+        pc += 4;
+        if (static_cast<OpCode>(*pc) == OpCode::RETURN) {
+            callee = binding.value;
+            callArgs = {sp - argc, argc};
+            goto tail_call;
+        }
+        sp -= argc;
+        *sp = callProcedure(binding.value, {sp, argc}, *env);
+        sp++;
+        DISPATCH();
+    }
+    TARGET(RETURN) {
+        return sp[-1];
+    }
+    TARGET(CONS) {
+        sp--;
+        sp[-1] = makeValue<PairValue>(sp[-1], sp[0]);
+        DISPATCH();
+    }
+    TARGET(ERROR) {
+        throw LispError(std::string(constants[*pc].asString()));
+    }
+    TARGET(LOCAL_CONST) {
+        *sp++ = local(pc[0], pc[1]);
+        *sp++ = constants[pc[2]];
+        pc += 3;
+        DISPATCH();
+    }
+    TARGET(LOCAL_LOCAL) {
+        *sp++ = local(pc[0], pc[1]);
+        *sp++ = local(pc[2], pc[3]);
+        pc += 4;
+        DISPATCH();
+    }
+
+#ifndef MINI_LISP_COMPUTED_GOTO
+        }
+    }
+#endif
+#undef TARGET
+#undef DISPATCH
+}
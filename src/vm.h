@@ -0,0 +1,25 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+
+#include "./value.h"
+
+class EvaluateEnv;
+class Prototype;
+enum class Primitive : std::uint32_t;
+
+// Runs `proto` with `args` in a new frame inside `env`, and returns its value.
+// Calls between procedures recurse into the VM, except tail calls, which reuse
+// the activation.
+ValuePtr execute(const Prototype* proto, EvaluateEnv* env, ArgSpan args = {});
+
+// Calls `proc` with `args`; builtins are given `env`.
+ValuePtr callProcedure(ValuePtr proc, ArgSpan args, EvaluateEnv& env);
+
+// Does what the stock builtin would with the arguments on top of the stack,
+// returning the new stack pointer; nullptr if the builtin has to be called,
+// e.g. to report a type error.
+ValuePtr* runPrimitive(Primitive primitive, ValuePtr* sp);
+
+#endif
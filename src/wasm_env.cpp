@@ -3,24 +3,29 @@
 #include <emscripten/bind.h>
 
 #include "./eval_env.h"
+#include "./gc.h"
 #include "./reader.h"
 #include "./tokenizer.h"
 
+// The JavaScript host owns the native stack, so it is never scanned; the
+// environment is an explicit root and collections only happen between calls.
 class WasmEnv {
 private:
-    std::shared_ptr<EvaluateEnv> env;
+    EvaluateEnv* env;
+    GcRoot envRoot{env};
 
 public:
     WasmEnv() : env{EvaluateEnv::createGlobal()} {}
 
     std::string eval(const std::string& code) {
+        GcHeap::collectIfNeeded();
         auto tokens = Tokenizer::tokenize(code);
         Reader reader(tokens);
         auto result = env->eval(reader.read());
-        if (result->isSymbol() || result->isPair() || result->isNil()) {
-            return "'" + result->toString();
+        if (result.isSymbol() || result.isPair() || result.isNil()) {
+            return "'" + result.toString();
         } else {
-            return result->toString();
+            return result.toString();
         }
     }
 };
@@ -0,0 +1,28 @@
+;;; Calls of pure builtins on constants are evaluated by the compiler, but
+;;; must behave as if they were evaluated each time: redefining a builtin
+;;; afterwards, or shadowing it locally, changes the result.
+(define (seconds days) (* days (* 60 60 24)))
+(displayln (seconds 2))
+(define (facts) (list (< 1 2) (number? "1") (car '(a b)) (length '(1 2 3)) (abs -3)))
+(displayln (facts))
+
+(define stock- -)
+(define (difference) (- (- 10 4) 1))
+(displayln (difference))
+(define (- a b) (stock- b a))
+(displayln (difference))
+(define - stock-)
+(displayln (difference))
+
+(displayln (let ((+ *)) (+ 2 3)))
+
+;; Calls whose result may grow without bound are not evaluated by the
+;; compiler, so a branch that is never taken costs nothing to load.
+(define (huge x) (if x (expt 3 10000000) (expt 2 10)))
+(define (huger x) (if x (expt 2 (expt 2 40)) (- 1)))
+(displayln (list (huge #f) (huger #f)))
+
+;; Errors are still raised when the call is evaluated, not when compiled.
+(define (never) (+ 1 "a"))
+(displayln 'compiled)
+(never)
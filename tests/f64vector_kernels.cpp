@@ -0,0 +1,128 @@
+// Checks every version of the f64vector kernels this processor supports
+// against the scalar one, which tests/f64vectors.scm does not reach where a
+// vector version is picked. Inputs mix NaN, infinities, zeros of both signs
+// and subnormals, with lengths that are and are not multiples of a vector
+// width, starting at unaligned addresses too. Results must agree exactly, NaN
+// with NaN.
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/f64vector.h"
+
+namespace {
+
+constexpr int ROUNDS = 20;
+
+std::mt19937_64 generator;
+
+double randomElement() {
+    constexpr double SPECIAL[]{0.0,
+                               -0.0,
+                               std::numeric_limits<double>::quiet_NaN(),
+                               std::numeric_limits<double>::infinity(),
+                               -std::numeric_limits<double>::infinity(),
+                               std::numeric_limits<double>::denorm_min(),
+                               -std::numeric_limits<double>::min(),
+                               1.0,
+                               -1.0};
+    if (generator() % 8 == 0) {
+        return SPECIAL[generator() % std::size(SPECIAL)];
+    }
+    return std::uniform_real_distribution<double>(-1e3, 1e3)(generator);
+}
+
+bool same(double a, double b) {
+    return (std::isnan(a) && std::isnan(b)) || (a == b && std::signbit(a) == std::signbit(b));
+}
+
+class Checker {
+private:
+    const F64Kernels& scalar;
+    const F64Kernels& kernels;
+    int failures{0};
+
+    void check(const char* kernel, std::size_t n, std::size_t i, double expected, double actual) {
+        if (!same(expected, actual) && failures++ < 10) {
+            std::cout << kernels.name << " " << kernel << ", " << n << " elements, at " << i
+                      << ": " << actual << " instead of " << expected << "\n";
+        }
+    }
+
+    void checkElementwise(const char* kernel, std::size_t n,
+                          const std::function<void(const F64Kernels&, double*)>& run) {
+        std::vector<double> expected(n), actual(n);
+        run(scalar, expected.data());
+        run(kernels, actual.data());
+        for (std::size_t i = 0; i < n; i++) {
+            check(kernel, n, i, expected[i], actual[i]);
+        }
+    }
+
+public:
+    Checker(const F64Kernels& scalar, const F64Kernels& kernels)
+        : scalar{scalar}, kernels{kernels} {}
+
+    void run(const double* a, const double* b, std::size_t n) {
+        auto factor = randomElement();
+        checkElementwise("add", n, [&](auto&& k, double* out) { k.add(a, b, out, n); });
+        checkElementwise("sub", n, [&](auto&& k, double* out) { k.sub(a, b, out, n); });
+        checkElementwise("mul", n, [&](auto&& k, double* out) { k.mul(a, b, out, n); });
+        checkElementwise("div", n, [&](auto&& k, double* out) { k.div(a, b, out, n); });
+        checkElementwise("scale", n, [&](auto&& k, double* out) { k.scale(a, factor, out, n); });
+        checkElementwise("prefixSum", n, [&](auto&& k, double* out) { k.prefixSum(a, out, n); });
+        check("sum", n, 0, scalar.sum(a, n), kernels.sum(a, n));
+        check("dot", n, 0, scalar.dot(a, b, n), kernels.dot(a, b, n));
+        check("min", n, 0, scalar.min(a, n), kernels.min(a, n));
+        check("max", n, 0, scalar.max(a, n), kernels.max(a, n));
+    }
+
+    int getFailures() const {
+        return failures;
+    }
+};
+
+}  // namespace
+
+int main() {
+    auto versions = F64Kernels::available();
+    auto& scalar = *versions.front();
+    int failures = 0;
+    for (auto kernels : versions) {
+        if (kernels == &scalar) {
+            continue;
+        }
+        Checker checker(scalar, *kernels);
+        for (std::size_t n = 0; n <= 1030; n += n < 70 ? 1 : 137) {
+            for (int round = 0; round < ROUNDS; round++) {
+                // One more element than needed, to start at either alignment.
+                std::vector<double> a(n + 1), b(n + 1);
+                for (std::size_t i = 0; i <= n; i++) {
+                    a[i] = randomElement();
+                    b[i] = randomElement();
+                }
+                // Inputs without NaN, so that what min, max and the sums make
+                // of the other values is compared too.
+                if (round % 2) {
+                    for (auto& x : a) {
+                        x = std::isnan(x) ? 0.5 : x;
+                    }
+                }
+                auto offset = round % 4 / 2;
+                checker.run(a.data() + offset, b.data() + offset, n);
+            }
+        }
+        std::cout << kernels->name << ": "
+                  << (checker.getFailures() ? std::to_string(checker.getFailures()) + " mismatches"
+                                            : std::string("agrees with ") + scalar.name)
+                  << "\n";
+        failures += checker.getFailures();
+    }
+    return failures ? 1 : 0;
+}
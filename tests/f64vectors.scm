@@ -0,0 +1,27 @@
+;;; f64vectors hold unboxed doubles; their arithmetic works on whole vectors.
+(define a (f64vector 1 2 3 4 5 6 7 8 9 10))
+(define b (list->f64vector (list 10 9 8 7 6 5 4 3 2 1)))
+(displayln a)
+(displayln (list (f64vector? a) (f64vector? #(1)) (f64vector-length a) (f64vector-ref a 2)))
+(displayln (f64vector-add a b))
+(displayln (f64vector-sub a b))
+(displayln (f64vector-mul a b))
+(displayln (f64vector-div (f64vector 1 3 5) (f64vector 2 4 8)))
+(displayln (f64vector-scale a 0.5))
+(displayln (list (f64vector-sum a) (f64vector-dot a b) (f64vector-min b) (f64vector-max b)))
+(displayln (f64vector-prefix-sum a))
+(define c (make-f64vector 3 1))
+(f64vector-set! c 1 2.5)
+(displayln (list c (f64vector->list c) (make-f64vector 2) (f64vector)))
+(displayln (list (f64vector-sum (f64vector)) (f64vector-min (f64vector))))
+; The elements of results count toward collections, which otherwise never
+; start for a loop that allocates only vectors.
+(define big (make-f64vector 100000 1))
+(define (gc-collections) (cdr (car (gc-stats))))
+(define (churn n)
+  (if (> n 0)
+      (begin (f64vector-add big big) (churn (- n 1)))))
+(define collections (gc-collections))
+(churn 200)
+(displayln (> (gc-collections) collections))
+(f64vector-add a c)
@@ -0,0 +1,47 @@
+;;; Hash tables key with equal? unless made with eq?, under which lists and
+;;; strings are only found by identity. Numbers are always compared by value.
+(define table (make-hash-table))
+(hash-set! table 'apple 1)
+(hash-set! table "pear" 2)
+(hash-set! table '(1 2 3) 3)
+(hash-set! table 4 'four)
+(displayln (list (hash-table? table) (hash-table? '()) (hash-count table)))
+(displayln (list (hash-ref table 'apple) (hash-ref table "pear") (hash-ref table (list 1 2 3))
+                 (hash-ref table 4.0) (hash-ref table 'missing #f)))
+(hash-set! table 'apple 10)
+(hash-remove! table "pear")
+(displayln (list (hash-ref table 'apple) (hash-has-key? table "pear") (hash-count table)))
+(define eq-table (make-hash-table eq?))
+(define key (list 1 2))
+(hash-set! eq-table key 'same)
+(displayln (list (hash-ref eq-table key) (hash-ref eq-table (list 1 2) 'different)))
+(hash-remove! eq-table key)
+(hash-set! eq-table 100000000000000000000 'big)
+(displayln (hash-ref eq-table (* 10000000000 10000000000)))
+(displayln (hash->list eq-table))
+(define (fill t i n)
+  (if (< i n)
+      (begin (hash-set! t i (* i i))
+             (fill t (+ i 1) n))))
+(define (remove-odd t i n)
+  (if (< i n)
+      (begin (hash-remove! t i)
+             (remove-odd t (+ i 2) n))))
+(define squares (make-hash-table))
+(fill squares 0 1000)
+(displayln (list (hash-count squares) (hash-ref squares 999)))
+(remove-odd squares 1 1000)
+(displayln (list (hash-count squares) (hash-ref squares 998) (hash-ref squares 997 'removed)))
+(define sum (make-hash-table))
+(hash-set! sum 'total 0)
+(hash-for-each squares (lambda (k v) (hash-set! sum 'total (+ (hash-ref sum 'total) v))))
+(displayln (list (hash-ref sum 'total) (reduce + (hash-values squares))
+                 (length (hash-keys squares))))
+(define vectors (make-hash-table))
+(hash-set! vectors (vector 1 2 3) 'v)
+(hash-set! vectors (vector 1 2 3) 'w)
+(hash-set! vectors (vector (vector "a") '(1 2)) 'nested)
+(displayln (list (hash-ref vectors (vector 1 2 3) 'missing) (hash-count vectors)
+                 (hash-ref vectors (vector (vector "a") '(1 2)) 'missing)
+                 (hash-ref vectors (vector 1 2) 'missing)))
+(hash-ref table 'missing)
@@ -0,0 +1,40 @@
+;;; Procedures called often enough run as machine code, which must give the
+;;; same results as the VM, and hand back to it when its guesses go wrong:
+;;; arguments that are not numbers, redefined builtins, unbound variables.
+(define (repeat n thunk) (if (= n 0) 'done (begin (thunk) (repeat (- n 1) thunk))))
+
+(define (sum-to n acc) (if (= n 0) acc (sum-to (- n 1) (+ acc n))))
+(displayln (sum-to 100000 0))
+
+(define (mix a b) (- (* a b) (+ a b)))
+(repeat 5000 (lambda () (mix 3 4)))
+(displayln (mix 1.5 2))
+(displayln (mix 3 4))
+
+(define (compare a b) (list (< a b) (> a b) (<= a b) (>= a b) (= a b)))
+(repeat 5000 (lambda () (compare 1 2)))
+(displayln (compare 1 2))
+(displayln (compare 2 2))
+(displayln (compare 3 2))
+(displayln (compare (/ 0 0.0) 1))
+
+(define (len l) (if (null? l) 0 (+ 1 (len (cdr l)))))
+(repeat 5000 (lambda () (len '(1 2 3))))
+(displayln (len '(1 2 3 4)))
+(displayln (len '()))
+
+(define (scaled x) (let ((y (* x 2))) (define z (+ y 1)) (- z x)))
+(repeat 5000 (lambda () (scaled 1)))
+(displayln (scaled 10))
+
+(define (late x) (if (> x 0) x (later x)))
+(repeat 5000 (lambda () (late 1)))
+(define (later x) 'later)
+(displayln (late 0))
+
+(define stock+ +)
+(define (+ a b) (stock+ (stock+ a b) 100))
+(displayln (mix 3 4))
+(displayln (sum-to 4 1))
+(define + stock+)
+(displayln (mix 3 4))
@@ -0,0 +1,34 @@
+;;; Exact integers never overflow: results past the fixnum range become
+;;; bignums, and division, quotient, modulo and expt stay exact on them.
+;;; Flonums stay separate and contaminate any arithmetic they take part in.
+(define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))
+(displayln (fact 30))
+(displayln (/ (fact 30) (fact 28)))
+(displayln (- (fact 25) (fact 25)))
+(displayln (expt 2 100))
+(displayln (expt -3 41))
+(displayln (expt 2 -2))
+(displayln (+ 140737488355327 1))
+(displayln (- -140737488355328 1))
+(displayln (* 99999999999 99999999999))
+(displayln 123456789012345678901234567890)
+(displayln (quotient 10000000000 3))
+(displayln (quotient (expt 10 30) (expt 10 20)))
+(displayln (list (remainder 7 2) (remainder -7 2) (modulo -7 2) (modulo 7 -2)))
+(displayln (modulo (- (expt 10 25)) 7))
+(displayln (list (/ 7 2) (/ 6 3) (+ 1 0.5) (* 2 1.5)))
+(displayln (list (= (expt 2 60) (* (expt 2 30) (expt 2 30))) (< (expt 2 70) 1e30)
+                 (> (expt 10 400) 1e300) (= 3 3.0)))
+(displayln (list (integer? (expt 2 64)) (integer? 2.0) (integer? 2.5)
+                 (even? (expt 2 64)) (odd? (+ (expt 2 64) 1)) (zero? (- (expt 2 64) (expt 2 64)))))
+(displayln (abs -140737488355328))
+(define (sum-to n acc) (if (= n 0) acc (sum-to (- n 1) (+ acc n))))
+(displayln (sum-to 20000000 0))
+;; Literal syntax: #x hex, exponents, and symbols that only look numeric.
+(displayln (list #xff #XFF #x-10 #x+a #x7fffffffffff #x1000000000000000000000000))
+(displayln (list 1e3 -2.5E2 .5 1. +7 -0 007 1e999))
+(displayln (list (= 0.1 (/ 1 10.0)) (= 1e23 (* 1e22 10)) (= 5e-324 (/ 5e-323 10))))
+(displayln (list (symbol? '-) (symbol? '...) (symbol? '->x) (symbol? '1+) (symbol? '12abc)
+                 (symbol? 'inf) (symbol? '1e)))
+(displayln (list (string->number "#x1F") (string->number "1e2") (string->number "1e")))
+(displayln (quotient 1 0))
@@ -0,0 +1,25 @@
+;;; Calls of builtins such as + and car are run inline while their names hold
+;;; the stock procedures; redefining a name must take effect at every call site
+;;; already compiled, and restoring it must too.
+(define (inc x) (+ x 1))
+(displayln (inc 1))
+(define stock+ +)
+(define (+ a b) (stock+ (stock+ a b) 100))
+(displayln (inc 1))
+(define + stock+)
+(displayln (inc 1))
+
+(define (first-of x) (car x))
+(displayln (first-of '(a b)))
+(define (car x) 'shadowed)
+(displayln (first-of '(a b)))
+
+;; Local bindings of the same names are plain calls.
+(displayln (let ((+ -)) (+ 5 3)))
+(define (combine op) (op 5 3))
+(displayln (combine *))
+
+;; A redefined primitive called in tail position is still a tail call.
+(define (count-down n) (if (= n 0) 'done (cdr n)))
+(define (cdr n) (count-down (- n 1)))
+(displayln (count-down 1000000))
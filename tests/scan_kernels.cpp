@@ -0,0 +1,115 @@
+// Checks every version of the scan kernels this processor supports, the
+// scalar one included, against a plain loop over the character classes, from
+// every start position of generated texts. The texts are runs of one kind of
+// character, of lengths that cross 16- and 32-byte boundaries, among them
+// bytes from 0x80 up, and are scanned at each alignment in a 32-byte block.
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/char_class.h"
+
+namespace {
+
+constexpr int TEXTS = 300;
+
+std::mt19937 generator;
+
+// A character of one of the kinds the scans tell apart, by `kind`.
+char randomChar(int kind) {
+    static const std::string SPACES{" \t\n\r\v\f"};
+    static const std::string DELIMITERS{"()\"';`,\\"};
+    static const std::string ATOM{"abcxyz019+-*/<=>!?.#_"};
+    switch (kind) {
+        case 0: return SPACES[generator() % SPACES.size()];
+        case 1: return DELIMITERS[generator() % DELIMITERS.size()];
+        case 2: return static_cast<char>(0x80 + generator() % 0x80);
+        case 3: return static_cast<char>(generator() % 0x20);
+        default: return ATOM[generator() % ATOM.size()];
+    }
+}
+
+std::string generateText() {
+    std::string text;
+    auto size = generator() % 300;
+    while (text.size() < size) {
+        auto kind = static_cast<int>(generator() % 6);
+        auto run = 1 + generator() % 70;
+        for (std::size_t i = 0; i < run; i++) {
+            text += randomChar(kind);
+        }
+    }
+    return text;
+}
+
+template <typename P>
+std::size_t reference(const char* text, std::size_t size, std::size_t pos, P ends) {
+    while (pos < size && !ends(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+using Kernel = std::size_t (*)(const char*, std::size_t, std::size_t);
+
+const std::pair<const char*, Kernel ScanKernels::*> SCANS[]{
+    {"skipSpace", &ScanKernels::skipSpace},
+    {"findNewline", &ScanKernels::findNewline},
+    {"findDelimiter", &ScanKernels::findDelimiter},
+    {"findStringEnd", &ScanKernels::findStringEnd},
+};
+
+bool endsScan(Kernel ScanKernels::*scan, char c) {
+    if (scan == &ScanKernels::skipSpace) {
+        return !isSpace(c);
+    } else if (scan == &ScanKernels::findNewline) {
+        return c == '\n';
+    } else if (scan == &ScanKernels::findDelimiter) {
+        return isDelimiter(c);
+    } else {
+        return c == '"' || c == '\\';
+    }
+}
+
+}  // namespace
+
+int main() {
+    auto versions = ScanKernels::available();
+    std::vector<int> failures(versions.size());
+    // Each text is copied to every offset in a block, whose start is aligned.
+    alignas(32) static char buffer[32 + 512];
+    for (int t = 0; t < TEXTS; t++) {
+        auto text = generateText();
+        for (std::size_t offset = 0; offset < 32; offset++) {
+            auto start = buffer + offset;
+            text.copy(start, text.size());
+            for (auto [name, scan] : SCANS) {
+                for (std::size_t pos = 0; pos <= text.size(); pos++) {
+                    auto expected = reference(start, text.size(), pos,
+                                              [scan](char c) { return endsScan(scan, c); });
+                    for (std::size_t v = 0; v < versions.size(); v++) {
+                        auto actual = (versions[v]->*scan)(start, text.size(), pos);
+                        if (actual != expected && failures[v]++ < 10) {
+                            std::cout << versions[v]->name << " " << name << " from " << pos
+                                      << " of " << text.size() << " at offset " << offset << ": "
+                                      << actual << " instead of " << expected << "\n";
+                        }
+                    }
+                }
+            }
+        }
+    }
+    int total = 0;
+    for (std::size_t v = 0; v < versions.size(); v++) {
+        std::cout << versions[v]->name << ": "
+                  << (failures[v] ? std::to_string(failures[v]) + " mismatches"
+                                  : std::string("agrees with the character classes"))
+                  << "\n";
+        total += failures[v];
+    }
+    return total ? 1 : 0;
+}
@@ -0,0 +1,43 @@
+;;; Strings: appending, substrings, searching, splitting and number conversions.
+(define s "hello, world")
+(displayln (list (string-length s) (string-length "") (string-ref s 4)))
+(displayln (list (substring s 7) (substring s 0 5) (substring s 5 5)))
+(displayln (string-append "foo" "bar" "" "baz"))
+(displayln (list (string-append) (string-append "one")))
+(displayln (list (string-index s "world") (string-index s "o") (string-index s "xyz")
+                 (string-index s "")))
+(displayln (string-split "  the quick brown   fox "))
+(displayln (string-split "a,b,,c" ","))
+(displayln (string-split "a--b--" "--"))
+(displayln (list (string->number "42") (string->number "-7") (string->number "2.5")
+                 (string->number "123456789012345678901234567890")
+                 (string->number "12abc") (string->number "") (string->number "abc")))
+(displayln (list (number->string 42) (number->string 2.5) (number->string (* 1.0 3))))
+(displayln (equal? (string-append "ab" "cd") "abcd"))
+;; Substrings of substrings, and substrings of appended strings.
+(define t (substring (substring s 2 10) 3))
+(displayln (list t (string-length t) (substring (string-append s s) 10 14)))
+;; Appending in a loop builds a long string without copying it each time.
+(define (repeat piece n acc)
+  (if (= n 0) acc (repeat piece (- n 1) (string-append acc piece))))
+(define long (repeat "abcdefghij" 100000 ""))
+(displayln (list (string-length long) (substring long 499995 500005)
+                 (string-index long "ja")))
+(define h (make-hash-table))
+(hash-set! h (string-append "ke" "y") 1)
+(displayln (hash-ref h "key"))
+;; String literals may span lines and hold escaped quotes and backslashes.
+(define multi "one
+two")
+(displayln (list (string-length multi) (string-split multi) (string-length "a\"b\\c")))
+;; Flattened buffers count toward collections, which otherwise never start for
+;; a loop whose garbage is only strings.
+(define (double s n) (if (= n 0) s (double (string-append s s) (- n 1))))
+(define big (double "x" 20))
+(define (gc-collections) (cdr (car (gc-stats))))
+(define (churn n)
+  (if (> n 0)
+      (begin (substring (string-append big "x") 0 1) (churn (- n 1)))))
+(define collections (gc-collections))
+(churn 100)
+(displayln (list (string-length big) (> (gc-collections) collections)))
@@ -0,0 +1,26 @@
+;;; Tail calls must not grow the stack: each loop below runs far deeper
+;;; than the native stack could hold if calls in tail position nested.
+(define (count-up i n)
+  (if (< i n)
+      (count-up (+ i 1) n)
+      i))
+(displayln (count-up 0 10000000))
+(define (even? n) (if (= n 0) #t (odd? (- n 1))))
+(define (odd? n) (if (= n 0) #f (even? (- n 1))))
+(displayln (even? 1000001))
+(define (via-cond n) (cond ((= n 0) 'cond) (else (via-cond (- n 1)))))
+(displayln (via-cond 1000000))
+(define (via-and n) (and #t (if (= n 0) 'and (via-and (- n 1)))))
+(displayln (via-and 1000000))
+(define (via-or n) (or #f (if (= n 0) 'or (via-or (- n 1)))))
+(displayln (via-or 1000000))
+(define (via-let n) (let ((m (- n 1))) (if (< m 0) 'let (via-let m))))
+(displayln (via-let 1000000))
+(define (via-begin n) (begin 'ignored (if (= n 0) 'begin (via-begin (- n 1)))))
+(displayln (via-begin 1000000))
+(define (via-closure n)
+  (define (loop i acc) (if (= i 0) acc (loop (- i 1) (+ acc 1))))
+  (loop n 0))
+(displayln (via-closure 1000000))
+(define (via-apply n) (if (= n 0) 'apply (apply via-apply (list (- n 1)))))
+(displayln (via-apply 1000000))
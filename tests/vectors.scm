@@ -0,0 +1,33 @@
+;;; Vectors: literals, construction, indexing, mutation and conversions.
+(define v #(1 "two" (3 4) #(5)))
+(displayln v)
+(displayln (list (vector? v) (vector? '(1)) (vector-length v) (vector-ref v 2)))
+(displayln (vector-ref (vector-ref v 3) 0))
+(define w (make-vector 3 'x))
+(vector-set! w 1 'y)
+(displayln w)
+(vector-fill! w 0)
+(displayln (list w (make-vector 2) (vector) (vector 1 2 3)))
+(displayln (vector->list #(a b c)))
+(displayln (list->vector (list 1 2 3)))
+(displayln (vector-map (lambda (x) (* x x)) #(1 2 3 4)))
+(displayln (list (equal? #(1 (2) "3") (vector 1 (list 2) "3")) (equal? #(1 2) #(1 2 3))
+                 (eq? v v) (equal? #() (vector))))
+(define (fill-squares v i)
+  (if (< i (vector-length v))
+      (begin (vector-set! v i (* i i))
+             (fill-squares v (+ i 1)))
+      v))
+(displayln (fill-squares (make-vector 10) 0))
+(displayln (length (vector->list (make-vector 1000 0))))
+(print #(1 a))
+; The elements count toward collections, which otherwise never start for a
+; loop that allocates only vectors.
+(define (gc-collections) (cdr (car (gc-stats))))
+(define (churn n)
+  (if (> n 0)
+      (begin (make-vector 100000 0) (churn (- n 1)))))
+(define collections (gc-collections))
+(churn 100)
+(displayln (> (gc-collections) collections))
+(vector-ref v 4)
@@ -12,3 +12,33 @@ target("mini_lisp")
     add_cxflags("-fwasm-exceptions", "-sASSERTIONS", "-fexperimental-library")
     add_ldflags("-fwasm-exceptions", "-sASSERTIONS")
   end
+
+-- Compiles a Lisp file into C++, to be built with the runtime in src/:
+--   bin/mini_lisp_aot script.scm script.cpp
+target("mini_lisp_aot")
+  set_kind("binary")
+  set_default(not is_plat("wasm"))
+  add_files("src/*.cpp|main.cpp|wasm_env.cpp", "aot/main.cpp")
+  set_languages("c++20")
+  set_targetdir("bin")
+
+for _, file in ipairs(os.files("bench/*.cpp")) do
+  target(path.basename(file))
+    set_kind("binary")
+    set_default(false)
+    add_files("src/*.cpp|main.cpp|wasm_env.cpp", file)
+    set_languages("c++20")
+    set_targetdir("bin")
+end
+
+-- Checks of the C++ parts the Lisp tests cannot reach, e.g. every version of
+-- the SIMD kernels; each exits with status 1 on a failure:
+--   xmake build f64vector_kernels && xmake run f64vector_kernels
+for _, file in ipairs(os.files("tests/*.cpp")) do
+  target(path.basename(file))
+    set_kind("binary")
+    set_default(false)
+    add_files("src/*.cpp|main.cpp|wasm_env.cpp", file)
+    set_languages("c++20")
+    set_targetdir("bin")
+end